@@ -70,7 +70,7 @@ bool disk_saveFile(struct Core *core, int index, char *comment, int address, int
         return false;
     }
     
-    assert(address >= 0 && address + length <= sizeof(struct Machine));
+    assert(address >= 0 && address + length <= 0x10000);
     struct DataManager *dataManager = &core->diskDrive->dataManager;
     if (!data_canSetEntry(dataManager, index, length))
     {
@@ -78,8 +78,11 @@ bool disk_saveFile(struct Core *core, int index, char *comment, int address, int
     }
     else
     {
-        uint8_t *source = &((uint8_t *)core->machine)[address];
+        uint8_t *source = malloc(length);
+        if (!source) exit(EXIT_FAILURE);
+        machine_read(core, address, source, length);
         data_setEntry(dataManager, index, comment, source, length);
+        free(source);
         
         delegate_diskDriveDidSave(core);
     }
@@ -107,13 +110,12 @@ bool disk_loadFile(struct Core *core, int index, int address, int maxLength, int
     {
         length = entry->length - offset;
     }
-    for (int i = 0; i < length; i++)
+    if (length > 0)
     {
-        bool poke = machine_poke(core, address + i, data[i + start]);
+        bool poke = machine_write(core, address, &data[start], length);
         if (!poke)
         {
             *pokeFailed = true;
-            return true;
         }
     }
     return true;
@@ -54,6 +54,9 @@ void core_init(struct Core *core)
     core->overlay = calloc(1, sizeof(struct Overlay));
     if (!core->overlay) exit(EXIT_FAILURE);
     
+    core->metrics = calloc(1, sizeof(struct Metrics));
+    if (!core->metrics) exit(EXIT_FAILURE);
+    
     machine_init(core);
     itp_init(core);
     overlay_init(core);
@@ -64,6 +67,8 @@ void core_deinit(struct Core *core)
 {
     itp_deinit(core);
     disk_deinit(core);
+    trace_stop(core);
+    rewind_stop(core);
     
     free(core->machine);
     core->machine = NULL;
@@ -79,6 +84,9 @@ void core_deinit(struct Core *core)
     
     free(core->overlay);
     core->overlay = NULL;
+    
+    free(core->metrics);
+    core->metrics = NULL;
 }
 
 void core_setDelegate(struct Core *core, struct CoreDelegate *delegate)
@@ -94,20 +102,46 @@ struct CoreError core_compileProgram(struct Core *core, const char *sourceCode,
     return itp_compileProgram(core, sourceCode);
 }
 
+/** Compiles a program from prg_new with source code from prg_setSourceCode or prg_useSourceCode, for example to read a memory-mapped file in place */
+struct CoreError core_compileNewProgram(struct Core *core, struct Program *program, bool resetPersistent)
+{
+    machine_reset(core, resetPersistent);
+    overlay_reset(core);
+    disk_reset(core);
+    return itp_compileNewProgram(core, program);
+}
+
+/** Runs a program compiled by another core, for example for many instances of the same cart. The program is shared, not copied. */
+void core_loadProgram(struct Core *core, struct Program *program, bool resetPersistent)
+{
+    machine_reset(core, resetPersistent);
+    overlay_reset(core);
+    disk_reset(core);
+    itp_loadProgram(core, program);
+}
+
+/** Returns the program compiled by core_compileProgram, NULL if there is none or it had errors. Use prg_retain to keep it. */
+struct Program *core_getProgram(struct Core *core)
+{
+    struct Program *program = core->interpreter->program;
+    return (program && program->isCompiled) ? program : NULL;
+}
+
 void core_traceError(struct Core *core, struct CoreError error)
 {
     core->interpreter->debug = false;
     struct TextLib *lib = &core->overlay->textLib;
     txtlib_printText(lib, err_getString(error.code));
     txtlib_printText(lib, "\n");
-    if (error.sourcePosition >= 0 && core->interpreter->sourceCode)
+    struct Program *program = core->interpreter->program;
+    if (error.sourcePosition >= 0 && program)
     {
-        int number = lineNumber(core->interpreter->sourceCode, error.sourcePosition);
+        int number = lineNumber(program->sourceCode, error.sourcePosition);
         char lineNumberText[30];
         sprintf(lineNumberText, "IN LINE %d:\n", number);
         txtlib_printText(lib, lineNumberText);
         
-        const char *line = lineString(core->interpreter->sourceCode, error.sourcePosition);
+        const char *line = lineString(program->sourceCode, error.sourcePosition);
         if (line)
         {
             txtlib_printText(lib, line);
@@ -122,17 +156,31 @@ void core_willRunProgram(struct Core *core, long secondsSincePowerOn)
     runStartupSequence(core);
     core->interpreter->timer = (float)(secondsSincePowerOn * 60 % TIMER_WRAP_VALUE);
     machine_suspendEnergySaving(core, 30);
+    metrics_reset(core);
+    rewind_reset(core);
     delegate_controlsDidChange(core);
 }
 
 void core_update(struct Core *core, struct CoreInput *input)
 {
+    metrics_beginFrame(core);
+    metrics_stageDidChange(core, CoreStageInput);
     core_handleInput(core, input);
+    metrics_stageDidChange(core, CoreStageVBLInterrupt);
     itp_runInterrupt(core, InterruptTypeVBL);
+    metrics_stageDidChange(core, CoreStageMainProgram);
     itp_runProgram(core);
+    metrics_stageDidChange(core, CoreStageSystem);
     itp_didFinishVBL(core);
     overlay_draw(core, true);
     audio_bufferRegisters(core);
+    metrics_stageDidChange(core, CoreStageIdle);
+}
+
+/** Returns the metrics of the last finished frame */
+struct CoreMetrics core_getMetrics(struct Core *core)
+{
+    return core->metrics->lastFrame;
 }
 
 void core_handleInput(struct Core *core, struct CoreInput *input)
@@ -230,10 +278,16 @@ void core_handleInput(struct Core *core, struct CoreInput *input)
 
 void core_willSuspendProgram(struct Core *core)
 {
-    if (core->machineInternals->hasChangedPersistent)
+    core_savePersistentRam(core);
+}
+
+/** Calls the delegate if persistent RAM changed since the last time. Can be called while the program runs, for example every frame. */
+void core_savePersistentRam(struct Core *core)
+{
+    if (core->machineInternals->changedPersistentPages)
     {
         delegate_persistentRamDidChange(core, core->machine->persistentRam, PERSISTENT_RAM_SIZE);
-        core->machineInternals->hasChangedPersistent = false;
+        core->machineInternals->changedPersistentPages = 0;
     }
 }
 
@@ -248,6 +302,87 @@ bool core_getDebug(struct Core *core)
     return core->interpreter->debug;
 }
 
+void core_setProfiling(struct Core *core, bool enabled)
+{
+    if (enabled)
+    {
+        prof_start(core);
+    }
+    else
+    {
+        prof_stop(core);
+    }
+}
+
+bool core_isProfiling(struct Core *core)
+{
+    return core->interpreter->profiler != NULL;
+}
+
+void core_setTracing(struct Core *core, bool enabled)
+{
+    if (enabled)
+    {
+        trace_start(core);
+    }
+    else
+    {
+        trace_stop(core);
+    }
+}
+
+bool core_isTracing(struct Core *core)
+{
+    return core->tracer != NULL;
+}
+
+size_t core_getStateSize(struct Core *core)
+{
+    return state_getSize(core);
+}
+
+bool core_saveState(struct Core *core, void *data, size_t size)
+{
+    return state_save(core, data, size);
+}
+
+bool core_loadState(struct Core *core, const void *data, size_t size)
+{
+    return state_load(core, data, size);
+}
+
+void core_setRewind(struct Core *core, size_t bufferSize)
+{
+    if (bufferSize > 0)
+    {
+        rewind_start(core, bufferSize);
+    }
+    else
+    {
+        rewind_stop(core);
+    }
+}
+
+void core_saveRewindFrame(struct Core *core)
+{
+    rewind_saveFrame(core);
+}
+
+bool core_rewindFrame(struct Core *core)
+{
+    return rewind_loadFrame(core);
+}
+
+void core_setRewindCheckpoint(struct Core *core)
+{
+    rewind_setCheckpoint(core);
+}
+
+bool core_restoreRewindCheckpoint(struct Core *core)
+{
+    return rewind_restoreCheckpoint(core);
+}
+
 bool core_isKeyboardEnabled(struct Core *core)
 {
     return core->machine->ioRegisters.attr.keyboardEnabled;
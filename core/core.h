@@ -30,13 +30,23 @@
 #include "interpreter.h"
 #include "disk_drive.h"
 #include "core_delegate.h"
+#include "core_metrics.h"
+#include "core_trace.h"
+#include "core_state.h"
+#include "core_cache.h"
+#include "core_rewind.h"
 
+// All state of one console. The core has no writable globals, so separate cores can run on
+// separate threads. Calls into one core must not overlap, except audio_renderAudio from the audio thread.
 struct Core {
     struct Machine *machine;
     struct MachineInternals *machineInternals;
     struct Interpreter *interpreter;
     struct DiskDrive *diskDrive;
     struct Overlay *overlay;
+    struct Metrics *metrics;
+    struct Tracer *tracer;
+    struct Rewind *rewind;
     struct CoreDelegate *delegate;
 };
 
@@ -70,12 +80,29 @@ void core_init(struct Core *core);
 void core_deinit(struct Core *core);
 void core_setDelegate(struct Core *core, struct CoreDelegate *delegate);
 struct CoreError core_compileProgram(struct Core *core, const char *sourceCode, bool resetPersistent);
+struct CoreError core_compileNewProgram(struct Core *core, struct Program *program, bool resetPersistent);
+void core_loadProgram(struct Core *core, struct Program *program, bool resetPersistent);
+struct Program *core_getProgram(struct Core *core);
 void core_traceError(struct Core *core, struct CoreError error);
 void core_willRunProgram(struct Core *core, long secondsSincePowerOn);
 void core_update(struct Core *core, struct CoreInput *input);
+struct CoreMetrics core_getMetrics(struct Core *core);
 void core_willSuspendProgram(struct Core *core);
+void core_savePersistentRam(struct Core *core);
 void core_setDebug(struct Core *core, bool enabled);
 bool core_getDebug(struct Core *core);
+void core_setProfiling(struct Core *core, bool enabled);
+bool core_isProfiling(struct Core *core);
+void core_setTracing(struct Core *core, bool enabled);
+bool core_isTracing(struct Core *core);
+size_t core_getStateSize(struct Core *core);
+bool core_saveState(struct Core *core, void *data, size_t size);
+bool core_loadState(struct Core *core, const void *data, size_t size);
+void core_setRewind(struct Core *core, size_t bufferSize);
+void core_saveRewindFrame(struct Core *core);
+bool core_rewindFrame(struct Core *core);
+void core_setRewindCheckpoint(struct Core *core);
+bool core_restoreRewindCheckpoint(struct Core *core);
 bool core_isKeyboardEnabled(struct Core *core);
 bool core_shouldRender(struct Core *core);
 
@@ -0,0 +1,42 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_atomic.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+int atomic_addInt(volatile int *value, int amount)
+{
+#ifdef _MSC_VER
+    return _InterlockedExchangeAdd((volatile long *)value, amount) + amount;
+#else
+    return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL);
+#endif
+}
+
+int atomic_getInt(volatile int *value)
+{
+#ifdef _MSC_VER
+    return _InterlockedOr((volatile long *)value, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
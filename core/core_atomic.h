@@ -0,0 +1,35 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_atomic_h
+#define core_atomic_h
+
+#include <stdio.h>
+
+// For ints shared between threads, for example the emulation and the audio thread.
+// Plain reads and writes of them may be torn or reordered.
+
+/** Adds to the value and returns the new value */
+int atomic_addInt(volatile int *value, int amount);
+
+/** Returns the value as last written by any thread */
+int atomic_getInt(volatile int *value);
+
+#endif /* core_atomic_h */
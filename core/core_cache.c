@@ -0,0 +1,352 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_cache.h"
+#include "core.h"
+#include "charsets.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_MAGIC 0x43584E4C // "LNXC"
+
+// magic, version, total size, checksum, key (2), source length, token set
+#define CACHE_HEADER_SIZE 32
+
+void cache_writeProgram(struct StateWriter *writer, struct Program *program);
+bool cache_readProgram(struct StateReader *reader, struct Program *program);
+uint64_t cache_getKey(struct Program *program);
+int32_t cache_getTokenIndex(struct Program *program, struct Token *token);
+struct Token *cache_getToken(struct Program *program, int32_t index, bool *isValid);
+uint32_t cache_getChecksum(const uint8_t *data, size_t size);
+uint32_t cache_getTokenSetHash(void);
+
+
+size_t cache_getSize(struct Program *program)
+{
+    if (!program->isCompiled) return 0;
+    
+    struct StateWriter writer = {NULL, 0, 0};
+    cache_writeProgram(&writer, program);
+    return CACHE_HEADER_SIZE + writer.position;
+}
+
+/** Writes a compiled program with its resolved jumps and ROM, so it can be loaded without compiling */
+bool cache_save(struct Program *program, void *data, size_t size)
+{
+    if (!program->isCompiled || size < CACHE_HEADER_SIZE) return false;
+    
+    struct StateWriter writer = {(uint8_t *)data + CACHE_HEADER_SIZE, size - CACHE_HEADER_SIZE, 0};
+    cache_writeProgram(&writer, program);
+    if (writer.position > writer.size) return false;
+    
+    uint64_t key = cache_getKey(program);
+    struct StateWriter header = {data, CACHE_HEADER_SIZE, 0};
+    state_writeInt(&header, CACHE_MAGIC);
+    state_writeInt(&header, CACHE_VERSION);
+    state_writeInt(&header, (int32_t)(CACHE_HEADER_SIZE + writer.position));
+    state_writeInt(&header, cache_getChecksum(writer.data, writer.position));
+    state_writeInt(&header, (uint32_t)key);
+    state_writeInt(&header, (uint32_t)(key >> 32));
+    state_writeInt(&header, (int32_t)strlen(program->sourceCode));
+    state_writeInt(&header, cache_getTokenSetHash());
+    return true;
+}
+
+/** Compiles a program from prg_new with source code from the cache. Returns false if the cache is invalid or was made from other source code. */
+bool cache_load(struct Program *program, const void *data, size_t size)
+{
+    struct StateReader header = {data, size, 0, false};
+    uint32_t magic = state_readInt(&header);
+    uint32_t version = state_readInt(&header);
+    uint32_t totalSize = state_readInt(&header);
+    uint32_t checksum = state_readInt(&header);
+    uint32_t keyLow = state_readInt(&header);
+    uint32_t keyHigh = state_readInt(&header);
+    uint32_t sourceLength = state_readInt(&header);
+    uint32_t tokenSetHash = state_readInt(&header);
+    if (   header.hasFailed
+        || magic != CACHE_MAGIC
+        || version != CACHE_VERSION
+        || totalSize < CACHE_HEADER_SIZE
+        || totalSize > size
+        || sourceLength != strlen(program->sourceCode)
+        || tokenSetHash != cache_getTokenSetHash())
+    {
+        return false;
+    }
+    
+    uint64_t key = cache_getKey(program);
+    struct StateReader reader = {(const uint8_t *)data + CACHE_HEADER_SIZE, totalSize - CACHE_HEADER_SIZE, 0, false};
+    if (   keyLow != (uint32_t)key
+        || keyHigh != (uint32_t)(key >> 32)
+        || checksum != cache_getChecksum(reader.data, reader.size))
+    {
+        return false;
+    }
+    if (!cache_readProgram(&reader, program))
+    {
+        prg_clear(program);
+        return false;
+    }
+    program->isCompiled = true;
+    return true;
+}
+
+void cache_writeProgram(struct StateWriter *writer, struct Program *program)
+{
+    struct Tokenizer *tokenizer = &program->tokenizer;
+    state_writeInt(writer, tokenizer->numTokens);
+    state_writeInt(writer, tokenizer->numSymbols);
+    state_writeInt(writer, tokenizer->numJumpLabelItems);
+    state_writeInt(writer, tokenizer->numSubItems);
+    state_writeInt(writer, cache_getTokenIndex(program, program->firstData));
+    state_writeInt(writer, cache_getTokenIndex(program, program->lastData));
+    
+    for (int i = 0; i < tokenizer->numTokens; i++)
+    {
+        struct Token *token = &tokenizer->tokens[i];
+        state_writeInt(writer, token->type);
+        state_writeInt(writer, token->sourcePosition);
+        switch (token->type)
+        {
+            case TokenFloat:
+                state_write(writer, &token->floatValue, sizeof(float));
+                break;
+                
+            case TokenString:
+            {
+                int32_t length = (int32_t)strlen(token->stringValue->chars);
+                state_writeInt(writer, length);
+                state_write(writer, token->stringValue->chars, length);
+                break;
+            }
+                
+            case TokenIdentifier:
+            case TokenStringIdentifier:
+            case TokenLabel:
+                state_writeInt(writer, token->symbolIndex);
+                break;
+                
+            default:
+                state_writeInt(writer, cache_getTokenIndex(program, token->jumpToken));
+                break;
+        }
+    }
+    
+    for (int i = 0; i < tokenizer->numSymbols; i++)
+    {
+        // only the name, the rest of the field is zero so the file is the same for the same program
+        char name[SYMBOL_NAME_SIZE];
+        strncpy(name, tokenizer->symbols[i].name, SYMBOL_NAME_SIZE);
+        name[SYMBOL_NAME_SIZE - 1] = 0;
+        state_write(writer, name, SYMBOL_NAME_SIZE);
+    }
+    for (int i = 0; i < tokenizer->numJumpLabelItems; i++)
+    {
+        state_writeInt(writer, tokenizer->jumpLabelItems[i].symbolIndex);
+        state_writeInt(writer, tokenizer->jumpLabelItems[i].tokenIndex);
+    }
+    for (int i = 0; i < tokenizer->numSubItems; i++)
+    {
+        state_writeInt(writer, tokenizer->subItems[i].symbolIndex);
+        state_writeInt(writer, tokenizer->subItems[i].tokenIndex);
+    }
+    
+    // decoded ROM, entries are contiguous
+    struct DataManager *romDataManager = &program->romDataManager;
+    for (int i = 0; i < MAX_ENTRIES; i++)
+    {
+        struct DataEntry *entry = &romDataManager->entries[i];
+        state_write(writer, entry->comment, ENTRY_COMMENT_SIZE);
+        state_writeInt(writer, entry->start);
+        state_writeInt(writer, entry->length);
+    }
+    int romSize = data_currentSize(romDataManager);
+    state_write(writer, romDataManager->data, romSize);
+}
+
+bool cache_readProgram(struct StateReader *reader, struct Program *program)
+{
+    struct Tokenizer *tokenizer = &program->tokenizer;
+    int numTokens = state_readInt(reader);
+    int numSymbols = state_readInt(reader);
+    int numJumpLabelItems = state_readInt(reader);
+    int numSubItems = state_readInt(reader);
+    int firstData = state_readInt(reader);
+    int lastData = state_readInt(reader);
+    if (   reader->hasFailed
+        || numTokens < 1 || numTokens >= MAX_TOKENS
+        || numSymbols < 0 || numSymbols > MAX_SYMBOLS
+        || numJumpLabelItems < 0 || numJumpLabelItems > MAX_JUMP_LABEL_ITEMS
+        || numSubItems < 0 || numSubItems > MAX_SUB_ITEMS)
+    {
+        return false;
+    }
+    
+    if (!tok_allocArena(tokenizer, numTokens, numSymbols)) return false;
+    memset(tokenizer->tokens, 0, numTokens * sizeof(struct Token));
+    
+    bool isValid = true;
+    program->firstData = cache_getToken(program, firstData, &isValid);
+    program->lastData = cache_getToken(program, lastData, &isValid);
+    
+    for (int i = 0; i < numTokens && isValid; i++)
+    {
+        struct Token *token = &tokenizer->tokens[i];
+        token->type = state_readInt(reader);
+        token->sourcePosition = state_readInt(reader);
+        switch (token->type)
+        {
+            case TokenFloat:
+                state_read(reader, &token->floatValue, sizeof(float));
+                break;
+                
+            case TokenString:
+            {
+                int32_t length = state_readInt(reader);
+                if (length < 0 || (size_t)length > reader->size - reader->position)
+                {
+                    isValid = false;
+                    break;
+                }
+                // constant like the ones of the tokenizer
+                struct RCString *string = rcstring_new((const char *)&reader->data[reader->position], length);
+                if (!string) return false;
+                rcstring_makeConstant(string);
+                token->stringValue = string;
+                reader->position += length;
+                break;
+            }
+                
+            case TokenIdentifier:
+            case TokenStringIdentifier:
+            case TokenLabel:
+                token->symbolIndex = state_readInt(reader);
+                isValid = isValid && token->symbolIndex >= 0 && token->symbolIndex < numSymbols;
+                break;
+                
+            default:
+                token->jumpToken = cache_getToken(program, state_readInt(reader), &isValid);
+                isValid = isValid && token->type > TokenUndefined && token->type < Token_count;
+                break;
+        }
+    }
+    if (!isValid) return false;
+    
+    for (int i = 0; i < numSymbols; i++)
+    {
+        struct Symbol *symbol = &tokenizer->symbols[i];
+        state_read(reader, symbol->name, SYMBOL_NAME_SIZE);
+        symbol->name[SYMBOL_NAME_SIZE - 1] = 0;
+    }
+    for (int i = 0; i < numJumpLabelItems; i++)
+    {
+        struct JumpLabelItem *item = &tokenizer->jumpLabelItems[i];
+        item->symbolIndex = state_readInt(reader);
+        item->tokenIndex = state_readInt(reader);
+        isValid = isValid && item->symbolIndex >= 0 && item->symbolIndex < numSymbols;
+        item->token = cache_getToken(program, item->tokenIndex, &isValid);
+    }
+    tokenizer->numJumpLabelItems = numJumpLabelItems;
+    for (int i = 0; i < numSubItems; i++)
+    {
+        struct SubItem *item = &tokenizer->subItems[i];
+        item->symbolIndex = state_readInt(reader);
+        item->tokenIndex = state_readInt(reader);
+        isValid = isValid && item->symbolIndex >= 0 && item->symbolIndex < numSymbols;
+        item->token = cache_getToken(program, item->tokenIndex, &isValid);
+    }
+    tokenizer->numSubItems = numSubItems;
+    
+    struct DataManager *romDataManager = &program->romDataManager;
+    int romSize = 0;
+    for (int i = 0; i < MAX_ENTRIES; i++)
+    {
+        struct DataEntry *entry = &romDataManager->entries[i];
+        state_read(reader, entry->comment, ENTRY_COMMENT_SIZE);
+        entry->comment[ENTRY_COMMENT_SIZE - 1] = 0;
+        entry->start = state_readInt(reader);
+        entry->length = state_readInt(reader);
+        if (entry->start != romSize || entry->length < 0 || entry->length > DATA_SIZE - romSize)
+        {
+            return false;
+        }
+        romSize += entry->length;
+    }
+    state_read(reader, romDataManager->data, romSize);
+    
+    return isValid && !reader->hasFailed && reader->position == reader->size;
+}
+
+/** Identifies the source code the program was compiled from, in upper case like the tokenizer reads it */
+uint64_t cache_getKey(struct Program *program)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const char *character = program->sourceCode; *character; character++)
+    {
+        hash = (hash ^ CharSetUppercase[(uint8_t)*character]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+int32_t cache_getTokenIndex(struct Program *program, struct Token *token)
+{
+    return token ? (int32_t)(token - program->tokenizer.tokens) : -1;
+}
+
+/** Jumps can go to the TokenUndefined after the last token */
+struct Token *cache_getToken(struct Program *program, int32_t index, bool *isValid)
+{
+    if (index == -1) return NULL;
+    if (index < 0 || index > program->tokenizer.numTokens)
+    {
+        *isValid = false;
+        return NULL;
+    }
+    return &program->tokenizer.tokens[index];
+}
+
+uint32_t cache_getChecksum(const uint8_t *data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** Changes with the list of commands, so caches of older versions are not used */
+uint32_t cache_getTokenSetHash(void)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < Token_count; i++)
+    {
+        const char *string = TokenStrings[i] ? TokenStrings[i] : "";
+        for (const char *character = string; ; character++)
+        {
+            hash = (hash ^ (uint8_t)*character) * 16777619u;
+            if (!*character) break;
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,36 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_cache_h
+#define core_cache_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CACHE_VERSION 1
+
+struct Program;
+
+size_t cache_getSize(struct Program *program);
+bool cache_save(struct Program *program, void *data, size_t size);
+bool cache_load(struct Program *program, const void *data, size_t size);
+
+#endif /* core_cache_h */
@@ -97,3 +97,28 @@ void delegate_persistentRamDidChange(struct Core *core, uint8_t *data, int size)
         core->delegate->persistentRamDidChange(core->delegate->context, data, size);
     }
 }
+
+void delegate_stageDidChange(struct Core *core, enum CoreStage stage)
+{
+    if (core->delegate->stageDidChange)
+    {
+        core->delegate->stageDidChange(core->delegate->context, stage);
+    }
+}
+
+uint64_t delegate_getHostTime(struct Core *core)
+{
+    if (core->delegate->getHostTime)
+    {
+        return core->delegate->getHostTime(core->delegate->context);
+    }
+    return 0;
+}
+
+void delegate_metricsDidUpdate(struct Core *core, struct CoreMetrics *metrics)
+{
+    if (core->delegate->metricsDidUpdate)
+    {
+        core->delegate->metricsDidUpdate(core->delegate->context, metrics);
+    }
+}
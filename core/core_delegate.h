@@ -32,6 +32,19 @@ enum KeyboardMode {
     KeyboardModeOptional
 };
 
+enum CoreStage {
+    CoreStageIdle,
+    CoreStageInput,
+    CoreStageVBLInterrupt,
+    CoreStageMainProgram,
+    CoreStageSystem,
+    CoreStageVideo,
+    CoreStageRasterInterrupt,
+    CoreStageAudio
+};
+
+#define NUM_CORE_STAGES (CoreStageAudio + 1)
+
 struct ControlsInfo {
     enum KeyboardMode keyboardMode;
     int numGamepadsEnabled;
@@ -39,6 +52,29 @@ struct ControlsInfo {
     bool isAudioEnabled;
 };
 
+/** Measurements of one frame, see core_getMetrics */
+struct CoreMetrics {
+    /** Frames since the program started */
+    int frame;
+    int mainCycles;
+    int vblCycles;
+    int rasterCycles;
+    /** Interrupts which needed more cycles than their limit */
+    int numInterruptOverruns;
+    /** Cycles the interrupts are still over their limit at the end of the frame */
+    int interruptOverCycles;
+    /** Raster lines not rendered because of interrupt overruns */
+    int numSkippedLines;
+    /** Frames with skipped lines since the program started */
+    int numSkippedFrames;
+    int numStringAllocations;
+    int numBytesPoked;
+    /** Filled audio register buffers, of NUM_AUDIO_BUFFERS */
+    int audioBufferFill;
+    /** Host nanoseconds per stage, only if the delegate implements getHostTime. Audio may run on another thread. */
+    uint64_t stageTimes[NUM_CORE_STAGES];
+};
+
 struct CoreDelegate {
     void *context;
     
@@ -62,6 +98,15 @@ struct CoreDelegate {
     
     /** Called when persistent RAM should be saved */
     void (*persistentRamDidChange)(void *context, uint8_t *data, int size);
+    
+    /** Optional, called when the core switches to another part of its work, CoreStageIdle when it returns to the caller */
+    void (*stageDidChange)(void *context, enum CoreStage stage);
+    
+    /** Optional, returns a monotonic host time in nanoseconds, used for profiling */
+    uint64_t (*getHostTime)(void *context);
+    
+    /** Optional, called with the metrics of the finished frame when the next one begins */
+    void (*metricsDidUpdate)(void *context, struct CoreMetrics *metrics);
 };
 
 void delegate_interpreterDidFail(struct Core *core, struct CoreError coreError);
@@ -71,5 +116,8 @@ void delegate_diskDriveIsFull(struct Core *core);
 void delegate_controlsDidChange(struct Core *core);
 void delegate_persistentRamWillAccess(struct Core *core, uint8_t *destination, int size);
 void delegate_persistentRamDidChange(struct Core *core, uint8_t *data, int size);
+void delegate_stageDidChange(struct Core *core, enum CoreStage stage);
+uint64_t delegate_getHostTime(struct Core *core);
+void delegate_metricsDidUpdate(struct Core *core, struct CoreMetrics *metrics);
 
 #endif /* core_delegate_h */
@@ -0,0 +1,105 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_metrics.h"
+#include "core.h"
+#include "core_atomic.h"
+#include <string.h>
+
+void metrics_reset(struct Core *core)
+{
+    struct Metrics *metrics = core->metrics;
+    memset(&metrics->frame, 0, sizeof(struct CoreMetrics));
+    memset(&metrics->lastFrame, 0, sizeof(struct CoreMetrics));
+    metrics->hasFrame = false;
+    metrics->frameAudioTime = atomic_getInt(&metrics->audioTime);
+}
+
+void metrics_beginFrame(struct Core *core)
+{
+    struct Metrics *metrics = core->metrics;
+    struct CoreMetrics *frame = &metrics->frame;
+    
+    // audio rendered since the last frame, on whichever thread
+    int audioTime = atomic_getInt(&metrics->audioTime);
+    frame->stageTimes[CoreStageAudio] += (uint32_t)audioTime - (uint32_t)metrics->frameAudioTime;
+    metrics->frameAudioTime = audioTime;
+    
+    if (metrics->hasFrame)
+    {
+        frame->interruptOverCycles = core->interpreter->interruptOverCycles;
+        frame->audioBufferFill = audio_getBufferFill(&core->machineInternals->audioInternals);
+        if (frame->numSkippedLines > 0)
+        {
+            frame->numSkippedFrames++;
+        }
+        
+        metrics->lastFrame = *frame;
+        delegate_metricsDidUpdate(core, &metrics->lastFrame);
+    }
+    
+    // totals continue
+    int frameNumber = metrics->hasFrame ? frame->frame + 1 : 0;
+    int numSkippedFrames = frame->numSkippedFrames;
+    memset(frame, 0, sizeof(struct CoreMetrics));
+    frame->frame = frameNumber;
+    frame->numSkippedFrames = numSkippedFrames;
+    metrics->hasFrame = true;
+    
+    trace_instant(core, TraceThreadMain, "Frame");
+}
+
+void metrics_stageDidChange(struct Core *core, enum CoreStage stage)
+{
+    struct Metrics *metrics = core->metrics;
+    if (core->delegate->getHostTime)
+    {
+        uint64_t time = delegate_getHostTime(core);
+        if (metrics->stage != CoreStageIdle)
+        {
+            metrics->frame.stageTimes[metrics->stage] += time - metrics->stageStartTime;
+        }
+        metrics->stageStartTime = time;
+    }
+    trace_stageDidChange(core, metrics->stage, stage);
+    metrics->stage = stage;
+    delegate_stageDidChange(core, stage);
+}
+
+void metrics_audioWillRender(struct Core *core)
+{
+    // audio has its own start time, it may be rendered on another thread
+    delegate_stageDidChange(core, CoreStageAudio);
+    trace_begin(core, TraceThreadAudio, "Audio");
+    core->metrics->audioStartTime = delegate_getHostTime(core);
+}
+
+void metrics_audioDidRender(struct Core *core)
+{
+    struct Metrics *metrics = core->metrics;
+    uint64_t time = delegate_getHostTime(core);
+    if (time > metrics->audioStartTime)
+    {
+        // the frame belongs to the emulation thread
+        atomic_addInt(&metrics->audioTime, (int)(time - metrics->audioStartTime));
+    }
+    trace_end(core, TraceThreadAudio, "Audio");
+    delegate_stageDidChange(core, CoreStageIdle);
+}
@@ -0,0 +1,52 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_metrics_h
+#define core_metrics_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "core_delegate.h"
+
+struct Core;
+
+struct Metrics {
+    /** The frame in progress */
+    struct CoreMetrics frame;
+    /** The last finished frame */
+    struct CoreMetrics lastFrame;
+    bool hasFrame;
+    enum CoreStage stage;
+    uint64_t stageStartTime;
+    /** Only used by the thread rendering audio */
+    uint64_t audioStartTime;
+    /** Audio nanoseconds, wrapping, added by the audio thread and taken into frames by the emulation thread */
+    volatile int audioTime;
+    int frameAudioTime;
+};
+
+void metrics_reset(struct Core *core);
+void metrics_beginFrame(struct Core *core);
+void metrics_stageDidChange(struct Core *core, enum CoreStage stage);
+void metrics_audioWillRender(struct Core *core);
+void metrics_audioDidRender(struct Core *core);
+
+#endif /* core_metrics_h */
@@ -0,0 +1,342 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_rewind.h"
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+
+// shorter runs of equal bytes are stored with the changed ones
+#define REWIND_MIN_SKIP 4
+
+void rewind_reserve(uint8_t **data, size_t *capacity, size_t size);
+size_t rewind_encodeRange(struct Rewind *rewind, size_t deltaSize, size_t *cursor, size_t nextSize, size_t start, size_t end);
+size_t rewind_writeNumber(uint8_t *data, size_t position, size_t value);
+size_t rewind_readNumber(const uint8_t *data, size_t *position);
+void rewind_storeDelta(struct Rewind *rewind, size_t length);
+void rewind_dropFirstFrame(struct Rewind *rewind);
+
+
+void rewind_start(struct Core *core, size_t bufferSize)
+{
+    rewind_stop(core);
+    
+    struct Rewind *rewind = calloc(1, sizeof(struct Rewind));
+    if (!rewind) exit(EXIT_FAILURE);
+    rewind->buffer = malloc(bufferSize);
+    if (!rewind->buffer) exit(EXIT_FAILURE);
+    rewind->bufferSize = bufferSize;
+    core->rewind = rewind;
+}
+
+void rewind_stop(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (rewind)
+    {
+        free(rewind->buffer);
+        free(rewind->state);
+        free(rewind->nextState);
+        free(rewind->delta);
+        free(rewind->checkpointState);
+        free(rewind);
+        core->rewind = NULL;
+    }
+}
+
+void rewind_reset(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (rewind)
+    {
+        rewind->head = 0;
+        rewind->firstFrame = 0;
+        rewind->numFrames = 0;
+        rewind->stateSize = 0;
+        rewind->hasCheckpoint = false;
+    }
+}
+
+void rewind_saveFrame(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (!rewind) return;
+    
+    size_t nextSize = state_getSize(core);
+    if (nextSize == 0) return;
+    rewind_reserve(&rewind->nextState, &rewind->nextStateCapacity, nextSize);
+    state_save(core, rewind->nextState, nextSize);
+    
+    if (rewind->stateSize > 0)
+    {
+        // delta from the new state back to the previous one
+        size_t size = rewind->stateSize;
+        rewind_reserve(&rewind->delta, &rewind->deltaCapacity, size * 2 + 16);
+        size_t deltaSize = rewind_writeNumber(rewind->delta, 0, size);
+        size_t cursor = 0;
+        
+        deltaSize = rewind_encodeRange(rewind, deltaSize, &cursor, nextSize, 0, STATE_RAM_OFFSET);
+        uint32_t *dirtyBlocks = core->machineInternals->dirtyBlocks;
+        for (int block = 0x8000 / MACHINE_DIRTY_BLOCK_SIZE; block < MACHINE_NUM_DIRTY_BLOCKS; block++)
+        {
+            if (dirtyBlocks[block >> 5] & (1u << (block & 0x1F)))
+            {
+                size_t start = STATE_RAM_OFFSET + block * MACHINE_DIRTY_BLOCK_SIZE - 0x8000;
+                deltaSize = rewind_encodeRange(rewind, deltaSize, &cursor, nextSize, start, start + MACHINE_DIRTY_BLOCK_SIZE);
+            }
+        }
+        deltaSize = rewind_encodeRange(rewind, deltaSize, &cursor, nextSize, STATE_RAM_OFFSET + STATE_RAM_SIZE, size);
+        
+        rewind_storeDelta(rewind, deltaSize);
+    }
+    
+    // the new state becomes the latest one
+    uint8_t *state = rewind->state;
+    size_t stateCapacity = rewind->stateCapacity;
+    rewind->state = rewind->nextState;
+    rewind->stateCapacity = rewind->nextStateCapacity;
+    rewind->stateSize = nextSize;
+    rewind->nextState = state;
+    rewind->nextStateCapacity = stateCapacity;
+    
+    machine_clearDirty(core);
+}
+
+bool rewind_loadFrame(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (!rewind || rewind->numFrames == 0) return false;
+    
+    int index = (rewind->firstFrame + rewind->numFrames - 1) % REWIND_MAX_FRAMES;
+    struct RewindFrame *frame = &rewind->frames[index];
+    const uint8_t *delta = &rewind->buffer[frame->position];
+    size_t position = 0;
+    
+    size_t size = rewind_readNumber(delta, &position);
+    rewind_reserve(&rewind->state, &rewind->stateCapacity, size);
+    if (size > rewind->stateSize)
+    {
+        memset(&rewind->state[rewind->stateSize], 0, size - rewind->stateSize);
+    }
+    rewind->stateSize = size;
+    
+    size_t cursor = 0;
+    while (position < frame->length)
+    {
+        cursor += rewind_readNumber(delta, &position);
+        size_t length = rewind_readNumber(delta, &position);
+        uint8_t *bytes = &rewind->state[cursor];
+        for (size_t i = 0; i < length; i++)
+        {
+            bytes[i] ^= delta[position + i];
+        }
+        position += length;
+        cursor += length;
+    }
+    
+    rewind->numFrames--;
+    rewind->head = frame->position;
+    
+    if (!state_load(core, rewind->state, rewind->stateSize))
+    {
+        rewind_reset(core);
+        return false;
+    }
+    return true;
+}
+
+int rewind_getNumFrames(struct Core *core)
+{
+    return core->rewind ? core->rewind->numFrames : 0;
+}
+
+void rewind_setCheckpoint(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (!rewind) return;
+    
+    rewind_reserve(&rewind->checkpointState, &rewind->checkpointStateCapacity, rewind->stateSize);
+    memcpy(rewind->checkpointState, rewind->state, rewind->stateSize);
+    rewind->checkpointStateSize = rewind->stateSize;
+    rewind->checkpointFrames = rewind->numFrames;
+    rewind->checkpointHead = rewind->head;
+    rewind->hasCheckpoint = true;
+}
+
+bool rewind_restoreCheckpoint(struct Core *core)
+{
+    struct Rewind *rewind = core->rewind;
+    if (!rewind) return false;
+    
+    if (!rewind->hasCheckpoint)
+    {
+        rewind_reset(core);
+        return false;
+    }
+    
+    // frames loaded since are still in the buffer, frames saved since come after them
+    rewind_reserve(&rewind->state, &rewind->stateCapacity, rewind->checkpointStateSize);
+    memcpy(rewind->state, rewind->checkpointState, rewind->checkpointStateSize);
+    rewind->stateSize = rewind->checkpointStateSize;
+    rewind->numFrames = rewind->checkpointFrames;
+    rewind->head = rewind->checkpointHead;
+    return true;
+}
+
+void rewind_reserve(uint8_t **data, size_t *capacity, size_t size)
+{
+    if (size > *capacity)
+    {
+        uint8_t *newData = realloc(*data, size);
+        if (!newData) exit(EXIT_FAILURE);
+        *data = newData;
+        *capacity = size;
+    }
+}
+
+/** Encodes the XOR of the previous state and the next state (zero beyond its size) between start and end */
+size_t rewind_encodeRange(struct Rewind *rewind, size_t deltaSize, size_t *cursor, size_t nextSize, size_t start, size_t end)
+{
+    const uint8_t *state = rewind->state;
+    const uint8_t *nextState = rewind->nextState;
+    uint8_t *delta = rewind->delta;
+    
+    size_t i = start;
+    while (i < end)
+    {
+        uint8_t next = (i < nextSize) ? nextState[i] : 0;
+        if (state[i] == next)
+        {
+            i++;
+            continue;
+        }
+        
+        // changed bytes until enough unchanged ones follow
+        size_t last = i;
+        for (size_t j = i + 1; j < end && j - last <= REWIND_MIN_SKIP; j++)
+        {
+            next = (j < nextSize) ? nextState[j] : 0;
+            if (state[j] != next)
+            {
+                last = j;
+            }
+        }
+        size_t length = last + 1 - i;
+        
+        deltaSize = rewind_writeNumber(delta, deltaSize, i - *cursor);
+        deltaSize = rewind_writeNumber(delta, deltaSize, length);
+        for (size_t j = i; j <= last; j++)
+        {
+            next = (j < nextSize) ? nextState[j] : 0;
+            delta[deltaSize++] = state[j] ^ next;
+        }
+        i = last + 1;
+        *cursor = i;
+    }
+    return deltaSize;
+}
+
+size_t rewind_writeNumber(uint8_t *data, size_t position, size_t value)
+{
+    while (value >= 0x80)
+    {
+        data[position++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    data[position++] = value;
+    return position;
+}
+
+size_t rewind_readNumber(const uint8_t *data, size_t *position)
+{
+    size_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do
+    {
+        byte = data[(*position)++];
+        value |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    }
+    while (byte & 0x80);
+    return value;
+}
+
+/** Copies the delta into the ring buffer, oldest frames are dropped to make room */
+void rewind_storeDelta(struct Rewind *rewind, size_t length)
+{
+    if (rewind->numFrames < rewind->checkpointFrames)
+    {
+        // overwrites frames loaded since the checkpoint
+        rewind->hasCheckpoint = false;
+    }
+    
+    if (length > rewind->bufferSize)
+    {
+        // history can't continue
+        rewind->hasCheckpoint = false;
+        rewind->numFrames = 0;
+        rewind->head = 0;
+        return;
+    }
+    
+    if (rewind->head + length > rewind->bufferSize)
+    {
+        // frames behind the head are the oldest ones
+        while (rewind->numFrames > 0 && rewind->frames[rewind->firstFrame].position >= rewind->head)
+        {
+            rewind_dropFirstFrame(rewind);
+        }
+        rewind->head = 0;
+    }
+    while (rewind->numFrames > 0)
+    {
+        size_t position = rewind->frames[rewind->firstFrame].position;
+        if (position >= rewind->head && position < rewind->head + length)
+        {
+            rewind_dropFirstFrame(rewind);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (rewind->numFrames == REWIND_MAX_FRAMES)
+    {
+        rewind_dropFirstFrame(rewind);
+    }
+    
+    memcpy(&rewind->buffer[rewind->head], rewind->delta, length);
+    int index = (rewind->firstFrame + rewind->numFrames) % REWIND_MAX_FRAMES;
+    rewind->frames[index].position = rewind->head;
+    rewind->frames[index].length = length;
+    rewind->numFrames++;
+    rewind->head += length;
+}
+
+void rewind_dropFirstFrame(struct Rewind *rewind)
+{
+    rewind->firstFrame = (rewind->firstFrame + 1) % REWIND_MAX_FRAMES;
+    rewind->numFrames--;
+    if (rewind->checkpointFrames > 0)
+    {
+        rewind->checkpointFrames--;
+    }
+}
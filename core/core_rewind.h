@@ -0,0 +1,88 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_rewind_h
+#define core_rewind_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REWIND_DEFAULT_BUFFER_SIZE (32 * 1024 * 1024)
+#define REWIND_MAX_FRAMES (60 * 60 * 5)
+
+struct Core;
+
+struct RewindFrame {
+    size_t position;
+    size_t length;
+};
+
+/**
+ * Keeps the latest state and a ring of deltas, each one restores the state of the frame before.
+ * Deltas are XORed with the next state and run-length encoded, only RAM blocks marked dirty are compared.
+ */
+struct Rewind {
+    uint8_t *buffer;
+    size_t bufferSize;
+    size_t head;
+    struct RewindFrame frames[REWIND_MAX_FRAMES];
+    int firstFrame;
+    int numFrames;
+    
+    uint8_t *state;
+    size_t stateSize;
+    size_t stateCapacity;
+    uint8_t *nextState;
+    size_t nextStateCapacity;
+    uint8_t *delta;
+    size_t deltaCapacity;
+    
+    // history when the checkpoint was set
+    bool hasCheckpoint;
+    int checkpointFrames;
+    size_t checkpointHead;
+    uint8_t *checkpointState;
+    size_t checkpointStateSize;
+    size_t checkpointStateCapacity;
+};
+
+void rewind_start(struct Core *core, size_t bufferSize);
+void rewind_stop(struct Core *core);
+void rewind_reset(struct Core *core);
+
+/** Stores the current state, call once per frame after core_update */
+void rewind_saveFrame(struct Core *core);
+
+/** Restores the state of the frame before the last saved one, returns false if there is none */
+bool rewind_loadFrame(struct Core *core);
+
+int rewind_getNumFrames(struct Core *core);
+
+/** Remembers the history, for example when a frontend saves the state before running frames it discards again */
+void rewind_setCheckpoint(struct Core *core);
+
+/**
+ * Drops the frames saved and brings back the frames loaded since the checkpoint, call after loading its state again.
+ * If this isn't possible anymore the history is cleared and false is returned.
+ */
+bool rewind_restoreCheckpoint(struct Core *core);
+
+#endif /* core_rewind_h */
@@ -0,0 +1,592 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_state.h"
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define STATE_MAGIC 0x53584E4C // "LNXS"
+
+enum StateReference {
+    StateReferenceSimple,
+    StateReferenceArray,
+    StateReferenceDummy
+};
+
+void state_writeCore(struct Core *core, struct StateWriter *writer);
+void state_writeToken(struct StateWriter *writer, struct Interpreter *interpreter, struct Token *token);
+void state_writeString(struct StateWriter *writer, struct RCString *string);
+void state_writeReference(struct StateWriter *writer, struct Interpreter *interpreter, union Value *reference);
+void state_writeArrays(struct StateWriter *writer, struct Interpreter *interpreter);
+void state_writeSimpleVariables(struct StateWriter *writer, struct Interpreter *interpreter);
+
+void state_readCore(struct Core *core, struct StateReader *reader);
+struct Token *state_readToken(struct StateReader *reader, struct Interpreter *interpreter);
+struct RCString *state_readString(struct StateReader *reader, struct Interpreter *interpreter);
+union Value *state_readReference(struct StateReader *reader, struct Interpreter *interpreter);
+void state_readArrays(struct StateReader *reader, struct Interpreter *interpreter);
+void state_readSimpleVariables(struct StateReader *reader, struct Interpreter *interpreter);
+
+
+size_t state_getSize(struct Core *core)
+{
+    if (!core->interpreter->program) return 0;
+    
+    struct StateWriter writer = {NULL, 0, 0};
+    state_writeCore(core, &writer);
+    return writer.position;
+}
+
+bool state_save(struct Core *core, void *data, size_t size)
+{
+    if (!core->interpreter->program) return false;
+    
+    struct StateWriter writer = {data, size, 0};
+    state_writeCore(core, &writer);
+    return writer.position <= size;
+}
+
+bool state_load(struct Core *core, const void *data, size_t size)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    if (!interpreter->program) return false;
+    
+    // check header before changing anything
+    struct StateReader reader = {data, size, 0, false};
+    uint32_t magic = state_readInt(&reader);
+    uint32_t version = state_readInt(&reader);
+    uint32_t totalSize = state_readInt(&reader);
+    uint32_t sourceCodeHash = state_readInt(&reader);
+    int numTokens = state_readInt(&reader);
+    if (   reader.hasFailed
+        || magic != STATE_MAGIC
+        || version != STATE_VERSION
+        || totalSize > size
+        || sourceCodeHash != interpreter->program->sourceCodeHash
+        || numTokens != interpreter->program->tokenizer.numTokens)
+    {
+        return false;
+    }
+    reader.size = totalSize;
+    
+    state_readCore(core, &reader);
+    if (reader.hasFailed)
+    {
+        // inconsistent data, the program can't continue
+        itp_endProgram(core);
+        return false;
+    }
+    return true;
+}
+
+void state_writeCore(struct Core *core, struct StateWriter *writer)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    size_t start = writer->position;
+    
+    // header
+    state_writeInt(writer, STATE_MAGIC);
+    state_writeInt(writer, STATE_VERSION);
+    size_t totalSizePosition = writer->position;
+    state_writeInt(writer, 0);
+    state_writeInt(writer, interpreter->program->sourceCodeHash);
+    state_writeInt(writer, interpreter->program->tokenizer.numTokens);
+    
+    // structures stored as they are must match
+    state_writeInt(writer, sizeof(struct MachineInternals));
+    state_writeInt(writer, sizeof(struct TextLib));
+    state_writeInt(writer, sizeof(struct AudioLib));
+    state_writeInt(writer, sizeof(struct Overlay));
+    
+    // RAM and registers, ROM doesn't change
+    state_write(writer, core->machine, STATE_RAM_SIZE);
+    // dirty blocks depend on the host, everything is dirty after loading
+    size_t dirtyBlocksOffset = offsetof(struct MachineInternals, dirtyBlocks);
+    state_write(writer, core->machineInternals, dirtyBlocksOffset);
+    for (size_t i = dirtyBlocksOffset; i < sizeof(struct MachineInternals); i += sizeof(int32_t))
+    {
+        state_writeInt(writer, 0);
+    }
+    state_write(writer, core->overlay, sizeof(struct Overlay));
+    
+    // interpreter
+    state_writeInt(writer, interpreter->state);
+    state_writeInt(writer, interpreter->mode);
+    state_writeInt(writer, interpreter->interruptType);
+    state_writeToken(writer, interpreter, interpreter->pc);
+    state_writeInt(writer, interpreter->subLevel);
+    state_writeInt(writer, interpreter->cycles);
+    state_writeInt(writer, interpreter->interruptOverCycles);
+    state_writeInt(writer, interpreter->handlesPause);
+    state_writeInt(writer, interpreter->cpuLoadDisplay);
+    state_writeInt(writer, interpreter->cpuLoadMax);
+    state_writeInt(writer, interpreter->cpuLoadTimer);
+    
+    state_writeInt(writer, interpreter->numLabelStackItems);
+    for (int i = 0; i < interpreter->numLabelStackItems; i++)
+    {
+        struct LabelStackItem *item = &interpreter->labelStackItems[i];
+        state_writeInt(writer, item->type);
+        state_writeToken(writer, interpreter, item->token);
+    }
+    state_writeInt(writer, interpreter->isSingleLineIf);
+    
+    // arrays first, simple variables can reference their elements
+    state_writeArrays(writer, interpreter);
+    state_writeSimpleVariables(writer, interpreter);
+    
+    state_writeToken(writer, interpreter, interpreter->currentDataToken);
+    state_writeToken(writer, interpreter, interpreter->currentDataValueToken);
+    state_writeToken(writer, interpreter, interpreter->currentOnRasterToken);
+    state_writeToken(writer, interpreter, interpreter->currentOnVBLToken);
+    
+    state_writeInt(writer, interpreter->waitCount);
+    state_writeInt(writer, interpreter->exitEvaluation);
+    state_write(writer, interpreter->lastFrameGamepads, sizeof(interpreter->lastFrameGamepads));
+    state_write(writer, &interpreter->lastFrameIOStatus, sizeof(interpreter->lastFrameIOStatus));
+    state_write(writer, &interpreter->timer, sizeof(interpreter->timer));
+    state_writeInt(writer, interpreter->seed);
+    state_writeInt(writer, interpreter->isKeyboardOptional);
+    
+    state_write(writer, &interpreter->textLib, sizeof(struct TextLib));
+    state_writeInt(writer, interpreter->spritesLib.lastHit);
+    state_write(writer, &interpreter->audioLib, sizeof(struct AudioLib));
+    
+    // now the size is known
+    uint32_t totalSize = (uint32_t)(writer->position - start);
+    if (writer->data && totalSizePosition + sizeof(uint32_t) <= writer->size)
+    {
+        memcpy(&writer->data[totalSizePosition], &totalSize, sizeof(uint32_t));
+    }
+}
+
+void state_readCore(struct Core *core, struct StateReader *reader)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    
+    if (   state_readInt(reader) != sizeof(struct MachineInternals)
+        || state_readInt(reader) != sizeof(struct TextLib)
+        || state_readInt(reader) != sizeof(struct AudioLib)
+        || state_readInt(reader) != sizeof(struct Overlay))
+    {
+        reader->hasFailed = true;
+        return;
+    }
+    
+    state_read(reader, core->machine, STATE_RAM_SIZE);
+    state_read(reader, core->machineInternals, sizeof(struct MachineInternals));
+    state_read(reader, core->overlay, sizeof(struct Overlay));
+    core->overlay->textLib.core = core;
+    machine_markDirty(core, 0x8000, 0x8000);
+    
+    interpreter->state = state_readInt(reader);
+    interpreter->mode = state_readInt(reader);
+    interpreter->interruptType = state_readInt(reader);
+    interpreter->pc = state_readToken(reader, interpreter);
+    interpreter->subLevel = state_readInt(reader);
+    interpreter->cycles = state_readInt(reader);
+    interpreter->interruptOverCycles = state_readInt(reader);
+    interpreter->handlesPause = state_readInt(reader);
+    interpreter->cpuLoadDisplay = state_readInt(reader);
+    interpreter->cpuLoadMax = state_readInt(reader);
+    interpreter->cpuLoadTimer = state_readInt(reader);
+    
+    int numLabelStackItems = state_readInt(reader);
+    if (numLabelStackItems < 0 || numLabelStackItems > MAX_LABEL_STACK_ITEMS)
+    {
+        reader->hasFailed = true;
+        return;
+    }
+    interpreter->numLabelStackItems = numLabelStackItems;
+    for (int i = 0; i < numLabelStackItems; i++)
+    {
+        struct LabelStackItem *item = &interpreter->labelStackItems[i];
+        item->type = state_readInt(reader);
+        item->token = state_readToken(reader, interpreter);
+    }
+    interpreter->isSingleLineIf = state_readInt(reader);
+    
+    var_freeSimpleVariables(interpreter, SUB_LEVEL_GLOBAL);
+    var_freeArrayVariables(interpreter, SUB_LEVEL_GLOBAL);
+    state_readArrays(reader, interpreter);
+    state_readSimpleVariables(reader, interpreter);
+    interpreter->lastVariableValue = NULL;
+    
+    interpreter->currentDataToken = state_readToken(reader, interpreter);
+    interpreter->currentDataValueToken = state_readToken(reader, interpreter);
+    interpreter->currentOnRasterToken = state_readToken(reader, interpreter);
+    interpreter->currentOnVBLToken = state_readToken(reader, interpreter);
+    
+    interpreter->waitCount = state_readInt(reader);
+    interpreter->exitEvaluation = state_readInt(reader);
+    state_read(reader, interpreter->lastFrameGamepads, sizeof(interpreter->lastFrameGamepads));
+    state_read(reader, &interpreter->lastFrameIOStatus, sizeof(interpreter->lastFrameIOStatus));
+    state_read(reader, &interpreter->timer, sizeof(interpreter->timer));
+    interpreter->seed = state_readInt(reader);
+    interpreter->isKeyboardOptional = state_readInt(reader);
+    
+    state_read(reader, &interpreter->textLib, sizeof(struct TextLib));
+    interpreter->textLib.core = core;
+    interpreter->spritesLib.lastHit = state_readInt(reader);
+    state_read(reader, &interpreter->audioLib, sizeof(struct AudioLib));
+    interpreter->audioLib.core = core;
+    
+    if (!interpreter->pc)
+    {
+        reader->hasFailed = true;
+    }
+}
+
+void state_writeArrays(struct StateWriter *writer, struct Interpreter *interpreter)
+{
+    state_writeInt(writer, interpreter->numArrayVariables);
+    for (int i = 0; i < interpreter->numArrayVariables; i++)
+    {
+        struct ArrayVariable *variable = var_getArrayVariableAt(interpreter, i);
+        state_writeInt(writer, variable->symbolIndex);
+        state_writeInt(writer, variable->subLevel);
+        state_writeInt(writer, variable->isReference);
+        state_writeInt(writer, variable->type);
+        state_writeInt(writer, variable->numDimensions);
+        for (int di = 0; di < MAX_ARRAY_DIMENSIONS; di++)
+        {
+            state_writeInt(writer, variable->dimensionSizes[di]);
+        }
+        state_writeInt(writer, variable->numValues);
+        
+        if (variable->isReference)
+        {
+            // index of the array owning the values
+            int owner = -1;
+            for (int j = 0; j < i; j++)
+            {
+                struct ArrayVariable *ownerVariable = var_getArrayVariableAt(interpreter, j);
+                if (!ownerVariable->isReference && ownerVariable->values == variable->values)
+                {
+                    owner = j;
+                    break;
+                }
+            }
+            state_writeInt(writer, owner);
+        }
+        else
+        {
+            for (int vi = 0; vi < variable->numValues; vi++)
+            {
+                union Value *value = &variable->values[vi];
+                if (variable->type == ValueTypeString)
+                {
+                    state_writeString(writer, value->stringValue);
+                }
+                else
+                {
+                    state_write(writer, &value->floatValue, sizeof(float));
+                }
+            }
+        }
+    }
+}
+
+void state_readArrays(struct StateReader *reader, struct Interpreter *interpreter)
+{
+    int numArrayVariables = state_readInt(reader);
+    if (numArrayVariables < 0 || numArrayVariables > MAX_ARRAY_VARIABLES)
+    {
+        reader->hasFailed = true;
+        return;
+    }
+    for (int i = 0; i < numArrayVariables && !reader->hasFailed; i++)
+    {
+        struct ArrayVariable *variable = var_addArrayVariable(interpreter);
+        if (!variable) exit(EXIT_FAILURE);
+        // counted when its values exist
+        interpreter->numArrayVariables = i;
+        variable->symbolIndex = state_readInt(reader);
+        variable->subLevel = state_readInt(reader);
+        variable->isReference = state_readInt(reader);
+        variable->type = state_readInt(reader);
+        variable->numDimensions = state_readInt(reader);
+        for (int di = 0; di < MAX_ARRAY_DIMENSIONS; di++)
+        {
+            variable->dimensionSizes[di] = state_readInt(reader);
+        }
+        variable->numValues = state_readInt(reader);
+        
+        int numElements = 1;
+        for (int di = 0; di < variable->numDimensions && di < MAX_ARRAY_DIMENSIONS; di++)
+        {
+            int dimensionSize = variable->dimensionSizes[di];
+            numElements = (dimensionSize >= 1 && dimensionSize <= MAX_ARRAY_SIZE) ? numElements * dimensionSize : 0;
+            if (numElements > MAX_ARRAY_SIZE) numElements = 0;
+        }
+        if (   variable->numDimensions < 1 || variable->numDimensions > MAX_ARRAY_DIMENSIONS
+            || variable->numValues < 1 || variable->numValues > MAX_ARRAY_SIZE
+            || numElements != variable->numValues)
+        {
+            reader->hasFailed = true;
+            break;
+        }
+        
+        if (variable->isReference)
+        {
+            int owner = state_readInt(reader);
+            if (owner < 0 || owner >= i)
+            {
+                reader->hasFailed = true;
+                break;
+            }
+            variable->values = var_getArrayVariableAt(interpreter, owner)->values;
+        }
+        else
+        {
+            variable->values = calloc(variable->numValues, sizeof(union Value));
+            if (!variable->values) exit(EXIT_FAILURE);
+            interpreter->numArrayVariables = i + 1;
+            
+            for (int vi = 0; vi < variable->numValues; vi++)
+            {
+                union Value *value = &variable->values[vi];
+                if (variable->type == ValueTypeString)
+                {
+                    value->stringValue = state_readString(reader, interpreter);
+                }
+                else
+                {
+                    state_read(reader, &value->floatValue, sizeof(float));
+                }
+            }
+        }
+        interpreter->numArrayVariables = i + 1;
+    }
+}
+
+void state_writeSimpleVariables(struct StateWriter *writer, struct Interpreter *interpreter)
+{
+    state_writeInt(writer, interpreter->numSimpleVariables);
+    for (int i = 0; i < interpreter->numSimpleVariables; i++)
+    {
+        struct SimpleVariable *variable = var_getSimpleVariableAt(interpreter, i);
+        state_writeInt(writer, variable->symbolIndex);
+        state_writeInt(writer, variable->subLevel);
+        state_writeInt(writer, variable->isReference);
+        state_writeInt(writer, variable->type);
+        
+        if (variable->isReference)
+        {
+            state_writeReference(writer, interpreter, variable->v.reference);
+        }
+        else if (variable->type == ValueTypeString)
+        {
+            state_writeString(writer, variable->v.stringValue);
+        }
+        else
+        {
+            state_write(writer, &variable->v.floatValue, sizeof(float));
+        }
+    }
+}
+
+void state_readSimpleVariables(struct StateReader *reader, struct Interpreter *interpreter)
+{
+    int numSimpleVariables = state_readInt(reader);
+    if (numSimpleVariables < 0 || numSimpleVariables > MAX_SIMPLE_VARIABLES)
+    {
+        reader->hasFailed = true;
+        return;
+    }
+    for (int i = 0; i < numSimpleVariables && !reader->hasFailed; i++)
+    {
+        struct SimpleVariable *variable = var_addSimpleVariable(interpreter);
+        if (!variable) exit(EXIT_FAILURE);
+        variable->symbolIndex = state_readInt(reader);
+        variable->subLevel = state_readInt(reader);
+        variable->isReference = state_readInt(reader);
+        variable->type = state_readInt(reader);
+        
+        if (variable->isReference)
+        {
+            // only the variables before this one exist yet
+            interpreter->numSimpleVariables = i;
+            variable->v.reference = state_readReference(reader, interpreter);
+        }
+        else if (variable->type == ValueTypeString)
+        {
+            variable->v.stringValue = state_readString(reader, interpreter);
+            if (!variable->v.stringValue)
+            {
+                variable->v.stringValue = interpreter->nullString;
+                rcstring_retain(variable->v.stringValue);
+            }
+        }
+        else
+        {
+            state_read(reader, &variable->v.floatValue, sizeof(float));
+        }
+        interpreter->numSimpleVariables = i + 1;
+    }
+}
+
+void state_writeReference(struct StateWriter *writer, struct Interpreter *interpreter, union Value *reference)
+{
+    for (int i = 0; i < interpreter->numSimpleVariables; i++)
+    {
+        struct SimpleVariable *variable = var_getSimpleVariableAt(interpreter, i);
+        if (!variable->isReference && &variable->v == reference)
+        {
+            state_writeInt(writer, StateReferenceSimple);
+            state_writeInt(writer, i);
+            state_writeInt(writer, 0);
+            return;
+        }
+    }
+    for (int i = 0; i < interpreter->numArrayVariables; i++)
+    {
+        struct ArrayVariable *variable = var_getArrayVariableAt(interpreter, i);
+        if (!variable->isReference && reference >= variable->values && reference < variable->values + variable->numValues)
+        {
+            state_writeInt(writer, StateReferenceArray);
+            state_writeInt(writer, i);
+            state_writeInt(writer, (int)(reference - variable->values));
+            return;
+        }
+    }
+    state_writeInt(writer, StateReferenceDummy);
+    state_writeInt(writer, 0);
+    state_writeInt(writer, 0);
+}
+
+union Value *state_readReference(struct StateReader *reader, struct Interpreter *interpreter)
+{
+    enum StateReference type = state_readInt(reader);
+    int index = state_readInt(reader);
+    int element = state_readInt(reader);
+    switch (type)
+    {
+        case StateReferenceSimple:
+            if (index >= 0 && index < interpreter->numSimpleVariables)
+            {
+                return &var_getSimpleVariableAt(interpreter, index)->v;
+            }
+            break;
+            
+        case StateReferenceArray:
+            if (index >= 0 && index < interpreter->numArrayVariables)
+            {
+                struct ArrayVariable *variable = var_getArrayVariableAt(interpreter, index);
+                if (element >= 0 && element < variable->numValues)
+                {
+                    return &variable->values[element];
+                }
+            }
+            break;
+            
+        case StateReferenceDummy:
+            return &interpreter->valueDummy;
+    }
+    reader->hasFailed = true;
+    return &interpreter->valueDummy;
+}
+
+void state_write(struct StateWriter *writer, const void *bytes, size_t length)
+{
+    if (writer->data && writer->position + length <= writer->size)
+    {
+        memcpy(&writer->data[writer->position], bytes, length);
+    }
+    writer->position += length;
+}
+
+void state_writeInt(struct StateWriter *writer, int32_t value)
+{
+    state_write(writer, &value, sizeof(int32_t));
+}
+
+void state_writeToken(struct StateWriter *writer, struct Interpreter *interpreter, struct Token *token)
+{
+    state_writeInt(writer, token ? (int32_t)(token - interpreter->program->tokenizer.tokens) : -1);
+}
+
+void state_writeString(struct StateWriter *writer, struct RCString *string)
+{
+    if (string)
+    {
+        int32_t length = (int32_t)strlen(string->chars);
+        state_writeInt(writer, length);
+        state_write(writer, string->chars, length);
+    }
+    else
+    {
+        state_writeInt(writer, -1);
+    }
+}
+
+void state_read(struct StateReader *reader, void *bytes, size_t length)
+{
+    if (reader->hasFailed || reader->position + length > reader->size)
+    {
+        reader->hasFailed = true;
+        memset(bytes, 0, length);
+        return;
+    }
+    memcpy(bytes, &reader->data[reader->position], length);
+    reader->position += length;
+}
+
+int32_t state_readInt(struct StateReader *reader)
+{
+    int32_t value;
+    state_read(reader, &value, sizeof(int32_t));
+    return value;
+}
+
+struct Token *state_readToken(struct StateReader *reader, struct Interpreter *interpreter)
+{
+    int32_t index = state_readInt(reader);
+    if (index == -1) return NULL;
+    // the program counter can be behind the last token when ended
+    if (index < 0 || index > interpreter->program->tokenizer.numTokens)
+    {
+        reader->hasFailed = true;
+        return NULL;
+    }
+    return &interpreter->program->tokenizer.tokens[index];
+}
+
+struct RCString *state_readString(struct StateReader *reader, struct Interpreter *interpreter)
+{
+    int32_t length = state_readInt(reader);
+    if (length < 0) return NULL;
+    if (length == 0)
+    {
+        rcstring_retain(interpreter->nullString);
+        return interpreter->nullString;
+    }
+    if (reader->hasFailed || reader->position + length > reader->size)
+    {
+        reader->hasFailed = true;
+        return NULL;
+    }
+    struct RCString *string = rcstring_new((const char *)&reader->data[reader->position], length);
+    if (!string) exit(EXIT_FAILURE);
+    reader->position += length;
+    return string;
+}
@@ -0,0 +1,58 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_state_h
+#define core_state_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STATE_VERSION 1
+
+// the RAM image (0x8000-0xFFFF) follows the fixed size header
+#define STATE_RAM_OFFSET 36
+#define STATE_RAM_SIZE 0x8000
+
+struct Core;
+
+struct StateWriter {
+    uint8_t *data; // NULL to count the size only
+    size_t size;
+    size_t position;
+};
+
+struct StateReader {
+    const uint8_t *data;
+    size_t size;
+    size_t position;
+    bool hasFailed;
+};
+
+size_t state_getSize(struct Core *core);
+bool state_save(struct Core *core, void *data, size_t size);
+bool state_load(struct Core *core, const void *data, size_t size);
+
+void state_write(struct StateWriter *writer, const void *bytes, size_t length);
+void state_writeInt(struct StateWriter *writer, int32_t value);
+void state_read(struct StateReader *reader, void *bytes, size_t length);
+int32_t state_readInt(struct StateReader *reader);
+
+#endif /* core_state_h */
@@ -21,7 +21,7 @@
 #include "core_stats.h"
 #include <string.h>
 #include <stdlib.h>
-#include "string_utils.h"
+#include "core.h"
 
 void stats_init(struct Stats *stats)
 {
@@ -56,14 +56,7 @@ struct CoreError stats_update(struct Stats *stats, const char *sourceCode)
     
     struct CoreError error = err_noCoreError();
     
-    const char *upperCaseSourceCode = uppercaseString(sourceCode);
-    if (!upperCaseSourceCode)
-    {
-        error = err_makeCoreError(ErrorOutOfMemory, -1);
-        goto cleanup;
-    }
-    
-    error = tok_tokenizeUppercaseProgram(stats->tokenizer, upperCaseSourceCode);
+    error = tok_tokenizeProgram(stats->tokenizer, sourceCode);
     if (error.code != ErrorNone)
     {
         goto cleanup;
@@ -72,7 +65,7 @@ struct CoreError stats_update(struct Stats *stats, const char *sourceCode)
     stats->numTokens = stats->tokenizer->numTokens;
     
     struct DataManager *romDataManager = stats->romDataManager;
-    error = data_uppercaseImport(romDataManager, upperCaseSourceCode, false);
+    error = data_import(romDataManager, sourceCode, false);
     if (error.code != ErrorNone)
     {
         goto cleanup;
@@ -89,10 +82,32 @@ struct CoreError stats_update(struct Stats *stats, const char *sourceCode)
     
 cleanup:
     tok_freeTokens(stats->tokenizer);
-    if (upperCaseSourceCode)
+    
+    return error;
+}
+
+struct CoreMemoryStats stats_getCoreMemory(struct Core *core)
+{
+    struct CoreMemoryStats memory;
+    memset(&memory, 0, sizeof(struct CoreMemoryStats));
+    
+    memory.core = sizeof(struct Core)
+        + sizeof(struct Machine)
+        + sizeof(struct MachineInternals)
+        + sizeof(struct Interpreter)
+        + sizeof(struct DiskDrive)
+        + sizeof(struct Overlay)
+        + sizeof(struct Metrics);
+    if (core->diskDrive->dataManager.data)
     {
-        free((void *)upperCaseSourceCode);
+        memory.core += DATA_SIZE;
     }
     
-    return error;
+    memory.variables = var_getMemorySize(core->interpreter);
+    
+    if (core->interpreter->program)
+    {
+        memory.program = prg_getMemorySize(core->interpreter->program);
+    }
+    return memory;
 }
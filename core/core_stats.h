@@ -33,8 +33,18 @@ struct Stats {
     int romSize;
 };
 
+// Memory used by one core. The program is shared by all cores running it.
+struct CoreMemoryStats {
+    size_t core;
+    size_t variables;
+    size_t program;
+};
+
+struct Core;
+
 void stats_init(struct Stats *stats);
 void stats_deinit(struct Stats *stats);
 struct CoreError stats_update(struct Stats *stats, const char *sourceCode);
+struct CoreMemoryStats stats_getCoreMemory(struct Core *core);
 
 #endif /* core_stats_h */
@@ -0,0 +1,158 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "core_trace.h"
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+
+const char *TraceStageNames[NUM_CORE_STAGES] = {
+    "Idle",
+    "Input",
+    "VBL Interrupt",
+    "Main Program",
+    "System",
+    "Video",
+    "Raster Interrupt",
+    "Audio"
+};
+
+const char *TraceThreadNames[TRACE_NUM_THREADS] = {"Main", "Audio", "Present"};
+
+void trace_addEvent(struct Core *core, enum TraceThread thread, const char *name, char phase);
+
+
+void trace_start(struct Core *core)
+{
+    if (!core->tracer)
+    {
+        core->tracer = calloc(1, sizeof(struct Tracer));
+        if (!core->tracer) exit(EXIT_FAILURE);
+    }
+}
+
+void trace_stop(struct Core *core)
+{
+    if (core->tracer)
+    {
+        free(core->tracer);
+        core->tracer = NULL;
+    }
+}
+
+void trace_begin(struct Core *core, enum TraceThread thread, const char *name)
+{
+    if (core->tracer)
+    {
+        trace_addEvent(core, thread, name, 'B');
+    }
+}
+
+void trace_end(struct Core *core, enum TraceThread thread, const char *name)
+{
+    if (core->tracer)
+    {
+        trace_addEvent(core, thread, name, 'E');
+    }
+}
+
+void trace_instant(struct Core *core, enum TraceThread thread, const char *name)
+{
+    if (core->tracer)
+    {
+        trace_addEvent(core, thread, name, 'i');
+    }
+}
+
+void trace_stageDidChange(struct Core *core, enum CoreStage oldStage, enum CoreStage newStage)
+{
+    if (core->tracer)
+    {
+        if (oldStage != CoreStageIdle)
+        {
+            trace_addEvent(core, TraceThreadMain, TraceStageNames[oldStage], 'E');
+        }
+        if (newStage != CoreStageIdle)
+        {
+            trace_addEvent(core, TraceThreadMain, TraceStageNames[newStage], 'B');
+        }
+    }
+}
+
+void trace_addEvent(struct Core *core, enum TraceThread thread, const char *name, char phase)
+{
+    struct TraceRing *ring = &core->tracer->rings[thread];
+    struct TraceEvent *event = &ring->events[ring->count % TRACE_RING_SIZE];
+    event->time = delegate_getHostTime(core);
+    event->name = name;
+    event->phase = phase;
+    ring->count++;
+}
+
+void trace_write(struct Core *core, FILE *file)
+{
+    struct Tracer *tracer = core->tracer;
+    if (!tracer) return;
+    
+    // timestamps relative to the oldest event
+    uint64_t baseTime = UINT64_MAX;
+    for (int thread = 0; thread < TRACE_NUM_THREADS; thread++)
+    {
+        struct TraceRing *ring = &tracer->rings[thread];
+        uint32_t first = (ring->count > TRACE_RING_SIZE) ? ring->count - TRACE_RING_SIZE : 0;
+        if (ring->count > first && ring->events[first % TRACE_RING_SIZE].time < baseTime)
+        {
+            baseTime = ring->events[first % TRACE_RING_SIZE].time;
+        }
+    }
+    
+    fputs("{\"traceEvents\":[\n", file);
+    for (int thread = 0; thread < TRACE_NUM_THREADS; thread++)
+    {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", thread + 1, TraceThreadNames[thread]);
+        
+        struct TraceRing *ring = &tracer->rings[thread];
+        uint32_t count = ring->count;
+        uint32_t first = (count > TRACE_RING_SIZE) ? count - TRACE_RING_SIZE : 0;
+        int depth = 0;
+        for (uint32_t i = first; i < count; i++)
+        {
+            struct TraceEvent *event = &ring->events[i % TRACE_RING_SIZE];
+            if (event->phase == 'E')
+            {
+                // its begin was overwritten
+                if (depth == 0) continue;
+                depth--;
+            }
+            else if (event->phase == 'B')
+            {
+                depth++;
+            }
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d%s},\n",
+                    event->name,
+                    event->phase,
+                    (event->time - baseTime) / 1000.0,
+                    thread + 1,
+                    event->phase == 'i' ? ",\"s\":\"t\"" : "");
+        }
+    }
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"LowRes NX\"}}\n", file);
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+}
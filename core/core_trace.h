@@ -0,0 +1,67 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef core_trace_h
+#define core_trace_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include "core_delegate.h"
+
+#define TRACE_RING_SIZE 262144
+#define TRACE_NUM_THREADS 3
+
+struct Core;
+
+enum TraceThread {
+    TraceThreadMain,
+    TraceThreadAudio,
+    TraceThreadPresent
+};
+
+struct TraceEvent {
+    uint64_t time;
+    const char *name;
+    char phase;
+};
+
+/** Keeps the latest TRACE_RING_SIZE events of one thread, only written by that thread */
+struct TraceRing {
+    struct TraceEvent events[TRACE_RING_SIZE];
+    uint32_t count;
+};
+
+struct Tracer {
+    struct TraceRing rings[TRACE_NUM_THREADS];
+};
+
+void trace_start(struct Core *core);
+void trace_stop(struct Core *core);
+
+/** Event names must be constant strings. All functions do nothing if tracing is off. */
+void trace_begin(struct Core *core, enum TraceThread thread, const char *name);
+void trace_end(struct Core *core, enum TraceThread thread, const char *name);
+void trace_instant(struct Core *core, enum TraceThread thread, const char *name);
+void trace_stageDidChange(struct Core *core, enum CoreStage oldStage, enum CoreStage newStage);
+
+/** Writes all events in the Chrome trace event format, which can be opened in chrome://tracing or Perfetto */
+void trace_write(struct Core *core, FILE *file);
+
+#endif /* core_trace_h */
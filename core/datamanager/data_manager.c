@@ -25,7 +25,11 @@
 #include <assert.h>
 #include "string_utils.h"
 
+#define DATA_BINARY_MAGIC 0x444E584C // "LNXD"
+
 int data_calcOutputSize(struct DataManager *manager);
+void data_writeBinaryInt(uint8_t *output, uint32_t value);
+uint32_t data_readBinaryInt(const uint8_t *input);
 
 void data_init(struct DataManager *manager)
 {
@@ -59,25 +63,12 @@ void data_reset(struct DataManager *manager)
     }
 }
 
+/** Reads the input in place, in any case */
 struct CoreError data_import(struct DataManager *manager, const char *input, bool keepSourceCode)
 {
     assert(manager);
     assert(input);
     
-    const char *uppercaseInput = uppercaseString(input);
-    if (!uppercaseInput) return err_makeCoreError(ErrorOutOfMemory, -1);
-    
-    struct CoreError error = data_uppercaseImport(manager, uppercaseInput, keepSourceCode);
-    free((void *)uppercaseInput);
-    
-    return error;
-}
-
-struct CoreError data_uppercaseImport(struct DataManager *manager, const char *input, bool keepSourceCode)
-{
-    assert(manager);
-    assert(input);
-    
     data_reset(manager);
     
     const char *character = input;
@@ -113,7 +104,7 @@ struct CoreError data_uppercaseImport(struct DataManager *manager, const char *i
             int entryIndex = 0;
             while (*character)
             {
-                if (strchr(CharSetDigits, *character))
+                if (*character >= '0' && *character <= '9')
                 {
                     int digit = (int)*character - (int)'0';
                     entryIndex *= 10;
@@ -143,7 +134,10 @@ struct CoreError data_uppercaseImport(struct DataManager *manager, const char *i
             size_t commentLen = (character - comment);
             if (commentLen >= ENTRY_COMMENT_SIZE) commentLen = ENTRY_COMMENT_SIZE - 1;
             memset(entry->comment, 0, ENTRY_COMMENT_SIZE);
-            strncpy(entry->comment, comment, commentLen);
+            for (size_t i = 0; i < commentLen; i++)
+            {
+                entry->comment[i] = CharSetUppercase[(uint8_t)comment[i]];
+            }
             
             // binary data
             uint8_t *startByte = currentDataByte;
@@ -151,10 +145,9 @@ struct CoreError data_uppercaseImport(struct DataManager *manager, const char *i
             int value = 0;
             while (*character && *character != '#')
             {
-                char *spos = strchr(CharSetHex, *character);
-                if (spos)
+                int digit = CharSetHexValues[CharSetUppercase[(uint8_t)*character]];
+                if (digit >= 0)
                 {
-                    int digit = (int)(spos - CharSetHex);
                     if (shift)
                     {
                         value = digit << 4;
@@ -239,30 +232,135 @@ char *data_export(struct DataManager *manager)
                     uint8_t *entryData = &manager->data[entry->start];
                     while (pos < entry->length)
                     {
-                        sprintf(current, "%02X", entryData[pos]);
-                        current += strlen(current);
+                        uint8_t value = entryData[pos];
+                        *current++ = CharSetHex[value >> 4];
+                        *current++ = CharSetHex[value & 0x0F];
                         pos++;
                         valuesInLine++;
                         if (pos == entry->length)
                         {
-                            sprintf(current, "\n\n");
+                            *current++ = '\n';
+                            *current++ = '\n';
                         }
                         else if (valuesInLine == 16)
                         {
-                            sprintf(current, "\n");
+                            *current++ = '\n';
                             valuesInLine = 0;
                         }
-                        current += strlen(current);
                     }
-                    
                 }
             }
+            *current = 0;
         }
         return output;
     }
     return NULL;
 }
 
+/** Reads a binary disk image. The data isn't converted, so this is much faster than data_import. */
+struct CoreError data_importBinary(struct DataManager *manager, const uint8_t *input, size_t size, bool keepSourceCode)
+{
+    assert(manager);
+    assert(input);
+    
+    data_reset(manager);
+    
+    if (   size < DATA_BINARY_DATA_OFFSET + DATA_SIZE
+        || data_readBinaryInt(input) != DATA_BINARY_MAGIC
+        || data_readBinaryInt(input + 4) != DATA_BINARY_VERSION
+        || data_readBinaryInt(input + 8) != DATA_SIZE)
+    {
+        return err_makeCoreError(ErrorInvalidDiskImage, -1);
+    }
+    uint32_t sourceLength = data_readBinaryInt(input + 12);
+    if (sourceLength > size - DATA_BINARY_DATA_OFFSET - DATA_SIZE)
+    {
+        return err_makeCoreError(ErrorInvalidDiskImage, -1);
+    }
+    
+    int start = 0;
+    for (int i = 0; i < MAX_ENTRIES; i++)
+    {
+        const uint8_t *record = input + DATA_BINARY_HEADER_SIZE + i * DATA_BINARY_ENTRY_SIZE;
+        uint32_t length = data_readBinaryInt(record + ENTRY_COMMENT_SIZE);
+        if (length > DATA_SIZE - start)
+        {
+            data_reset(manager);
+            return err_makeCoreError(ErrorInvalidDiskImage, -1);
+        }
+        
+        struct DataEntry *entry = &manager->entries[i];
+        memcpy(entry->comment, record, ENTRY_COMMENT_SIZE);
+        entry->comment[ENTRY_COMMENT_SIZE - 1] = 0;
+        entry->start = start;
+        entry->length = length;
+        start += length;
+    }
+    
+    memcpy(manager->data, input + DATA_BINARY_DATA_OFFSET, DATA_SIZE);
+    
+    if (keepSourceCode)
+    {
+        char *diskSourceCode = malloc(sourceLength + 1);
+        if (!diskSourceCode) exit(EXIT_FAILURE);
+        
+        memcpy(diskSourceCode, input + DATA_BINARY_DATA_OFFSET + DATA_SIZE, sourceLength);
+        diskSourceCode[sourceLength] = 0;
+        manager->diskSourceCode = diskSourceCode;
+    }
+    
+    return err_noCoreError();
+}
+
+size_t data_getBinarySize(struct DataManager *manager)
+{
+    size_t size = DATA_BINARY_DATA_OFFSET + DATA_SIZE;
+    if (manager->diskSourceCode)
+    {
+        size += strlen(manager->diskSourceCode);
+    }
+    return size;
+}
+
+/** Writes the whole binary disk image, of data_getBinarySize */
+void data_exportBinary(struct DataManager *manager, uint8_t *output)
+{
+    assert(manager);
+    
+    data_exportBinaryHeader(manager, output);
+    memcpy(output + DATA_BINARY_DATA_OFFSET, manager->data, DATA_SIZE);
+    if (manager->diskSourceCode)
+    {
+        memcpy(output + DATA_BINARY_DATA_OFFSET + DATA_SIZE, manager->diskSourceCode, strlen(manager->diskSourceCode));
+    }
+}
+
+/** Writes the header and entry records of the binary disk image, the first DATA_BINARY_DATA_OFFSET bytes */
+void data_exportBinaryHeader(struct DataManager *manager, uint8_t *output)
+{
+    assert(manager);
+    
+    data_writeBinaryInt(output, DATA_BINARY_MAGIC);
+    data_writeBinaryInt(output + 4, DATA_BINARY_VERSION);
+    data_writeBinaryInt(output + 8, DATA_SIZE);
+    data_writeBinaryInt(output + 12, manager->diskSourceCode ? (uint32_t)strlen(manager->diskSourceCode) : 0);
+    
+    for (int i = 0; i < MAX_ENTRIES; i++)
+    {
+        struct DataEntry *entry = &manager->entries[i];
+        uint8_t *record = output + DATA_BINARY_HEADER_SIZE + i * DATA_BINARY_ENTRY_SIZE;
+        memcpy(record, entry->comment, ENTRY_COMMENT_SIZE);
+        data_writeBinaryInt(record + ENTRY_COMMENT_SIZE, entry->length);
+    }
+}
+
+/** Call when the changed data was written */
+void data_clearChanges(struct DataManager *manager)
+{
+    manager->changedStart = 0;
+    manager->changedEnd = 0;
+}
+
 int data_calcOutputSize(struct DataManager *manager)
 {
     int size = 0;
@@ -308,11 +406,30 @@ bool data_canSetEntry(struct DataManager *manager, int index, int length)
     return size + length <= DATA_SIZE;
 }
 
-void data_setEntry(struct DataManager *manager, int index, const char *comment, uint8_t *source, int length)
+void data_setEntry(struct DataManager *manager, int index, const char *comment, const uint8_t *source, int length)
 {
     struct DataEntry *entry = &manager->entries[index];
     uint8_t *data = manager->data;
-        
+    
+    // changed data, including the moved data of higher entries
+    int changedEnd = entry->start + length;
+    if (length != entry->length)
+    {
+        int oldSize = data_currentSize(manager);
+        int newSize = oldSize - entry->length + length;
+        changedEnd = (oldSize > newSize) ? oldSize : newSize;
+    }
+    if (manager->changedEnd > manager->changedStart)
+    {
+        if (entry->start < manager->changedStart) manager->changedStart = entry->start;
+        if (changedEnd > manager->changedEnd) manager->changedEnd = changedEnd;
+    }
+    else
+    {
+        manager->changedStart = entry->start;
+        manager->changedEnd = changedEnd;
+    }
+    
     // move data of higher entries
     int nextStart = entry->start + length;
     assert(nextStart <= DATA_SIZE);
@@ -356,3 +473,16 @@ void data_setEntry(struct DataManager *manager, int index, const char *comment,
         thisEntry->start = prevEntry->start + prevEntry->length;
     }
 }
+
+void data_writeBinaryInt(uint8_t *output, uint32_t value)
+{
+    output[0] = value;
+    output[1] = value >> 8;
+    output[2] = value >> 16;
+    output[3] = value >> 24;
+}
+
+uint32_t data_readBinaryInt(const uint8_t *input)
+{
+    return input[0] | (input[1] << 8) | (input[2] << 16) | ((uint32_t)input[3] << 24);
+}
@@ -30,6 +30,12 @@
 #define DATA_SIZE 0x8000
 #define ENTRY_COMMENT_SIZE 32
 
+// binary disk image: header, entry records (comment, length), all data, source code before the entries
+#define DATA_BINARY_VERSION 1
+#define DATA_BINARY_HEADER_SIZE 16
+#define DATA_BINARY_ENTRY_SIZE (ENTRY_COMMENT_SIZE + 4)
+#define DATA_BINARY_DATA_OFFSET (DATA_BINARY_HEADER_SIZE + MAX_ENTRIES * DATA_BINARY_ENTRY_SIZE)
+
 struct DataEntry {
     char comment[ENTRY_COMMENT_SIZE];
     int start;
@@ -40,18 +46,26 @@ struct DataManager {
     struct DataEntry entries[MAX_ENTRIES];
     uint8_t *data;
     const char *diskSourceCode;
+    
+    // data bytes changed by data_setEntry since the last import or data_clearChanges
+    int changedStart;
+    int changedEnd;
 };
 
 void data_init(struct DataManager *manager);
 void data_deinit(struct DataManager *manager);
 void data_reset(struct DataManager *manager);
 struct CoreError data_import(struct DataManager *manager, const char *input, bool keepSourceCode);
-struct CoreError data_uppercaseImport(struct DataManager *manager, const char *input, bool keepSourceCode);
 char *data_export(struct DataManager *manager);
+struct CoreError data_importBinary(struct DataManager *manager, const uint8_t *input, size_t size, bool keepSourceCode);
+size_t data_getBinarySize(struct DataManager *manager);
+void data_exportBinary(struct DataManager *manager, uint8_t *output);
+void data_exportBinaryHeader(struct DataManager *manager, uint8_t *output);
+void data_clearChanges(struct DataManager *manager);
 
 int data_currentSize(struct DataManager *manager);
 
 bool data_canSetEntry(struct DataManager *manager, int index, int length);
-void data_setEntry(struct DataManager *manager, int index, const char *comment, uint8_t *source, int length);
+void data_setEntry(struct DataManager *manager, int index, const char *comment, const uint8_t *source, int length);
 
 #endif /* data_manager_h */
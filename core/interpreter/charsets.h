@@ -21,9 +21,17 @@
 #ifndef charsets_h
 #define charsets_h
 
+#include <stdint.h>
+
 extern const char *CharSetDigits;
 extern const char *CharSetLetters;
 extern const char *CharSetAlphaNum;
 extern const char *CharSetHex;
 
+// value of each hex digit character (upper case only), -1 for all other characters
+extern const int8_t CharSetHexValues[256];
+
+// each character in upper case, so source code can be read in any case
+extern const uint8_t CharSetUppercase[256];
+
 #endif /* charsets_h */
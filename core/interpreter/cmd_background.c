@@ -610,11 +610,7 @@ enum ErrorCode cmd_TINT(struct Core *core)
     
     if (interpreter->pass == PassRun)
     {
-        struct Cell *cell = txtlib_getCell(&interpreter->textLib, floorf(xValue.v.floatValue), floorf(yValue.v.floatValue));
-        if (attrs.pal >= 0) cell->attr.palette = attrs.pal;
-        if (attrs.flipX >= 0) cell->attr.flipX = attrs.flipX;
-        if (attrs.flipY >= 0) cell->attr.flipY = attrs.flipY;
-        if (attrs.prio >= 0) cell->attr.priority = attrs.prio;
+        txtlib_setCellAttr(&interpreter->textLib, floorf(xValue.v.floatValue), floorf(yValue.v.floatValue), attrs.pal, attrs.flipX, attrs.flipY, attrs.prio);
     }
     
     return itp_endOfCommand(interpreter);
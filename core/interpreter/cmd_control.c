@@ -375,7 +375,7 @@ enum ErrorCode cmd_GOTO(struct Core *core)
 
     if (interpreter->pass == PassPrepare)
     {
-        struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->tokenizer, tokenIdentifier->symbolIndex);
+        struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->program->tokenizer, tokenIdentifier->symbolIndex);
         if (!item) return ErrorUndefinedLabel;
         tokenGOTO->jumpToken = item->token;
         
@@ -403,7 +403,7 @@ enum ErrorCode cmd_GOSUB(struct Core *core)
     
     if (interpreter->pass == PassPrepare)
     {
-        struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->tokenizer, tokenIdentifier->symbolIndex);
+        struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->program->tokenizer, tokenIdentifier->symbolIndex);
         if (!item) return ErrorUndefinedLabel;
         tokenGOSUB->jumpToken = item->token;
         
@@ -439,7 +439,7 @@ enum ErrorCode cmd_RETURN(struct Core *core)
     {
         if (tokenIdentifier)
         {
-            struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->tokenizer, tokenIdentifier->symbolIndex);
+            struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->program->tokenizer, tokenIdentifier->symbolIndex);
             if (!item) return ErrorUndefinedLabel;
             tokenRETURN->jumpToken = item->token;
         }
@@ -547,7 +547,7 @@ enum ErrorCode cmd_ON(struct Core *core)
         
         if (interpreter->pass == PassPrepare)
         {
-            struct SubItem *item = tok_getSub(&interpreter->tokenizer, tokenIdentifier->symbolIndex);
+            struct SubItem *item = tok_getSub(&interpreter->program->tokenizer, tokenIdentifier->symbolIndex);
             if (!item) return ErrorUndefinedSubprogram;
             tokenCALL->jumpToken = item->token;
         }
@@ -27,15 +27,15 @@ enum ErrorCode cmd_DATA(struct Core *core)
     
     if (interpreter->pass == PassPrepare)
     {
-        if (!interpreter->firstData)
+        if (!interpreter->program->firstData)
         {
-            interpreter->firstData = interpreter->pc;
+            interpreter->program->firstData = interpreter->pc;
         }
-        if (interpreter->lastData)
+        if (interpreter->program->lastData)
         {
-            interpreter->lastData->jumpToken = interpreter->pc;
+            interpreter->program->lastData->jumpToken = interpreter->pc;
         }
-        interpreter->lastData = interpreter->pc;
+        interpreter->program->lastData = interpreter->pc;
     }
     
     do
@@ -133,7 +133,7 @@ enum ErrorCode cmd_RESTORE(struct Core *core)
     {
         if (interpreter->pass == PassPrepare)
         {
-            struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->tokenizer, interpreter->pc->symbolIndex);
+            struct JumpLabelItem *item = tok_getJumpLabel(&interpreter->program->tokenizer, interpreter->pc->symbolIndex);
             if (!item) return ErrorUndefinedLabel;
             tokenRESTORE->jumpToken = item->token;
         }
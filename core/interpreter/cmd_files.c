@@ -203,6 +203,7 @@ struct TypedValue fnc_FILE(struct Core *core)
         
         size_t len = strlen(entry->comment);
         resultValue.v.stringValue = rcstring_new(entry->comment, len);
+        core->metrics->frame.numStringAllocations++;
         rcstring_retain(resultValue.v.stringValue);
         interpreter->cycles += len;
     }
@@ -181,11 +181,8 @@ enum ErrorCode cmd_FILL(struct Core *core)
     {
         int start = startValue.v.floatValue;
         int length = lengthValue.v.floatValue;
-        for (int i = 0; i < length; i++)
-        {
-            bool poke = machine_poke(core, start + i, fill);
-            if (!poke) return ErrorIllegalMemoryAccess;
-        }
+        bool poke = machine_fill(core, start, length, fill);
+        if (!poke) return ErrorIllegalMemoryAccess;
         interpreter->cycles += length;
     }
     
@@ -222,26 +219,8 @@ enum ErrorCode cmd_COPY(struct Core *core)
         int source = sourceValue.v.floatValue;
         int length = lengthValue.v.floatValue;
         int destination = destinationValue.v.floatValue;
-        if (source < destination)
-        {
-            for (int i = length - 1; i >= 0; i--)
-            {
-                int peek = machine_peek(core, source + i);
-                if (peek == -1) return ErrorIllegalMemoryAccess;
-                bool poke = machine_poke(core, destination + i, peek);
-                if (!poke) return ErrorIllegalMemoryAccess;
-            }
-        }
-        else if (source > destination)
-        {
-            for (int i = 0; i < length; i++)
-            {
-                int peek = machine_peek(core, source + i);
-                if (peek == -1) return ErrorIllegalMemoryAccess;
-                bool poke = machine_poke(core, destination + i, peek);
-                if (!poke) return ErrorIllegalMemoryAccess;
-            }
-        }
+        bool copy = machine_copy(core, source, length, destination);
+        if (!copy) return ErrorIllegalMemoryAccess;
         interpreter->cycles += length;
     }
     
@@ -276,11 +255,11 @@ struct TypedValue fnc_ROM_SIZE(struct Core *core)
         int index = indexValue.v.floatValue;
         if (type == TokenSIZE)
         {
-            value.v.floatValue = interpreter->romDataManager.entries[index].length;
+            value.v.floatValue = interpreter->program->romDataManager.entries[index].length;
         }
         else
         {
-            value.v.floatValue = interpreter->romDataManager.entries[index].start;
+            value.v.floatValue = interpreter->program->romDataManager.entries[index].start;
         }
     }
     return value;
@@ -101,6 +101,7 @@ struct TypedValue fnc_BIN_HEX(struct Core *core)
         
         struct RCString *rcstring = rcstring_new(NULL, maxLen);
         if (!rcstring) return val_makeError(ErrorOutOfMemory);
+        core->metrics->frame.numStringAllocations++;
         
         if (type == TokenBIN)
         {
@@ -143,6 +144,7 @@ struct TypedValue fnc_CHR(struct Core *core)
         char ch = numericValue.v.floatValue;
         struct RCString *rcstring = rcstring_new(&ch, 1);
         if (!rcstring) return val_makeError(ErrorOutOfMemory);
+        core->metrics->frame.numStringAllocations++;
         
         resultValue.v.stringValue = rcstring;
         interpreter->cycles += 1;
@@ -171,6 +173,7 @@ struct TypedValue fnc_INKEY(struct Core *core)
             
             struct RCString *rcstring = rcstring_new(&key, 1);
             if (!rcstring) return val_makeError(ErrorOutOfMemory);
+            core->metrics->frame.numStringAllocations++;
             
             resultValue.v.stringValue = rcstring;
             interpreter->cycles += 1;
@@ -297,6 +300,7 @@ struct TypedValue fnc_LEFTStr_RIGHTStr(struct Core *core)
             
             struct RCString *rcstring = rcstring_new(&stringValue.v.stringValue->chars[start], number);
             if (!rcstring) return val_makeError(ErrorOutOfMemory);
+            core->metrics->frame.numStringAllocations++;
             
             resultValue.v.stringValue = rcstring;
             interpreter->cycles += number;
@@ -401,6 +405,7 @@ struct TypedValue fnc_MID(struct Core *core)
             }
             struct RCString *rcstring = rcstring_new(&stringValue.v.stringValue->chars[index], number);
             if (!rcstring) return val_makeError(ErrorOutOfMemory);
+            core->metrics->frame.numStringAllocations++;
             
             resultValue.v.stringValue = rcstring;
             interpreter->cycles += number;
@@ -442,6 +447,7 @@ struct TypedValue fnc_STR(struct Core *core)
     {
         struct RCString *rcstring = rcstring_new(NULL, 20);
         if (!rcstring) return val_makeError(ErrorOutOfMemory);
+        core->metrics->frame.numStringAllocations++;
         
         snprintf(rcstring->chars, 20, "%0.7g", numericValue.v.floatValue);
         resultValue.v.stringValue = rcstring;
@@ -528,10 +534,11 @@ enum ErrorCode cmd_LEFT_RIGHT(struct Core *core)
         size_t resultLen = strlen(varValue->stringValue->chars);
         
         struct RCString *resultRCString = varValue->stringValue;
-        if (resultRCString->refCount > 1)
+        if (resultRCString->refCount != 1)
         {
             // copy string if shared
             resultRCString = rcstring_new(varValue->stringValue->chars, resultLen);
+            core->metrics->frame.numStringAllocations++;
             rcstring_release(varValue->stringValue);
             varValue->stringValue = resultRCString;
         }
@@ -626,10 +633,11 @@ enum ErrorCode cmd_MID(struct Core *core)
         size_t resultLen = strlen(varValue->stringValue->chars);
         
         struct RCString *resultRCString = varValue->stringValue;
-        if (resultRCString->refCount > 1)
+        if (resultRCString->refCount != 1)
         {
             // copy string if shared
             resultRCString = rcstring_new(varValue->stringValue->chars, resultLen);
+            core->metrics->frame.numStringAllocations++;
             rcstring_release(varValue->stringValue);
             varValue->stringValue = resultRCString;
         }
@@ -36,7 +36,7 @@ enum ErrorCode cmd_CALL(struct Core *core)
     
     if (interpreter->pass == PassPrepare)
     {
-        struct SubItem *item = tok_getSub(&interpreter->tokenizer, tokenSubIdentifier->symbolIndex);
+        struct SubItem *item = tok_getSub(&interpreter->program->tokenizer, tokenSubIdentifier->symbolIndex);
         if (!item) return ErrorUndefinedSubprogram;
         tokenCALL->jumpToken = item->token;
     }
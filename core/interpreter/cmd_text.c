@@ -142,6 +142,7 @@ enum ErrorCode cmd_endINPUT(struct Core *core)
         {
             struct RCString *rcstring = rcstring_new(interpreter->textLib.inputBuffer, interpreter->textLib.inputLength);
             if (!rcstring) return ErrorOutOfMemory;
+            core->metrics->frame.numStringAllocations++;
             
             if (varValue->stringValue)
             {
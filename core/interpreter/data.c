@@ -48,7 +48,7 @@ void dat_restoreData(struct Interpreter *interpreter, struct Token *jumpToken)
 {
     if (jumpToken)
     {
-        struct Token *dataToken = interpreter->firstData;
+        struct Token *dataToken = interpreter->program->firstData;
         while (dataToken && dataToken < jumpToken)
         {
             dataToken = dataToken->jumpToken;
@@ -57,7 +57,7 @@ void dat_restoreData(struct Interpreter *interpreter, struct Token *jumpToken)
     }
     else
     {
-        interpreter->currentDataToken = interpreter->firstData;
+        interpreter->currentDataToken = interpreter->program->firstData;
     }
     
     if (interpreter->currentDataToken)
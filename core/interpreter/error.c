@@ -84,6 +84,7 @@ const char *ErrorStrings[] = {
     "Gamepad Not Enabled",
     "Touch Not Enabled",
     "Input Change Not Allowed",
+    "Invalid Disk Image",
 };
 
 const char *err_getString(enum ErrorCode errorCode)
@@ -87,6 +87,7 @@ enum ErrorCode {
     ErrorGamepadNotEnabled,
     ErrorTouchNotEnabled,
     ErrorInputChangeNotAllowed,
+    ErrorInvalidDiskImage,
 };
 
 struct CoreError {
@@ -25,7 +25,6 @@
 #include <math.h>
 #include <stdint.h>
 #include "core.h"
-#include "default_characters.h"
 #include "cmd_audio.h"
 #include "cmd_control.h"
 #include "cmd_variables.h"
@@ -40,19 +39,18 @@
 #include "cmd_io.h"
 #include "cmd_files.h"
 #include "cmd_subs.h"
-#include "string_utils.h"
 
 struct TypedValue itp_evaluateExpressionLevel(struct Core *core, int level);
 struct TypedValue itp_evaluatePrimaryExpression(struct Core *core);
 struct TypedValue itp_evaluateFunction(struct Core *core);
 enum ErrorCode itp_evaluateCommand(struct Core *core);
+enum ErrorCode itp_evaluateSingleCommand(struct Core *core);
+void itp_prepareRun(struct Core *core);
 
 void itp_init(struct Core *core)
 {
     struct Interpreter *interpreter = core->interpreter;
     
-    interpreter->romDataManager.data = core->machine->cartridgeRom;
-    
     // global null string
     interpreter->nullString = rcstring_new(NULL, 0);
     if (!interpreter->nullString) exit(EXIT_FAILURE);
@@ -63,6 +61,7 @@ void itp_deinit(struct Core *core)
     struct Interpreter *interpreter = core->interpreter;
     
     itp_freeProgram(core);
+    prof_stop(core);
     
     // Free null string
     if (interpreter->nullString)
@@ -73,36 +72,40 @@ void itp_deinit(struct Core *core)
 }
 
 struct CoreError itp_compileProgram(struct Core *core, const char *sourceCode)
+{
+    itp_freeProgram(core);
+    
+    struct Program *program = prg_new();
+    if (!program) return err_makeCoreError(ErrorOutOfMemory, -1);
+    if (!prg_setSourceCode(program, sourceCode))
+    {
+        prg_release(program);
+        return err_makeCoreError(ErrorOutOfMemory, -1);
+    }
+    
+    struct CoreError error = itp_compileNewProgram(core, program);
+    prg_release(program);
+    return error;
+}
+
+/** Compiles a program which has only its source code yet */
+struct CoreError itp_compileNewProgram(struct Core *core, struct Program *program)
 {
     struct Interpreter *interpreter = core->interpreter;
     
     itp_freeProgram(core);
     
-    // Parse source code
+    // Parse source code, the program stays attached on errors, so they can show the line
     
-    interpreter->sourceCode = uppercaseString(sourceCode);
-    if (!interpreter->sourceCode) return err_makeCoreError(ErrorOutOfMemory, -1);
-    
-    struct CoreError error = tok_tokenizeUppercaseProgram(&interpreter->tokenizer, interpreter->sourceCode);
-    if (error.code != ErrorNone)
-    {
-        return error;
-    }
+    prg_retain(program);
+    interpreter->program = program;
     
-    struct DataManager *romDataManager = &interpreter->romDataManager;
-    error = data_uppercaseImport(romDataManager, interpreter->sourceCode, false);
+    struct CoreError error = prg_parse(program);
     if (error.code != ErrorNone) return error;
-
-    // add default characters if ROM entry 0 is unused
-    struct DataEntry *entry0 = &romDataManager->entries[0];
-    if (entry0->length == 0 && (DATA_SIZE - data_currentSize(romDataManager)) >= 1024)
-    {
-        data_setEntry(romDataManager, 0, "FONT", (uint8_t *)DefaultCharacters, 1024);
-    }
     
     // Prepare commands
     
-    interpreter->pc = interpreter->tokenizer.tokens;
+    interpreter->pc = program->tokenizer.tokens;
     interpreter->pass = PassPrepare;
     interpreter->exitEvaluation = false;
     interpreter->subLevel = 0;
@@ -128,17 +131,36 @@ struct CoreError itp_compileProgram(struct Core *core, const char *sourceCode)
         }
     }
     
-    // prepare for run
+    program->isCompiled = true;
+    itp_prepareRun(core);
+    
+    return err_noCoreError();
+}
+
+/** Runs a program compiled by another core, which is shared and not copied */
+void itp_loadProgram(struct Core *core, struct Program *program)
+{
+    itp_freeProgram(core);
     
-    interpreter->pc = interpreter->tokenizer.tokens;
+    prg_retain(program);
+    core->interpreter->program = program;
+    itp_prepareRun(core);
+}
+
+void itp_prepareRun(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    struct Program *program = interpreter->program;
+    
+    interpreter->pc = program->tokenizer.tokens;
     interpreter->cycles = 0;
     interpreter->interruptOverCycles = 0;
     interpreter->pass = PassRun;
     interpreter->state = StateEvaluate;
     interpreter->mode = ModeNone;
     interpreter->handlesPause = true;
-    interpreter->currentDataToken = interpreter->firstData;
-    interpreter->currentDataValueToken = interpreter->firstData ? interpreter->firstData + 1 : NULL;
+    interpreter->currentDataToken = program->firstData;
+    interpreter->currentDataValueToken = program->firstData ? program->firstData + 1 : NULL;
     interpreter->isSingleLineIf = false;
     interpreter->lastFrameIOStatus.value = 0;
     interpreter->seed = 0;
@@ -150,8 +172,8 @@ struct CoreError itp_compileProgram(struct Core *core, const char *sourceCode)
     interpreter->textLib.core = core;
     interpreter->spritesLib.core = core;
     interpreter->audioLib.core = core;
-
-    return err_noCoreError();
+    
+    prof_reset(core);
 }
 
 void itp_runProgram(struct Core *core)
@@ -171,6 +193,7 @@ void itp_runProgram(struct Core *core)
             interpreter->mode = ModeMain;
             interpreter->exitEvaluation = false;
             enum ErrorCode errorCode = ErrorNone;
+            int startCycles = interpreter->cycles;
             
             while (   errorCode == ErrorNone
                    && interpreter->cycles < MAX_CYCLES_TOTAL_PER_FRAME
@@ -180,6 +203,8 @@ void itp_runProgram(struct Core *core)
                 errorCode = itp_evaluateCommand(core);
             }
             
+            core->metrics->frame.mainCycles += interpreter->cycles - startCycles;
+            
             if (interpreter->cycles >= MAX_CYCLES_TOTAL_PER_FRAME)
             {
                 machine_suspendEnergySaving(core, 2);
@@ -247,6 +272,7 @@ void itp_runInterrupt(struct Core *core, enum InterruptType type)
             if (startToken)
             {
                 interpreter->mode = ModeInterrupt;
+                interpreter->interruptType = type;
                 interpreter->exitEvaluation = false;
                 struct Token *pc = interpreter->pc;
                 interpreter->pc = startToken;
@@ -280,6 +306,19 @@ void itp_runInterrupt(struct Core *core, enum InterruptType type)
                 }
             }
             
+            if (type == InterruptTypeVBL)
+            {
+                core->metrics->frame.vblCycles += interpreter->cycles;
+            }
+            else
+            {
+                core->metrics->frame.rasterCycles += interpreter->cycles;
+            }
+            if (interpreter->cycles > maxCycles)
+            {
+                core->metrics->frame.numInterruptOverruns++;
+            }
+            
             // calculate cycles exceeding limit
             interpreter->interruptOverCycles += interpreter->cycles - maxCycles;
             if (interpreter->interruptOverCycles < 0)
@@ -349,6 +388,11 @@ void itp_didFinishVBL(struct Core *core)
         interpreter->cpuLoadMax = currentCpuLoad;
     }
     
+    if (interpreter->profiler)
+    {
+        prof_didFinishFrame(core);
+    }
+    
     // reset CPU cycles
     interpreter->cycles = interpreter->cycles - MAX_CYCLES_TOTAL_PER_FRAME;
     if (interpreter->cycles < 0)
@@ -369,8 +413,7 @@ void itp_freeProgram(struct Core *core)
     struct Interpreter *interpreter = core->interpreter;
     
     interpreter->state = StateNoProgram;
-    interpreter->firstData = NULL;
-    interpreter->lastData = NULL;
+    interpreter->pc = NULL;
     interpreter->currentDataToken = NULL;
     interpreter->currentDataValueToken = NULL;
     interpreter->currentOnRasterToken = NULL;
@@ -379,12 +422,12 @@ void itp_freeProgram(struct Core *core)
     
     var_freeSimpleVariables(interpreter, SUB_LEVEL_GLOBAL);
     var_freeArrayVariables(interpreter, SUB_LEVEL_GLOBAL);
-    tok_freeTokens(&interpreter->tokenizer);
+    var_freeBlocks(interpreter);
     
-    if (interpreter->sourceCode)
+    if (interpreter->program)
     {
-        free((void *)interpreter->sourceCode);
-        interpreter->sourceCode = NULL;
+        prg_release(interpreter->program);
+        interpreter->program = NULL;
     }
 }
 
@@ -520,7 +563,7 @@ union Value *itp_readVariable(struct Core *core, enum ValueType *type, enum Erro
             return &variable->v;
         }
     }
-    return &ValueDummy;
+    return &interpreter->valueDummy;
 }
 
 enum ErrorCode itp_checkTypeClass(struct Interpreter *interpreter, enum ValueType valueType, enum TypeClass typeClass)
@@ -873,6 +916,7 @@ struct TypedValue itp_evaluateExpressionLevel(struct Core *core, int level)
                         size_t len1 = strlen(value.v.stringValue->chars);
                         size_t len2 = strlen(rightValue.v.stringValue->chars);
                         newValue.v.stringValue = rcstring_new(NULL, len1 + len2);
+                        core->metrics->frame.numStringAllocations++;
                         strcpy(newValue.v.stringValue->chars, value.v.stringValue->chars);
                         strcpy(&newValue.v.stringValue->chars[len1], rightValue.v.stringValue->chars);
                         interpreter->cycles += len1 + len2;
@@ -1173,6 +1217,19 @@ struct TypedValue itp_evaluateFunction(struct Core *core)
 }
 
 enum ErrorCode itp_evaluateCommand(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    if (interpreter->profiler && interpreter->pass == PassRun)
+    {
+        prof_commandWillBegin(core);
+        enum ErrorCode errorCode = itp_evaluateSingleCommand(core);
+        prof_commandDidEnd(core);
+        return errorCode;
+    }
+    return itp_evaluateSingleCommand(core);
+}
+
+enum ErrorCode itp_evaluateSingleCommand(struct Core *core)
 {
     struct Interpreter *interpreter = core->interpreter;
     enum TokenType type = interpreter->pc->type;
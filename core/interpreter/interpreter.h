@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include "interpreter_config.h"
 #include "tokenizer.h"
+#include "program.h"
 #include "token.h"
 #include "error.h"
 #include "value.h"
@@ -36,6 +37,7 @@
 #include "audio_lib.h"
 #include "io_chip.h"
 #include "data_manager.h"
+#include "profiler.h"
 
 #define BAS_TRUE -1.0f
 #define BAS_FALSE 0.0f
@@ -68,11 +70,12 @@ enum InterruptType {
 };
 
 struct Interpreter {
-    const char *sourceCode;
+    struct Program *program;
     
     enum Pass pass;
     enum State state;
     enum Mode mode;
+    enum InterruptType interruptType;
     struct Token *pc;
     int subLevel;
     int cycles;
@@ -83,23 +86,17 @@ struct Interpreter {
     int cpuLoadMax;
     int cpuLoadTimer;
     
-    struct Tokenizer tokenizer;
-    
-    struct DataManager romDataManager;
-    
     struct LabelStackItem labelStackItems[MAX_LABEL_STACK_ITEMS];
     int numLabelStackItems;
     
     bool isSingleLineIf;
     
-    struct SimpleVariable simpleVariables[MAX_SIMPLE_VARIABLES];
+    struct SimpleVariable *simpleVariableBlocks[MAX_SIMPLE_VARIABLES / VAR_BLOCK_SIZE];
     int numSimpleVariables;
-    struct ArrayVariable arrayVariables[MAX_ARRAY_VARIABLES];
+    struct ArrayVariable *arrayVariableBlocks[MAX_ARRAY_VARIABLES / VAR_BLOCK_SIZE];
     int numArrayVariables;
     struct RCString *nullString;
     
-    struct Token *firstData;
-    struct Token *lastData;
     struct Token *currentDataToken;
     struct Token *currentDataValueToken;
     
@@ -114,15 +111,20 @@ struct Interpreter {
     int seed;
     bool isKeyboardOptional;
     union Value *lastVariableValue;
+    union Value valueDummy; // variable target while not running, per core so it's never shared
     
     struct TextLib textLib;
     struct SpritesLib spritesLib;
     struct AudioLib audioLib;
+    
+    struct Profiler *profiler;
 };
 
 void itp_init(struct Core *core);
 void itp_deinit(struct Core *core);
 struct CoreError itp_compileProgram(struct Core *core, const char *sourceCode);
+struct CoreError itp_compileNewProgram(struct Core *core, struct Program *program);
+void itp_loadProgram(struct Core *core, struct Program *program);
 void itp_runProgram(struct Core *core);
 void itp_runInterrupt(struct Core *core, enum InterruptType type);
 void itp_didFinishVBL(struct Core *core);
@@ -0,0 +1,406 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "profiler.h"
+#include "core.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ProfilerLine {
+    int number;
+    int sourcePosition;
+    struct ProfilerCounter counter;
+};
+
+const char *ProfilerContextNames[PROFILER_NUM_CONTEXTS] = {"MAIN", "ON VBL", "ON RASTER"};
+
+int *prof_createTokenLines(struct Core *core);
+const char *prof_frameName(struct Core *core, enum LabelType type, int tokenIndex);
+int prof_compareLines(const void *a, const void *b);
+
+
+void prof_start(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    if (!interpreter->profiler)
+    {
+        interpreter->profiler = calloc(1, sizeof(struct Profiler));
+        if (!interpreter->profiler) exit(EXIT_FAILURE);
+    }
+    else
+    {
+        prof_reset(core);
+    }
+}
+
+void prof_stop(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    if (interpreter->profiler)
+    {
+        free(interpreter->profiler);
+        interpreter->profiler = NULL;
+    }
+}
+
+void prof_reset(struct Core *core)
+{
+    struct Profiler *profiler = core->interpreter->profiler;
+    if (profiler)
+    {
+        memset(profiler, 0, sizeof(struct Profiler));
+    }
+}
+
+void prof_commandWillBegin(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    struct Profiler *profiler = interpreter->profiler;
+    
+    enum ProfilerContext context = ProfilerContextMain;
+    int firstItem = 0;
+    if (interpreter->mode == ModeInterrupt)
+    {
+        context = (interpreter->interruptType == InterruptTypeVBL) ? ProfilerContextVBL : ProfilerContextRaster;
+        
+        // ignore the interrupted main program's stack
+        for (int i = interpreter->numLabelStackItems - 1; i >= 0; i--)
+        {
+            if (interpreter->labelStackItems[i].type == LabelTypeONCALL)
+            {
+                firstItem = i + 1;
+                break;
+            }
+        }
+    }
+    
+    int tokenIndex = (int)(interpreter->pc - interpreter->program->tokenizer.tokens);
+    profiler->currentCounter = &profiler->counters[context][tokenIndex];
+    
+    // build call stack, innermost PROFILER_MAX_DEPTH levels only
+    struct ProfilerStack key;
+    memset(&key, 0, sizeof(struct ProfilerStack));
+    key.context = context;
+    for (int i = interpreter->numLabelStackItems - 1; i >= firstItem && key.depth < PROFILER_MAX_DEPTH; i--)
+    {
+        struct LabelStackItem *item = &interpreter->labelStackItems[i];
+        if (item->type == LabelTypeGOSUB || item->type == LabelTypeCALL)
+        {
+            key.depth++;
+        }
+    }
+    int frame = key.depth;
+    key.frames[frame] = tokenIndex;
+    for (int i = interpreter->numLabelStackItems - 1; i >= firstItem && frame > 0; i--)
+    {
+        struct LabelStackItem *item = &interpreter->labelStackItems[i];
+        if (item->type == LabelTypeGOSUB || item->type == LabelTypeCALL)
+        {
+            frame--;
+            key.types[frame] = item->type;
+            key.frames[frame] = (int)(item->token - interpreter->program->tokenizer.tokens);
+        }
+    }
+    
+    // FNV-1a over the stack, open addressing
+    uint32_t hash = 2166136261u ^ key.context;
+    for (int i = 0; i <= key.depth; i++)
+    {
+        hash = (hash ^ (uint32_t)key.frames[i]) * 16777619u;
+        hash = (hash ^ key.types[i]) * 16777619u;
+    }
+    
+    profiler->currentStack = NULL;
+    int index = hash % PROFILER_MAX_STACKS;
+    for (int probe = 0; probe < PROFILER_MAX_STACKS; probe++)
+    {
+        struct ProfilerStack *stack = &profiler->stacks[index];
+        if (!stack->isUsed)
+        {
+            // keep some room so probing stays short
+            if (profiler->numStacks < PROFILER_MAX_STACKS * 7 / 8)
+            {
+                key.isUsed = true;
+                *stack = key;
+                profiler->numStacks++;
+                profiler->currentStack = stack;
+            }
+            break;
+        }
+        if (   stack->context == key.context
+            && stack->depth == key.depth
+            && memcmp(stack->frames, key.frames, sizeof(key.frames)) == 0
+            && memcmp(stack->types, key.types, sizeof(key.types)) == 0)
+        {
+            profiler->currentStack = stack;
+            break;
+        }
+        index = (index + 1) % PROFILER_MAX_STACKS;
+    }
+    if (!profiler->currentStack)
+    {
+        profiler->numDroppedSamples++;
+    }
+    
+    profiler->currentCycles = interpreter->cycles;
+    profiler->currentHostTime = delegate_getHostTime(core);
+}
+
+void prof_commandDidEnd(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    struct Profiler *profiler = interpreter->profiler;
+    
+    struct ProfilerCounter *counter = profiler->currentCounter;
+    if (!counter) return;
+    
+    uint64_t hostTime = delegate_getHostTime(core);
+    hostTime = (hostTime > profiler->currentHostTime) ? hostTime - profiler->currentHostTime : 0;
+    
+    // the interpreter resets its cycles between frames, never between begin and end of a command
+    int cycles = interpreter->cycles - profiler->currentCycles;
+    if (cycles < 0)
+    {
+        cycles = 0;
+    }
+    
+    counter->cycles += cycles;
+    counter->hostTime += hostTime;
+    counter->count++;
+    
+    struct ProfilerStack *stack = profiler->currentStack;
+    if (stack)
+    {
+        stack->cycles += cycles;
+        stack->hostTime += hostTime;
+    }
+    
+    profiler->currentCounter = NULL;
+    profiler->currentStack = NULL;
+}
+
+void prof_didFinishFrame(struct Core *core)
+{
+    core->interpreter->profiler->numFrames++;
+}
+
+void prof_writeReport(struct Core *core, FILE *file)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    struct Profiler *profiler = interpreter->profiler;
+    if (!profiler || !interpreter->program) return;
+    const char *source = interpreter->program->sourceCode;
+    
+    int *tokenLines = prof_createTokenLines(core);
+    
+    int numLines = tokenLines[interpreter->program->tokenizer.numTokens];
+    struct ProfilerLine *lines = calloc(numLines, sizeof(struct ProfilerLine));
+    if (!lines) exit(EXIT_FAILURE);
+    
+    fprintf(file, "LowRes NX profile, %d frames\n", profiler->numFrames);
+    if (profiler->numDroppedSamples > 0)
+    {
+        fprintf(file, "Call stack table full, %d samples without stack\n", profiler->numDroppedSamples);
+    }
+    
+    for (int context = 0; context < PROFILER_NUM_CONTEXTS; context++)
+    {
+        // sum up tokens per line
+        
+        memset(lines, 0, numLines * sizeof(struct ProfilerLine));
+        int lineStart = 0;
+        for (int i = 0; i < numLines; i++)
+        {
+            lines[i].number = i + 1;
+            lines[i].sourcePosition = lineStart;
+            const char *end = strchr(&source[lineStart], '\n');
+            lineStart = end ? (int)(end - source) + 1 : (int)strlen(source);
+        }
+        
+        struct ProfilerCounter total = {0, 0, 0};
+        for (int i = 0; i < interpreter->program->tokenizer.numTokens; i++)
+        {
+            struct ProfilerCounter *counter = &profiler->counters[context][i];
+            if (counter->count > 0)
+            {
+                struct ProfilerCounter *lineCounter = &lines[tokenLines[i] - 1].counter;
+                lineCounter->cycles += counter->cycles;
+                lineCounter->hostTime += counter->hostTime;
+                lineCounter->count += counter->count;
+                total.cycles += counter->cycles;
+                total.hostTime += counter->hostTime;
+                total.count += counter->count;
+            }
+        }
+        if (total.count == 0) continue;
+        
+        qsort(lines, numLines, sizeof(struct ProfilerLine), prof_compareLines);
+        
+        double cyclesPerFrame = profiler->numFrames > 0 ? (double)total.cycles / profiler->numFrames : 0.0;
+        fprintf(file, "\n%s: %llu cycles (%.1f per frame), %.3f ms host time\n",
+                ProfilerContextNames[context], (unsigned long long)total.cycles, cyclesPerFrame, total.hostTime / 1000000.0);
+        fprintf(file, "%6s %12s %6s %10s %10s  %s\n", "LINE", "CYCLES", "%", "COUNT", "HOST MS", "SOURCE");
+        
+        for (int i = 0; i < numLines; i++)
+        {
+            struct ProfilerLine *line = &lines[i];
+            if (line->counter.count == 0) break;
+            
+            const char *text = &source[line->sourcePosition];
+            int length = 0;
+            while (text[length] != 0 && text[length] != '\n' && text[length] != '\r' && length < 60)
+            {
+                length++;
+            }
+            fprintf(file, "%6d %12llu %5.1f%% %10u %10.3f  %.*s\n",
+                    line->number,
+                    (unsigned long long)line->counter.cycles,
+                    total.cycles > 0 ? line->counter.cycles * 100.0 / total.cycles : 0.0,
+                    line->counter.count,
+                    line->counter.hostTime / 1000000.0,
+                    length, text);
+        }
+    }
+    
+    free(lines);
+    free(tokenLines);
+}
+
+void prof_writeFoldedStacks(struct Core *core, FILE *file, bool hostTime)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    struct Profiler *profiler = interpreter->profiler;
+    if (!profiler || !interpreter->program) return;
+    
+    int *tokenLines = prof_createTokenLines(core);
+    
+    for (int i = 0; i < PROFILER_MAX_STACKS; i++)
+    {
+        struct ProfilerStack *stack = &profiler->stacks[i];
+        if (!stack->isUsed) continue;
+        
+        uint64_t value = hostTime ? stack->hostTime / 1000 : stack->cycles;
+        if (value == 0) continue;
+        
+        fputs(ProfilerContextNames[stack->context], file);
+        for (int frame = 0; frame < stack->depth; frame++)
+        {
+            // the callee is named after the code the next frame is in
+            const char *name = prof_frameName(core, stack->types[frame], stack->frames[frame + 1]);
+            if (stack->types[frame] == LabelTypeCALL)
+            {
+                fprintf(file, ";SUB %s", name);
+            }
+            else
+            {
+                fprintf(file, ";%s:", name);
+            }
+        }
+        fprintf(file, ";line %d %llu\n", tokenLines[stack->frames[stack->depth]], (unsigned long long)value);
+    }
+    
+    free(tokenLines);
+}
+
+int *prof_createTokenLines(struct Core *core)
+{
+    struct Interpreter *interpreter = core->interpreter;
+    const char *source = interpreter->program->sourceCode;
+    int numTokens = interpreter->program->tokenizer.numTokens;
+    
+    int *tokenLines = malloc((numTokens + 1) * sizeof(int));
+    if (!tokenLines) exit(EXIT_FAILURE);
+    
+    // tokens are in source order
+    int line = 1;
+    int position = 0;
+    for (int i = 0; i < numTokens; i++)
+    {
+        int tokenPosition = interpreter->program->tokenizer.tokens[i].sourcePosition;
+        while (position < tokenPosition && source[position] != 0)
+        {
+            if (source[position] == '\n')
+            {
+                line++;
+            }
+            position++;
+        }
+        tokenLines[i] = line;
+    }
+    while (source[position] != 0)
+    {
+        if (source[position] == '\n')
+        {
+            line++;
+        }
+        position++;
+    }
+    tokenLines[numTokens] = line;
+    return tokenLines;
+}
+
+const char *prof_frameName(struct Core *core, enum LabelType type, int tokenIndex)
+{
+    struct Tokenizer *tokenizer = &core->interpreter->program->tokenizer;
+    struct Token *token = &tokenizer->tokens[tokenIndex];
+    struct Token *best = NULL;
+    int symbolIndex = -1;
+    
+    if (type == LabelTypeCALL)
+    {
+        for (int i = 0; i < tokenizer->numSubItems; i++)
+        {
+            struct SubItem *item = &tokenizer->subItems[i];
+            if (item->token <= token && (!best || item->token > best))
+            {
+                best = item->token;
+                symbolIndex = item->symbolIndex;
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < tokenizer->numJumpLabelItems; i++)
+        {
+            struct JumpLabelItem *item = &tokenizer->jumpLabelItems[i];
+            if (item->token <= token && (!best || item->token > best))
+            {
+                best = item->token;
+                symbolIndex = item->symbolIndex;
+            }
+        }
+    }
+    return (symbolIndex >= 0) ? tokenizer->symbols[symbolIndex].name : "?";
+}
+
+int prof_compareLines(const void *a, const void *b)
+{
+    const struct ProfilerLine *lineA = a;
+    const struct ProfilerLine *lineB = b;
+    if (lineA->counter.cycles != lineB->counter.cycles)
+    {
+        return (lineA->counter.cycles < lineB->counter.cycles) ? 1 : -1;
+    }
+    if (lineA->counter.count != lineB->counter.count)
+    {
+        return (lineA->counter.count < lineB->counter.count) ? 1 : -1;
+    }
+    return lineA->number - lineB->number;
+}
@@ -0,0 +1,86 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "interpreter_config.h"
+
+#define PROFILER_NUM_CONTEXTS 3
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_MAX_STACKS 8192
+
+struct Core;
+
+enum ProfilerContext {
+    ProfilerContextMain,
+    ProfilerContextVBL,
+    ProfilerContextRaster
+};
+
+struct ProfilerCounter {
+    uint64_t cycles;
+    uint64_t hostTime;
+    uint32_t count;
+};
+
+/** A call stack: token indices of the GOSUB/CALL return positions plus the current command as leaf */
+struct ProfilerStack {
+    bool isUsed;
+    uint8_t context;
+    uint8_t depth;
+    uint8_t types[PROFILER_MAX_DEPTH];
+    int16_t frames[PROFILER_MAX_DEPTH + 1];
+    uint64_t cycles;
+    uint64_t hostTime;
+};
+
+struct Profiler {
+    struct ProfilerCounter counters[PROFILER_NUM_CONTEXTS][MAX_TOKENS];
+    struct ProfilerStack stacks[PROFILER_MAX_STACKS];
+    int numStacks;
+    int numDroppedSamples;
+    int numFrames;
+    
+    // current command
+    struct ProfilerCounter *currentCounter;
+    struct ProfilerStack *currentStack;
+    int currentCycles;
+    uint64_t currentHostTime;
+};
+
+void prof_start(struct Core *core);
+void prof_stop(struct Core *core);
+void prof_reset(struct Core *core);
+
+void prof_commandWillBegin(struct Core *core);
+void prof_commandDidEnd(struct Core *core);
+void prof_didFinishFrame(struct Core *core);
+
+/** Writes a text report with the most expensive lines of each context */
+void prof_writeReport(struct Core *core, FILE *file);
+
+/** Writes call stacks in the folded format used by flame graph tools, weighted by cycles or host microseconds */
+void prof_writeFoldedStacks(struct Core *core, FILE *file, bool hostTime);
+
+#endif /* profiler_h */
@@ -0,0 +1,149 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "program.h"
+#include "core_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+#include "charsets.h"
+#include "default_characters.h"
+
+struct Program *prg_new(void)
+{
+    struct Program *program = calloc(1, sizeof(struct Program));
+    if (program)
+    {
+        program->refCount = 1; // retain
+        program->romDataManager.data = program->rom;
+    }
+    return program;
+}
+
+/** Thread-safe, cores sharing a program may be loaded and released while others are running */
+void prg_retain(struct Program *program)
+{
+    atomic_addInt(&program->refCount, 1);
+}
+
+void prg_release(struct Program *program)
+{
+    if (atomic_addInt(&program->refCount, -1) == 0)
+    {
+        tok_freeTokens(&program->tokenizer);
+        data_deinit(&program->romDataManager);
+        if (program->releaseSourceCode)
+        {
+            program->releaseSourceCode(program->sourceCodeContext);
+        }
+        else if (program->sourceCode)
+        {
+            free((void *)program->sourceCode);
+        }
+        free(program);
+    }
+}
+
+/** Keeps a copy of the source code, for error messages and to identify the program in save states */
+bool prg_setSourceCode(struct Program *program, const char *sourceCode)
+{
+    size_t length = strlen(sourceCode);
+    char *copy = malloc(length + 1);
+    if (!copy) return false;
+    
+    memcpy(copy, sourceCode, length + 1);
+    prg_useSourceCode(program, copy, NULL, NULL);
+    return true;
+}
+
+/** Uses the source code without copying it, for example a memory-mapped file. It must stay valid until release is called. */
+void prg_useSourceCode(struct Program *program, const char *sourceCode, void (*release)(void *context), void *context)
+{
+    program->sourceCode = sourceCode;
+    program->releaseSourceCode = release;
+    program->sourceCodeContext = context;
+    
+    // FNV-1a of the upper case, like programs were always stored
+    uint32_t hash = 2166136261u;
+    for (const char *character = sourceCode; *character; character++)
+    {
+        hash = (hash ^ CharSetUppercase[(uint8_t)*character]) * 16777619u;
+    }
+    program->sourceCodeHash = hash;
+}
+
+/** Replaces source code from prg_useSourceCode with a copy and releases the original, for example a mapped file which could be changed by another process */
+bool prg_copySourceCode(struct Program *program)
+{
+    if (!program->releaseSourceCode) return true;
+    
+    size_t length = strlen(program->sourceCode);
+    char *copy = malloc(length + 1);
+    if (!copy) return false;
+    
+    memcpy(copy, program->sourceCode, length + 1);
+    program->releaseSourceCode(program->sourceCodeContext);
+    program->sourceCode = copy;
+    program->releaseSourceCode = NULL;
+    program->sourceCodeContext = NULL;
+    return true;
+}
+
+/** Tokenizes the source code and imports the ROM entries, the commands are prepared by the interpreter */
+struct CoreError prg_parse(struct Program *program)
+{
+    struct CoreError error = tok_tokenizeProgram(&program->tokenizer, program->sourceCode);
+    if (error.code != ErrorNone) return error;
+    
+    struct DataManager *romDataManager = &program->romDataManager;
+    error = data_import(romDataManager, program->sourceCode, false);
+    if (error.code != ErrorNone) return error;
+    
+    // add default characters if ROM entry 0 is unused
+    struct DataEntry *entry0 = &romDataManager->entries[0];
+    if (entry0->length == 0 && (DATA_SIZE - data_currentSize(romDataManager)) >= 1024)
+    {
+        data_setEntry(romDataManager, 0, "FONT", (const uint8_t *)DefaultCharacters, 1024);
+    }
+    
+    return err_noCoreError();
+}
+
+/** Frees everything made from the source code, so it can be parsed again */
+void prg_clear(struct Program *program)
+{
+    tok_freeTokens(&program->tokenizer);
+    data_reset(&program->romDataManager);
+    program->firstData = NULL;
+    program->lastData = NULL;
+    program->isCompiled = false;
+}
+
+size_t prg_getMemorySize(struct Program *program)
+{
+    size_t size = sizeof(struct Program);
+    if (program->sourceCode)
+    {
+        size += strlen(program->sourceCode) + 1;
+    }
+    struct Tokenizer *tokenizer = &program->tokenizer;
+    size += tokenizer->tokensCapacity * sizeof(struct Token);
+    size += tokenizer->symbolsCapacity * sizeof(struct Symbol);
+    return size;
+}
@@ -0,0 +1,56 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef program_h
+#define program_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "tokenizer.h"
+#include "data_manager.h"
+
+// Compiled program with its cartridge ROM. It doesn't change after compiling, so all cores
+// running the same cart can share one instance, each with its own runtime state.
+struct Program {
+    volatile int refCount; // only through prg_retain and prg_release
+    bool isCompiled;
+    const char *sourceCode; // in any case, freed with the program unless releaseSourceCode is set
+    void (*releaseSourceCode)(void *context);
+    void *sourceCodeContext;
+    uint32_t sourceCodeHash;
+    struct Tokenizer tokenizer;
+    struct Token *firstData;
+    struct Token *lastData;
+    struct DataManager romDataManager;
+    uint8_t rom[DATA_SIZE];
+};
+
+struct Program *prg_new(void);
+void prg_retain(struct Program *program);
+void prg_release(struct Program *program);
+bool prg_setSourceCode(struct Program *program, const char *sourceCode);
+void prg_useSourceCode(struct Program *program, const char *sourceCode, void (*release)(void *context), void *context);
+bool prg_copySourceCode(struct Program *program);
+struct CoreError prg_parse(struct Program *program);
+void prg_clear(struct Program *program);
+size_t prg_getMemorySize(struct Program *program);
+
+#endif /* program_h */
@@ -40,14 +40,22 @@ struct RCString *rcstring_new(const char *chars, size_t len)
 
 void rcstring_retain(struct RCString *string)
 {
+    if (string->refCount == RCSTRING_CONSTANT) return;
     string->refCount++;
 }
 
 void rcstring_release(struct RCString *string)
 {
+    if (string->refCount == RCSTRING_CONSTANT) return;
     string->refCount--;
     if (string->refCount == 0)
     {
         free((void *)string);
     }
 }
+
+/** The string is never counted, so it can be read by many cores at once. Its owner frees it with free(). */
+void rcstring_makeConstant(struct RCString *string)
+{
+    string->refCount = RCSTRING_CONSTANT;
+}
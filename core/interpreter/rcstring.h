@@ -23,6 +23,9 @@
 
 #include <stdio.h>
 
+// string literals of a compiled program, shared by all cores running it and never freed by rcstring_release
+#define RCSTRING_CONSTANT -1
+
 struct RCString {
     int refCount;
     char chars[1]; // ...
@@ -31,5 +34,6 @@ struct RCString {
 struct RCString *rcstring_new(const char *chars, size_t len);
 void rcstring_retain(struct RCString *string);
 void rcstring_release(struct RCString *string);
+void rcstring_makeConstant(struct RCString *string);
 
 #endif /* string_h */
@@ -19,6 +19,7 @@
 //
 
 #include "string_utils.h"
+#include "charsets.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -84,6 +85,7 @@ int lineNumber(const char *source, int pos)
     return line;
 }
 
+/** Copies in upper case and without \r characters */
 void stringConvertCopy(char *dest, const char *source, size_t length)
 {
     char *currDstChar = dest;
@@ -92,7 +94,7 @@ void stringConvertCopy(char *dest, const char *source, size_t length)
         char currSrcChar = source[i];
         if (currSrcChar != '\r')
         {
-            *currDstChar = currSrcChar;
+            *currDstChar = CharSetUppercase[(uint8_t)currSrcChar];
             currDstChar++;
         }
     }
@@ -23,20 +23,19 @@
 #include "charsets.h"
 #include <string.h>
 #include <stdlib.h>
-#include "string_utils.h"
+#include <stdbool.h>
+#include <stdint.h>
 
-struct CoreError tok_tokenizeProgram(struct Tokenizer *tokenizer, const char *sourceCode)
-{
-    const char *uppercaseSourceCode = uppercaseString(sourceCode);
-    if (!uppercaseSourceCode) return err_makeCoreError(ErrorOutOfMemory, -1);
-    
-    struct CoreError error = tok_tokenizeUppercaseProgram(tokenizer, uppercaseSourceCode);
-    free((void *)uppercaseSourceCode);
-    
-    return error;
-}
+#define TOKENIZER_INITIAL_TOKENS 1024
+#define TOKENIZER_INITIAL_SYMBOLS 64
+#define TOKENIZER_MAX_KEYWORD_LENGTH 15 // longer than any keyword
+
+bool tok_growTokens(struct Tokenizer *tokenizer);
+bool tok_growSymbols(struct Tokenizer *tokenizer);
+bool tok_moveToArena(struct Tokenizer *tokenizer);
 
-struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const char *sourceCode)
+/** Reads the source code in place, in any case. Keywords, symbols and strings are converted to upper case. */
+struct CoreError tok_tokenizeProgram(struct Tokenizer *tokenizer, const char *sourceCode)
 {
     const char *character = sourceCode;
     
@@ -49,7 +48,12 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
         {
             return err_makeCoreError(ErrorTooManyTokens, tokenSourcePosition);
         }
+        if (tokenizer->numTokens + 2 > tokenizer->tokensCapacity && !tok_growTokens(tokenizer))
+        {
+            return err_makeCoreError(ErrorOutOfMemory, tokenSourcePosition);
+        }
         struct Token *token = &tokenizer->tokens[tokenizer->numTokens];
+        memset(token, 0, sizeof(struct Token)); // no jump token until prepared
         token->sourcePosition = tokenSourcePosition;
         
         // line break \n or \n\r
@@ -99,6 +103,11 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
             int len = (int)(character - firstCharacter);
             struct RCString *string = rcstring_new(firstCharacter, len);
             if (!string) return err_makeCoreError(ErrorOutOfMemory, tokenSourcePosition);
+            rcstring_makeConstant(string); // never changed, shared by all cores running the program
+            for (char *stringCharacter = string->chars; *stringCharacter; stringCharacter++)
+            {
+                *stringCharacter = CharSetUppercase[(uint8_t)*stringCharacter];
+            }
             token->type = TokenString;
             token->stringValue = string;
             tokenizer->numTokens++;
@@ -151,7 +160,7 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
             int number = 0;
             while (*character)
             {
-                char *spos = strchr(CharSetHex, *character);
+                char *spos = strchr(CharSetHex, CharSetUppercase[(uint8_t)*character]);
                 if (spos)
                 {
                     int digit = (int)(spos - CharSetHex);
@@ -196,6 +205,15 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
         }
         
         // Keyword
+        char word[TOKENIZER_MAX_KEYWORD_LENGTH + 2];
+        int wordLen = 0;
+        while (wordLen <= TOKENIZER_MAX_KEYWORD_LENGTH && character[wordLen])
+        {
+            word[wordLen] = CharSetUppercase[(uint8_t)character[wordLen]];
+            wordLen++;
+        }
+        word[wordLen] = 0;
+        
         enum TokenType foundKeywordToken = TokenUndefined;
         for (int i = 0; i < Token_count; i++)
         {
@@ -206,7 +224,7 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
                 int keywordIsAlphaNum = strchr(CharSetAlphaNum, keyword[0]) != NULL;
                 for (int pos = 0; pos <= keywordLen; pos++)
                 {
-                    char textCharacter = character[pos];
+                    char textCharacter = word[pos];
                     
                     if (pos < keywordLen)
                     {
@@ -265,13 +283,13 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
         }
         
         // Symbol
-        if (strchr(CharSetLetters, *character))
+        if (strchr(CharSetLetters, CharSetUppercase[(uint8_t)*character]))
         {
             const char *firstCharacter = character;
             char isString = 0;
             while (*character)
             {
-                if (strchr(CharSetAlphaNum, *character))
+                if (strchr(CharSetAlphaNum, CharSetUppercase[(uint8_t)*character]))
                 {
                     character++;
                 }
@@ -295,11 +313,14 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
                 return err_makeCoreError(ErrorSymbolNameTooLong, tokenSourcePosition);
             }
             char symbolName[SYMBOL_NAME_SIZE];
-            memcpy(symbolName, firstCharacter, len);
+            for (int i = 0; i < len; i++)
+            {
+                symbolName[i] = CharSetUppercase[(uint8_t)firstCharacter[i]];
+            }
             symbolName[len] = 0;
             int symbolIndex = -1;
             // find existing symbol
-            for (int i = 0; i < MAX_SYMBOLS && tokenizer->symbols[i].name[0] != 0; i++)
+            for (int i = 0; i < tokenizer->numSymbols; i++)
             {
                 if (strcmp(symbolName, tokenizer->symbols[i].name) == 0)
                 {
@@ -310,7 +331,13 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
             if (symbolIndex == -1)
             {
                 // add new symbol
-                strcpy(tokenizer->symbols[tokenizer->numSymbols].name, symbolName);
+                if (tokenizer->numSymbols == tokenizer->symbolsCapacity && !tok_growSymbols(tokenizer))
+                {
+                    return err_makeCoreError(ErrorOutOfMemory, tokenSourcePosition);
+                }
+                struct Symbol *symbol = &tokenizer->symbols[tokenizer->numSymbols];
+                memset(symbol, 0, sizeof(struct Symbol)); // no leftover bytes after the name
+                strcpy(symbol->name, symbolName);
                 symbolIndex = tokenizer->numSymbols++;
             }
             if (isString)
@@ -343,25 +370,44 @@ struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const
     }
     
     // add EOL to the end
+    if (tokenizer->numTokens + 1 > tokenizer->tokensCapacity && !tok_growTokens(tokenizer))
+    {
+        return err_makeCoreError(ErrorOutOfMemory, (int)(character - sourceCode));
+    }
     struct Token *token = &tokenizer->tokens[tokenizer->numTokens];
+    memset(token, 0, sizeof(struct Token));
     token->sourcePosition = (int)(character - sourceCode);
     token->type = TokenEol;
     tokenizer->numTokens++;
     
+    if (!tok_moveToArena(tokenizer))
+    {
+        return err_makeCoreError(ErrorOutOfMemory, token->sourcePosition);
+    }
+    
     return err_noCoreError();
 }
 
 void tok_freeTokens(struct Tokenizer *tokenizer)
 {
-    // Free string tokens
+    // Free string tokens, they are constant and not reference counted
     for (int i = 0; i < tokenizer->numTokens; i++)
     {
         struct Token *token = &tokenizer->tokens[i];
         if (token->type == TokenString)
         {
-            rcstring_release(token->stringValue);
+            free((void *)token->stringValue);
         }
     }
+    if (tokenizer->arena)
+    {
+        free(tokenizer->arena);
+    }
+    else
+    {
+        free(tokenizer->tokens);
+        free(tokenizer->symbols);
+    }
     memset(tokenizer, 0, sizeof(struct Tokenizer));
 }
 
@@ -391,6 +437,7 @@ enum ErrorCode tok_setJumpLabel(struct Tokenizer *tokenizer, int symbolIndex, st
     }
     struct JumpLabelItem *item = &tokenizer->jumpLabelItems[tokenizer->numJumpLabelItems];
     item->symbolIndex = symbolIndex;
+    item->tokenIndex = (int)(token - tokenizer->tokens);
     item->token = token;
     tokenizer->numJumpLabelItems++;
     return ErrorNone;
@@ -422,7 +469,77 @@ enum ErrorCode tok_setSub(struct Tokenizer *tokenizer, int symbolIndex, struct T
     }
     struct SubItem *item = &tokenizer->subItems[tokenizer->numSubItems];
     item->symbolIndex = symbolIndex;
+    item->tokenIndex = (int)(token - tokenizer->tokens);
     item->token = token;
     tokenizer->numSubItems++;
     return ErrorNone;
 }
+
+bool tok_growTokens(struct Tokenizer *tokenizer)
+{
+    int capacity = tokenizer->tokensCapacity > 0 ? tokenizer->tokensCapacity * 2 : TOKENIZER_INITIAL_TOKENS;
+    if (capacity > MAX_TOKENS) capacity = MAX_TOKENS;
+    
+    struct Token *tokens = realloc(tokenizer->tokens, capacity * sizeof(struct Token));
+    if (!tokens) return false;
+    tokenizer->tokens = tokens;
+    tokenizer->tokensCapacity = capacity;
+    return true;
+}
+
+bool tok_growSymbols(struct Tokenizer *tokenizer)
+{
+    int capacity = tokenizer->symbolsCapacity > 0 ? tokenizer->symbolsCapacity * 2 : TOKENIZER_INITIAL_SYMBOLS;
+    if (capacity > MAX_SYMBOLS) capacity = MAX_SYMBOLS;
+    
+    struct Symbol *symbols = realloc(tokenizer->symbols, capacity * sizeof(struct Symbol));
+    if (!symbols) return false;
+    tokenizer->symbols = symbols;
+    tokenizer->symbolsCapacity = capacity;
+    return true;
+}
+
+/** Allocates tokens and symbols of the exact size in one block, the tokens are followed by one TokenUndefined */
+bool tok_allocArena(struct Tokenizer *tokenizer, int numTokens, int numSymbols)
+{
+    size_t tokensSize = (numTokens + 1) * sizeof(struct Token);
+    size_t symbolsSize = numSymbols * sizeof(struct Symbol);
+    uint8_t *arena = malloc(tokensSize + symbolsSize);
+    if (!arena) return false;
+    
+    tokenizer->arena = arena;
+    tokenizer->tokens = (struct Token *)arena;
+    tokenizer->numTokens = numTokens;
+    tokenizer->tokensCapacity = numTokens + 1;
+    tokenizer->symbols = (struct Symbol *)(arena + tokensSize);
+    tokenizer->numSymbols = numSymbols;
+    tokenizer->symbolsCapacity = numSymbols;
+    memset(&tokenizer->tokens[numTokens], 0, sizeof(struct Token));
+    return true;
+}
+
+/** Moves tokens and symbols into their arena, then labels and subs can point to their tokens */
+bool tok_moveToArena(struct Tokenizer *tokenizer)
+{
+    struct Token *tokens = tokenizer->tokens;
+    struct Symbol *symbols = tokenizer->symbols;
+    if (!tok_allocArena(tokenizer, tokenizer->numTokens, tokenizer->numSymbols)) return false;
+    
+    memcpy(tokenizer->tokens, tokens, tokenizer->numTokens * sizeof(struct Token));
+    if (tokenizer->numSymbols > 0)
+    {
+        memcpy(tokenizer->symbols, symbols, tokenizer->numSymbols * sizeof(struct Symbol));
+    }
+    free(tokens);
+    free(symbols);
+    
+    for (int i = 0; i < tokenizer->numJumpLabelItems; i++)
+    {
+        tokenizer->jumpLabelItems[i].token = &tokenizer->tokens[tokenizer->jumpLabelItems[i].tokenIndex];
+    }
+    for (int i = 0; i < tokenizer->numSubItems; i++)
+    {
+        tokenizer->subItems[i].token = &tokenizer->tokens[tokenizer->subItems[i].tokenIndex];
+    }
+    return true;
+}
@@ -22,6 +22,7 @@
 #define tokenizer_h
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "interpreter_config.h"
 #include "token.h"
 
@@ -31,20 +32,27 @@ struct Symbol {
 
 struct JumpLabelItem {
     int symbolIndex;
-    struct Token *token;
+    int tokenIndex;
+    struct Token *token; // valid after tokenizing
 };
 
 struct SubItem {
     int symbolIndex;
-    struct Token *token;
+    int tokenIndex;
+    struct Token *token; // valid after tokenizing
 };
 
+// Tokens and symbols grow while tokenizing and are then moved to one exactly sized arena.
+// MAX_TOKENS and MAX_SYMBOLS stay the limits of the language.
 struct Tokenizer
 {
-    struct Token tokens[MAX_TOKENS];
+    struct Token *tokens; // followed by one TokenUndefined
     int numTokens;
-    struct Symbol symbols[MAX_SYMBOLS];
+    int tokensCapacity;
+    struct Symbol *symbols;
     int numSymbols;
+    int symbolsCapacity;
+    void *arena;
     
     struct JumpLabelItem jumpLabelItems[MAX_JUMP_LABEL_ITEMS];
     int numJumpLabelItems;
@@ -53,8 +61,8 @@ struct Tokenizer
 };
 
 struct CoreError tok_tokenizeProgram(struct Tokenizer *tokenizer, const char *sourceCode);
-struct CoreError tok_tokenizeUppercaseProgram(struct Tokenizer *tokenizer, const char *sourceCode);
 void tok_freeTokens(struct Tokenizer *tokenizer);
+bool tok_allocArena(struct Tokenizer *tokenizer, int numTokens, int numSymbols);
 struct JumpLabelItem *tok_getJumpLabel(struct Tokenizer *tokenizer, int symbolIndex);
 enum ErrorCode tok_setJumpLabel(struct Tokenizer *tokenizer, int symbolIndex, struct Token *token);
 struct SubItem *tok_getSub(struct Tokenizer *tokenizer, int symbolIndex);
@@ -20,8 +20,6 @@
 
 #include "value.h"
 
-union Value ValueDummy = {0};
-
 struct TypedValue val_makeError(enum ErrorCode errorCode)
 {
     struct TypedValue value;
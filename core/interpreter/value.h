@@ -50,8 +50,6 @@ enum TypeClass {
     TypeClassString
 };
 
-extern union Value ValueDummy;
-
 struct TypedValue val_makeError(enum ErrorCode errorCode);
 
 #endif /* value_h */
@@ -23,12 +23,34 @@
 #include <stdlib.h>
 #include <string.h>
 
+struct SimpleVariable *var_getSimpleVariableAt(struct Interpreter *interpreter, int index)
+{
+    return &interpreter->simpleVariableBlocks[index / VAR_BLOCK_SIZE][index % VAR_BLOCK_SIZE];
+}
+
+struct SimpleVariable *var_addSimpleVariable(struct Interpreter *interpreter)
+{
+    int index = interpreter->numSimpleVariables;
+    if (index >= MAX_SIMPLE_VARIABLES) return NULL;
+    
+    struct SimpleVariable **block = &interpreter->simpleVariableBlocks[index / VAR_BLOCK_SIZE];
+    if (!*block)
+    {
+        *block = malloc(sizeof(struct SimpleVariable) * VAR_BLOCK_SIZE);
+        if (!*block) return NULL;
+    }
+    interpreter->numSimpleVariables++;
+    struct SimpleVariable *variable = &(*block)[index % VAR_BLOCK_SIZE];
+    memset(variable, 0, sizeof(struct SimpleVariable));
+    return variable;
+}
+
 struct SimpleVariable *var_getSimpleVariable(struct Interpreter *interpreter, int symbolIndex, int subLevel)
 {
     struct SimpleVariable *variable = NULL;
     for (int i = interpreter->numSimpleVariables - 1; i >= 0; i--)
     {
-        variable = &interpreter->simpleVariables[i];
+        variable = var_getSimpleVariableAt(interpreter, i);
         if (variable->symbolIndex == symbolIndex && (variable->subLevel == subLevel || variable->subLevel == SUB_LEVEL_GLOBAL))
         {
             // variable found
@@ -40,19 +62,17 @@ struct SimpleVariable *var_getSimpleVariable(struct Interpreter *interpreter, in
 
 struct SimpleVariable *var_createSimpleVariable(struct Interpreter *interpreter, enum ErrorCode *errorCode, int symbolIndex, int subLevel, enum ValueType type, union Value *valueReference)
 {
-    if (interpreter->numSimpleVariables >= MAX_SIMPLE_VARIABLES)
+    if (subLevel > 127)
     {
-        *errorCode = ErrorOutOfMemory;
+        *errorCode = ErrorStackOverflow;
         return NULL;
     }
-    if (subLevel > 127)
+    struct SimpleVariable *variable = var_addSimpleVariable(interpreter);
+    if (!variable)
     {
-        *errorCode = ErrorStackOverflow;
+        *errorCode = ErrorOutOfMemory;
         return NULL;
     }
-    struct SimpleVariable *variable = &interpreter->simpleVariables[interpreter->numSimpleVariables];
-    interpreter->numSimpleVariables++;
-    memset(variable, 0, sizeof(struct SimpleVariable));
     variable->symbolIndex = symbolIndex;
     variable->subLevel = subLevel;
     variable->type = type;
@@ -78,7 +98,7 @@ void var_freeSimpleVariables(struct Interpreter *interpreter, int minSubLevel)
 {
     for (int i = interpreter->numSimpleVariables - 1; i >= 0; i--)
     {
-        struct SimpleVariable *variable = &interpreter->simpleVariables[i];
+        struct SimpleVariable *variable = var_getSimpleVariableAt(interpreter, i);
         if (variable->subLevel < minSubLevel)
         {
             break;
@@ -94,12 +114,34 @@ void var_freeSimpleVariables(struct Interpreter *interpreter, int minSubLevel)
     }
 }
 
+struct ArrayVariable *var_getArrayVariableAt(struct Interpreter *interpreter, int index)
+{
+    return &interpreter->arrayVariableBlocks[index / VAR_BLOCK_SIZE][index % VAR_BLOCK_SIZE];
+}
+
+struct ArrayVariable *var_addArrayVariable(struct Interpreter *interpreter)
+{
+    int index = interpreter->numArrayVariables;
+    if (index >= MAX_ARRAY_VARIABLES) return NULL;
+    
+    struct ArrayVariable **block = &interpreter->arrayVariableBlocks[index / VAR_BLOCK_SIZE];
+    if (!*block)
+    {
+        *block = malloc(sizeof(struct ArrayVariable) * VAR_BLOCK_SIZE);
+        if (!*block) return NULL;
+    }
+    interpreter->numArrayVariables++;
+    struct ArrayVariable *variable = &(*block)[index % VAR_BLOCK_SIZE];
+    memset(variable, 0, sizeof(struct ArrayVariable));
+    return variable;
+}
+
 struct ArrayVariable *var_getArrayVariable(struct Interpreter *interpreter, int symbolIndex, int subLevel)
 {
     struct ArrayVariable *variable = NULL;
     for (int i = interpreter->numArrayVariables - 1; i >= 0; i--)
     {
-        variable = &interpreter->arrayVariables[i];
+        variable = var_getArrayVariableAt(interpreter, i);
         if (variable->symbolIndex == symbolIndex && (variable->subLevel == subLevel || variable->subLevel == SUB_LEVEL_GLOBAL))
         {
             // variable found
@@ -140,14 +182,12 @@ struct ArrayVariable *var_dimVariable(struct Interpreter *interpreter, enum Erro
         *errorCode = ErrorVariableAlreadyUsed;
         return NULL;
     }
-    if (interpreter->numArrayVariables >= MAX_ARRAY_VARIABLES)
+    struct ArrayVariable *variable = var_addArrayVariable(interpreter);
+    if (!variable)
     {
         *errorCode = ErrorOutOfMemory;
         return NULL;
     }
-    struct ArrayVariable *variable = &interpreter->arrayVariables[interpreter->numArrayVariables];
-    interpreter->numArrayVariables++;
-    memset(variable, 0, sizeof(struct ArrayVariable));
     variable->symbolIndex = symbolIndex;
     variable->subLevel = interpreter->subLevel;
     variable->isReference = 0;
@@ -172,19 +212,17 @@ struct ArrayVariable *var_dimVariable(struct Interpreter *interpreter, enum Erro
 
 struct ArrayVariable *var_createArrayVariable(struct Interpreter *interpreter, enum ErrorCode *errorCode, int symbolIndex, int subLevel, struct ArrayVariable *arrayReference)
 {
-    if (interpreter->numArrayVariables >= MAX_ARRAY_VARIABLES)
+    if (subLevel > 127)
     {
-        *errorCode = ErrorOutOfMemory;
+        *errorCode = ErrorStackOverflow;
         return NULL;
     }
-    if (subLevel > 127)
+    struct ArrayVariable *variable = var_addArrayVariable(interpreter);
+    if (!variable)
     {
-        *errorCode = ErrorStackOverflow;
+        *errorCode = ErrorOutOfMemory;
         return NULL;
     }
-    struct ArrayVariable *variable = &interpreter->arrayVariables[interpreter->numArrayVariables];
-    interpreter->numArrayVariables++;
-    memset(variable, 0, sizeof(struct ArrayVariable));
     variable->symbolIndex = symbolIndex;
     variable->subLevel = subLevel;
     variable->isReference = 1;
@@ -203,7 +241,7 @@ void var_freeArrayVariables(struct Interpreter *interpreter, int minSubLevel)
 {
     for (int i = interpreter->numArrayVariables - 1; i >= 0; i--)
     {
-        struct ArrayVariable *variable = &interpreter->arrayVariables[i];
+        struct ArrayVariable *variable = var_getArrayVariableAt(interpreter, i);
         if (variable->subLevel < minSubLevel)
         {
             break;
@@ -235,3 +273,45 @@ void var_freeArrayVariables(struct Interpreter *interpreter, int minSubLevel)
         }
     }
 }
+
+void var_freeBlocks(struct Interpreter *interpreter)
+{
+    for (int i = 0; i < MAX_SIMPLE_VARIABLES / VAR_BLOCK_SIZE; i++)
+    {
+        free(interpreter->simpleVariableBlocks[i]);
+        interpreter->simpleVariableBlocks[i] = NULL;
+    }
+    for (int i = 0; i < MAX_ARRAY_VARIABLES / VAR_BLOCK_SIZE; i++)
+    {
+        free(interpreter->arrayVariableBlocks[i]);
+        interpreter->arrayVariableBlocks[i] = NULL;
+    }
+}
+
+size_t var_getMemorySize(struct Interpreter *interpreter)
+{
+    size_t size = 0;
+    for (int i = 0; i < MAX_SIMPLE_VARIABLES / VAR_BLOCK_SIZE; i++)
+    {
+        if (interpreter->simpleVariableBlocks[i])
+        {
+            size += sizeof(struct SimpleVariable) * VAR_BLOCK_SIZE;
+        }
+    }
+    for (int i = 0; i < MAX_ARRAY_VARIABLES / VAR_BLOCK_SIZE; i++)
+    {
+        if (interpreter->arrayVariableBlocks[i])
+        {
+            size += sizeof(struct ArrayVariable) * VAR_BLOCK_SIZE;
+        }
+    }
+    for (int i = 0; i < interpreter->numArrayVariables; i++)
+    {
+        struct ArrayVariable *variable = var_getArrayVariableAt(interpreter, i);
+        if (!variable->isReference)
+        {
+            size += sizeof(union Value) * variable->numValues;
+        }
+    }
+    return size;
+}
@@ -29,6 +29,9 @@
 
 #define SUB_LEVEL_GLOBAL -1
 
+// variables are allocated in blocks, which never move while the program runs
+#define VAR_BLOCK_SIZE 32
+
 struct Core;
 struct Interpreter;
 
@@ -51,14 +54,21 @@ struct ArrayVariable {
     union Value *values;
 };
 
+struct SimpleVariable *var_getSimpleVariableAt(struct Interpreter *interpreter, int index);
+struct SimpleVariable *var_addSimpleVariable(struct Interpreter *interpreter);
 struct SimpleVariable *var_getSimpleVariable(struct Interpreter *interpreter, int symbolIndex, int subLevel);
 struct SimpleVariable *var_createSimpleVariable(struct Interpreter *interpreter, enum ErrorCode *errorCode, int symbolIndex, int subLevel, enum ValueType type, union Value *valueReference);
 void var_freeSimpleVariables(struct Interpreter *interpreter, int minSubLevel);
 
+struct ArrayVariable *var_getArrayVariableAt(struct Interpreter *interpreter, int index);
+struct ArrayVariable *var_addArrayVariable(struct Interpreter *interpreter);
 struct ArrayVariable *var_getArrayVariable(struct Interpreter *interpreter, int symbolIndex, int subLevel);
 union Value *var_getArrayValue(struct Interpreter *interpreter, struct ArrayVariable *variable, int *indices);
 struct ArrayVariable *var_dimVariable(struct Interpreter *interpreter, enum ErrorCode *errorCode, int symbolIndex, int numDimensions, int *dimensionSizes);
 struct ArrayVariable *var_createArrayVariable(struct Interpreter *interpreter, enum ErrorCode *errorCode, int symbolIndex, int subLevel, struct ArrayVariable *arrayReference);
 void var_freeArrayVariables(struct Interpreter *interpreter, int minSubLevel);
 
+void var_freeBlocks(struct Interpreter *interpreter);
+size_t var_getMemorySize(struct Interpreter *interpreter);
+
 #endif /* variables_h */
@@ -24,6 +24,6 @@
 #include <stdio.h>
 #include <stdint.h>
 
-extern uint8_t DefaultCharacters[][16];
+extern const uint8_t DefaultCharacters[][16];
 
 #endif /* default_characters_h */
@@ -27,7 +27,8 @@
 
 void runStartupSequence(struct Core *core)
 {
-    struct DataEntry *entries = core->interpreter->romDataManager.entries;
+    struct Program *program = core->interpreter->program;
+    struct DataEntry *entries = program->romDataManager.entries;
     
     // init font and window
     struct TextLib *textLib = &core->interpreter->textLib;
@@ -37,7 +38,8 @@ void runStartupSequence(struct Core *core)
     // default characters/font
     if (strcmp(entries[0].comment, "FONT") == 0)
     {
-        memcpy(&core->machine->videoRam.characters[FONT_CHAR_OFFSET], &core->machine->cartridgeRom[entries[0].start], entries[0].length);
+        memcpy(&core->machine->videoRam.characters[FONT_CHAR_OFFSET], &program->rom[entries[0].start], entries[0].length);
+        machine_markDirty(core, 0x8000 + FONT_CHAR_OFFSET * sizeof(struct Character), entries[0].length);
     }
     
     // default palettes
@@ -74,16 +76,17 @@ void runStartupSequence(struct Core *core)
     // main palettes
     int palLen = entries[1].length;
     if (palLen > 32) palLen = 32;
-    memcpy(core->machine->colorRegisters.colors, &core->machine->cartridgeRom[entries[1].start], palLen);
+    memcpy(core->machine->colorRegisters.colors, &program->rom[entries[1].start], palLen);
     
     // main characters
-    memcpy(core->machine->videoRam.characters, &core->machine->cartridgeRom[entries[2].start], entries[2].length);
+    memcpy(core->machine->videoRam.characters, &program->rom[entries[2].start], entries[2].length);
+    machine_markDirty(core, 0x8000, entries[2].length);
 
     // main background source
     int bgStart = entries[3].start;
     core->interpreter->textLib.sourceAddress = bgStart + 4;
-    core->interpreter->textLib.sourceWidth = core->machine->cartridgeRom[bgStart + 2];
-    core->interpreter->textLib.sourceHeight = core->machine->cartridgeRom[bgStart + 3];
+    core->interpreter->textLib.sourceWidth = program->rom[bgStart + 2];
+    core->interpreter->textLib.sourceHeight = program->rom[bgStart + 3];
     
     // voices
     for (int i = 0; i < NUM_VOICES; i++)
@@ -42,7 +42,17 @@ struct Plane *txtlib_getBackground(struct TextLib *lib, int bg)
     }
 }
 
-void txtlib_setCellAt(struct Plane *plane, int x, int y, int character, union CharacterAttributes attr)
+void txtlib_markCellDirty(struct TextLib *lib, struct Plane *plane, struct Cell *cell)
+{
+    // the overlay is not part of the machine's memory
+    if (plane != &lib->core->overlay->plane)
+    {
+        int address = MACHINE_ROM_SIZE + (int)((uint8_t *)cell - (uint8_t *)lib->core->machine);
+        machine_markDirty(lib->core, address, sizeof(struct Cell));
+    }
+}
+
+void txtlib_setCellAt(struct TextLib *lib, struct Plane *plane, int x, int y, int character, union CharacterAttributes attr)
 {
     struct Cell *cell = &plane->cells[y & 0x1F][x & 0x1F];
     if (character >= 0)
@@ -50,15 +60,17 @@ void txtlib_setCellAt(struct Plane *plane, int x, int y, int character, union Ch
         cell->character = character;
     }
     cell->attr = attr;
+    txtlib_markCellDirty(lib, plane, cell);
 }
 
-void txtlib_scrollRow(struct Plane *plane, int fromX, int toX, int y, int deltaX, int deltaY)
+void txtlib_scrollRow(struct TextLib *lib, struct Plane *plane, int fromX, int toX, int y, int deltaX, int deltaY)
 {
     if (deltaX > 0)
     {
         for (int x = toX; x > fromX; x--)
         {
             plane->cells[y][x] = plane->cells[(y - deltaY) & 0x1F][(x - deltaX) & 0x1F];
+            txtlib_markCellDirty(lib, plane, &plane->cells[y][x]);
         }
     }
     else if (deltaX < 0)
@@ -66,6 +78,7 @@ void txtlib_scrollRow(struct Plane *plane, int fromX, int toX, int y, int deltaX
         for (int x = fromX; x < toX; x++)
         {
             plane->cells[y][x] = plane->cells[(y - deltaY) & 0x1F][(x - deltaX) & 0x1F];
+            txtlib_markCellDirty(lib, plane, &plane->cells[y][x]);
         }
     }
     else
@@ -73,31 +86,32 @@ void txtlib_scrollRow(struct Plane *plane, int fromX, int toX, int y, int deltaX
         for (int x = fromX; x <= toX; x++)
         {
             plane->cells[y][x] = plane->cells[(y - deltaY) & 0x1F][(x - deltaX) & 0x1F];
+            txtlib_markCellDirty(lib, plane, &plane->cells[y][x]);
         }
     }
 }
 
-void txtlib_scroll(struct Plane *plane, int fromX, int fromY, int toX, int toY, int deltaX, int deltaY)
+void txtlib_scroll(struct TextLib *lib, struct Plane *plane, int fromX, int fromY, int toX, int toY, int deltaX, int deltaY)
 {
     if (deltaY > 0)
     {
         for (int y = toY; y > fromY; y--)
         {
-            txtlib_scrollRow(plane, fromX, toX, y, deltaX, deltaY);
+            txtlib_scrollRow(lib, plane, fromX, toX, y, deltaX, deltaY);
         }
     }
     else if (deltaY < 0)
     {
         for (int y = fromY; y < toY; y++)
         {
-            txtlib_scrollRow(plane, fromX, toX, y, deltaX, deltaY);
+            txtlib_scrollRow(lib, plane, fromX, toX, y, deltaX, deltaY);
         }
     }
     else
     {
         for (int y = fromY; y <= toY; y++)
         {
-            txtlib_scrollRow(plane, fromX, toX, y, deltaX, deltaY);
+            txtlib_scrollRow(lib, plane, fromX, toX, y, deltaX, deltaY);
         }
     }
 }
@@ -109,14 +123,14 @@ void txtlib_scrollWindowIfNeeded(struct TextLib *lib)
     if (lib->cursorY >= lib->windowHeight)
     {
         // scroll
-        txtlib_scroll(plane, lib->windowX, lib->windowY, lib->windowX + lib->windowWidth - 1, lib->windowY + lib->windowHeight - 1, 0, -1);
+        txtlib_scroll(lib, plane, lib->windowX, lib->windowY, lib->windowX + lib->windowWidth - 1, lib->windowY + lib->windowHeight - 1, 0, -1);
         
         // clear bottom line
         int py = lib->windowY + lib->windowHeight - 1;
         for (int x = 0; x < lib->windowWidth; x++)
         {
             int px = x + lib->windowX;
-            txtlib_setCellAt(plane, px, py, lib->fontCharOffset, lib->charAttr); // space
+            txtlib_setCellAt(lib, plane, px, py, lib->fontCharOffset, lib->charAttr); // space
         }
         
         lib->cursorY = lib->windowHeight - 1;
@@ -146,7 +160,7 @@ void txtlib_printText(struct TextLib *lib, const char *text)
             {
                 printableLetter -= 32;
             }
-            txtlib_setCellAt(plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset + (printableLetter - 32), lib->charAttr);
+            txtlib_setCellAt(lib, plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset + (printableLetter - 32), lib->charAttr);
             if (lib->windowBg != OVERLAY_BG)
             {
                 lib->core->interpreter->cycles += 2;
@@ -174,7 +188,7 @@ bool txtlib_deleteBackward(struct TextLib *lib)
     struct Plane *plane = txtlib_getBackground(lib, lib->windowBg);
     
     // clear cursor
-    txtlib_setCellAt(plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
+    txtlib_setCellAt(lib, plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
     
     // move back cursor
     if (lib->cursorX > 0)
@@ -192,7 +206,7 @@ bool txtlib_deleteBackward(struct TextLib *lib)
     }
     
     // clear cell
-    txtlib_setCellAt(plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
+    txtlib_setCellAt(lib, plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
     
     lib->core->interpreter->cycles += 4;
     return true;
@@ -211,7 +225,7 @@ void txtlib_writeText(struct TextLib *lib, const char *text, int x, int y)
             {
                 printableLetter -= 32;
             }
-            txtlib_setCellAt(plane, x, y, lib->fontCharOffset + (printableLetter - 32), lib->charAttr);
+            txtlib_setCellAt(lib, plane, x, y, lib->fontCharOffset + (printableLetter - 32), lib->charAttr);
             if (lib->windowBg != OVERLAY_BG)
             {
                 lib->core->interpreter->cycles += 2;
@@ -230,7 +244,7 @@ void txtlib_writeNumber(struct TextLib *lib, int number, int digits, int x, int
     {
         // negative number
         number *= -1;
-        txtlib_setCellAt(plane, x, y, lib->fontCharOffset + 13, lib->charAttr); // "-"
+        txtlib_setCellAt(lib, plane, x, y, lib->fontCharOffset + 13, lib->charAttr); // "-"
         x += digits;
         digits--;
     }
@@ -243,7 +257,7 @@ void txtlib_writeNumber(struct TextLib *lib, int number, int digits, int x, int
     for (int i = 0; i < digits; i++)
     {
         x--;
-        txtlib_setCellAt(plane, x, y, lib->fontCharOffset + ((number / div) % 10 + 16), lib->charAttr);
+        txtlib_setCellAt(lib, plane, x, y, lib->fontCharOffset + ((number / div) % 10 + 16), lib->charAttr);
         div *= 10;
     }
     
@@ -288,7 +302,7 @@ bool txtlib_inputUpdate(struct TextLib *lib)
         else if (key == CoreInputKeyReturn)
         {
             // clear cursor
-            txtlib_setCellAt(plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
+            txtlib_setCellAt(lib, plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset, lib->charAttr);
             txtlib_printText(lib, "\n");
             done = true;
         }
@@ -309,7 +323,7 @@ bool txtlib_inputUpdate(struct TextLib *lib)
     }
     if (!done)
     {
-        txtlib_setCellAt(plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset + (lib->blink++ < 30 ? 63 : 0), lib->charAttr);
+        txtlib_setCellAt(lib, plane, lib->cursorX + lib->windowX, lib->cursorY + lib->windowY, lib->fontCharOffset + (lib->blink++ < 30 ? 63 : 0), lib->charAttr);
         if (lib->blink == 60)
         {
             lib->blink = 0;
@@ -330,7 +344,7 @@ void txtlib_clearWindow(struct TextLib *lib)
         for (int x = 0; x < lib->windowWidth; x++)
         {
             int px = x + lib->windowX;
-            txtlib_setCellAt(plane, px, py, lib->fontCharOffset, lib->charAttr);
+            txtlib_setCellAt(lib, plane, px, py, lib->fontCharOffset, lib->charAttr);
         }
     }
     lib->core->interpreter->cycles += lib->windowWidth * lib->windowHeight * 2;
@@ -342,6 +356,7 @@ void txtlib_clearScreen(struct TextLib *lib)
     
     memset(&lib->core->machine->videoRam.planeA, 0, sizeof(struct Plane));
     memset(&lib->core->machine->videoRam.planeB, 0, sizeof(struct Plane));
+    machine_markDirty(lib->core, 0x9000, sizeof(struct Plane) * 2);
     
     reg->scrollAX = 0;
     reg->scrollAY = 0;
@@ -366,6 +381,10 @@ void txtlib_clearBackground(struct TextLib *lib, int bg)
 {
     struct Plane *plane = txtlib_getBackground(lib, bg);
     memset(plane, 0, sizeof(struct Plane));
+    if (bg != OVERLAY_BG)
+    {
+        machine_markDirty(lib->core, MACHINE_ROM_SIZE + (int)((uint8_t *)plane - (uint8_t *)lib->core->machine), sizeof(struct Plane));
+    }
     lib->core->interpreter->cycles += PLANE_COLUMNS * PLANE_ROWS * 2;
 }
 
@@ -378,7 +397,18 @@ struct Cell *txtlib_getCell(struct TextLib *lib, int x, int y)
 void txtlib_setCell(struct TextLib *lib, int x, int y, int character)
 {
     struct Plane *plane = txtlib_getBackground(lib, lib->bg);
-    txtlib_setCellAt(plane, x, y, character, lib->charAttr);
+    txtlib_setCellAt(lib, plane, x, y, character, lib->charAttr);
+}
+
+void txtlib_setCellAttr(struct TextLib *lib, int x, int y, int pal, int flipX, int flipY, int prio)
+{
+    struct Plane *plane = txtlib_getBackground(lib, lib->bg);
+    struct Cell *cell = &plane->cells[y & 0x1F][x & 0x1F];
+    if (pal >= 0) cell->attr.palette = pal;
+    if (flipX >= 0) cell->attr.flipX = flipX;
+    if (flipY >= 0) cell->attr.flipY = flipY;
+    if (prio >= 0) cell->attr.priority = prio;
+    txtlib_markCellDirty(lib, plane, cell);
 }
 
 void txtlib_setCells(struct TextLib *lib, int fromX, int fromY, int toX, int toY, int character)
@@ -388,7 +418,7 @@ void txtlib_setCells(struct TextLib *lib, int fromX, int fromY, int toX, int toY
     {
         for (int x = fromX; x <= toX; x++)
         {
-            txtlib_setCellAt(plane, x, y, character, lib->charAttr);
+            txtlib_setCellAt(lib, plane, x, y, character, lib->charAttr);
         }
     }
     lib->core->interpreter->cycles += (toX - fromX + 1) * (toY - fromY + 1) * 2;
@@ -406,6 +436,7 @@ void txtlib_setCellsAttr(struct TextLib *lib, int fromX, int fromY, int toX, int
             if (flipX >= 0) cell->attr.flipX = flipX;
             if (flipY >= 0) cell->attr.flipY = flipY;
             if (prio >= 0) cell->attr.priority = prio;
+            txtlib_markCellDirty(lib, plane, cell);
         }
     }
     lib->core->interpreter->cycles += (toX - fromX + 1) * (toY - fromY + 1) * 2;
@@ -414,7 +445,7 @@ void txtlib_setCellsAttr(struct TextLib *lib, int fromX, int fromY, int toX, int
 void txtlib_scrollBackground(struct TextLib *lib, int fromX, int fromY, int toX, int toY, int deltaX, int deltaY)
 {
     struct Plane *plane = txtlib_getBackground(lib, lib->bg);
-    txtlib_scroll(plane, fromX, fromY, toX, toY, deltaX, deltaY);
+    txtlib_scroll(lib, plane, fromX, fromY, toX, toY, deltaX, deltaY);
     lib->core->interpreter->cycles += (toX - fromX + 1) * (toY - fromY + 1) * 2;
 }
 
@@ -432,6 +463,7 @@ void txtlib_copyBackground(struct TextLib *lib, int srcX, int srcY, int width, i
             struct Cell *cell = &plane->cells[py & 0x1F][px & 0x1F];
             cell->character = machine_peek(lib->core, addr++);
             cell->attr.value = machine_peek(lib->core, addr++);
+            txtlib_markCellDirty(lib, plane, cell);
         }
     }
     lib->core->interpreter->cycles += width * height * 2;
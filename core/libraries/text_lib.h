@@ -62,6 +62,7 @@ void txtlib_clearScreen(struct TextLib *lib);
 void txtlib_clearBackground(struct TextLib *lib, int bg);
 struct Cell *txtlib_getCell(struct TextLib *lib, int x, int y);
 void txtlib_setCell(struct TextLib *lib, int x, int y, int character);
+void txtlib_setCellAttr(struct TextLib *lib, int x, int y, int pal, int flipX, int flipY, int prio);
 void txtlib_setCells(struct TextLib *lib, int fromX, int fromY, int toX, int toY, int character);
 void txtlib_setCellsAttr(struct TextLib *lib, int fromX, int fromY, int toX, int toY, int pal, int flipX, int flipY, int prio);
 void txtlib_scrollBackground(struct TextLib *lib, int fromX, int fromY, int toX, int toY, int deltaX, int deltaY);
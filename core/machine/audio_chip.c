@@ -80,7 +80,10 @@ const int lfoAmounts[16] = {
     256
 };
 
+int audio_calcBufferSamples(struct AudioInternals *internals, int outputFrequency);
 void audio_renderAudioBuffer(struct AudioRegisters *lifeRegisters, struct AudioRegisters *registers, struct AudioInternals *internals, int16_t *stereoOutput, int numSamples, int outputFrequency, int volume);
+void audio_renderVoiceBlock(struct Voice *lifeVoice, struct Voice *voice, struct VoiceInternals *voiceIn, int32_t *output, int numFrames, int outputFrequency);
+void audio_filterBlock(int32_t *filterBuffer, int32_t *samples, int numFrames);
 
 
 void audio_reset(struct Core *core)
@@ -130,30 +133,67 @@ void audio_renderAudio(struct Core *core, int16_t *stereoOutput, int numSamples,
     struct AudioInternals *internals = &core->machineInternals->audioInternals;
     struct AudioRegisters *lifeRegisters = &core->machine->audioRegisters;
     
-    int numSamplesPerUpdate = outputFrequency / 60 * NUM_CHANNELS;
+    metrics_audioWillRender(core);
+    
     int offset = 0;
     
     while (offset < numSamples)
     {
+        if (internals->bufferSamplesLeft <= 0)
+        {
+            internals->bufferSamplesLeft = audio_calcBufferSamples(internals, outputFrequency);
+        }
+        
+        int numSamplesPerUpdate = internals->bufferSamplesLeft;
         if (offset + numSamplesPerUpdate > numSamples)
         {
             numSamplesPerUpdate = numSamples - offset;
         }
         int readBufferIndex = internals->readBufferIndex;
         audio_renderAudioBuffer(lifeRegisters, &internals->buffers[readBufferIndex], internals, &stereoOutput[offset], numSamplesPerUpdate, outputFrequency, volume);
-        if (internals->writeBufferIndex != -1 && internals->writeBufferIndex != readBufferIndex)
+        
+        internals->bufferSamplesLeft -= numSamplesPerUpdate;
+        if (internals->bufferSamplesLeft == 0 && internals->writeBufferIndex != -1 && internals->writeBufferIndex != readBufferIndex)
         {
             internals->readBufferIndex = (readBufferIndex + 1) % NUM_AUDIO_BUFFERS;
         }
         
         offset += numSamplesPerUpdate;
     }
+    
+    metrics_audioDidRender(core);
 }
 
-void audio_renderAudioBuffer(struct AudioRegisters *lifeRegisters, struct AudioRegisters *registers, struct AudioInternals *internals, int16_t *stereoOutput, int numSamples, int outputFrequency, int volume)
+int audio_getBufferFill(struct AudioInternals *internals)
 {
-    double overflow = 0xFFFFFF;
+    if (internals->writeBufferIndex == -1)
+    {
+        return NUM_AUDIO_BUFFERS / 2;
+    }
+    return (internals->writeBufferIndex - internals->readBufferIndex + NUM_AUDIO_BUFFERS) % NUM_AUDIO_BUFFERS;
+}
+
+int audio_calcBufferSamples(struct AudioInternals *internals, int outputFrequency)
+{
+    // Play register buffers slightly faster while the ring fills up and slightly slower while it
+    // drains, so the reader follows the writer without repeating or skipping whole buffers.
+    int targetFill = NUM_AUDIO_BUFFERS / 2;
+    double deviation = (double)(audio_getBufferFill(internals) - targetFill) / targetFill;
+    double rate = 1.0 - AUDIO_RATE_CONTROL_MAX_DELTA * deviation;
+    
+    double numFrames = (double)outputFrequency / 60.0 * rate + internals->bufferSamplesFraction;
+    int numFramesInt = (int)numFrames;
+    if (numFramesInt < 1)
+    {
+        numFramesInt = 1;
+    }
+    internals->bufferSamplesFraction = numFrames - numFramesInt;
     
+    return numFramesInt * NUM_CHANNELS;
+}
+
+void audio_renderAudioBuffer(struct AudioRegisters *lifeRegisters, struct AudioRegisters *registers, struct AudioInternals *internals, int16_t *stereoOutput, int numSamples, int outputFrequency, int volume)
+{
     for (int v = 0; v < NUM_VOICES; v++)
     {
         struct Voice *voice = &registers->voices[v];
@@ -172,234 +212,277 @@ void audio_renderAudioBuffer(struct AudioRegisters *lifeRegisters, struct AudioR
         }
     }
     
-    int i = 0;
-    while (i < numSamples)
+    int numFrames = numSamples / NUM_CHANNELS;
+    int offset = 0;
+    while (offset < numFrames)
     {
-        int16_t leftOutput = 0;
-        int16_t rightOutput = 0;
+        int numBlockFrames = numFrames - offset;
+        if (numBlockFrames > AUDIO_BLOCK_SIZE)
+        {
+            numBlockFrames = AUDIO_BLOCK_SIZE;
+        }
+        int16_t *blockOutput = &stereoOutput[offset * NUM_CHANNELS];
         
         if (internals->audioEnabled)
         {
+            int32_t leftOutput[AUDIO_BLOCK_SIZE];
+            int32_t rightOutput[AUDIO_BLOCK_SIZE];
+            int32_t voiceOutput[AUDIO_BLOCK_SIZE];
+            
+            memset(leftOutput, 0, sizeof(int32_t) * numBlockFrames);
+            memset(rightOutput, 0, sizeof(int32_t) * numBlockFrames);
+            
             for (int v = 0; v < NUM_VOICES; v++)
             {
                 struct Voice *voice = &registers->voices[v];
-                struct VoiceInternals *voiceIn = &internals->voices[v];
                 
                 int freq = (voice->frequencyHigh << 8) | voice->frequencyLow;
                 if (freq == 0) continue;
                 
-                int volume = voice->status.volume << 4;
-                int pulseWidth = voice->attr.pulseWidth << 4;
+                audio_renderVoiceBlock(&lifeRegisters->voices[v], voice, &internals->voices[v], voiceOutput, numBlockFrames, outputFrequency);
                 
-                // --- LFO ---
-                
-                uint8_t lfoAccu8Last = voiceIn->lfoAccumulator;
-                if (!voiceIn->lfoHold)
+                if (voice->status.mix & 0x01)
                 {
-                    double lfoRate = lfoRates[voice->lfoFrequency];
-                    double lfoAccumulator = voiceIn->lfoAccumulator + lfoRate / (double)outputFrequency;
-                    if (voice->lfoAttr.envMode && lfoAccumulator >= 255.0)
+                    for (int i = 0; i < numBlockFrames; i++)
                     {
-                        lfoAccumulator = 255.0;
-                        voiceIn->lfoHold = true;
+                        leftOutput[i] += voiceOutput[i];
                     }
-                    else if (lfoAccumulator >= 256.0)
-                    {
-                        // avoid overflow and loss of precision
-                        lfoAccumulator -= 256.0;
-                    }
-                    voiceIn->lfoAccumulator = lfoAccumulator;
                 }
-                uint8_t lfoAccu8 = voiceIn->lfoAccumulator;
-                uint8_t lfoSample = 0;
-                
-                enum LFOWaveType lfoWaveType = voice->lfoAttr.wave;
-                switch (lfoWaveType)
+                if (voice->status.mix & 0x02)
                 {
-                    case LFOWaveTypeTriangle:
-                    {
-                        lfoSample = ((lfoAccu8 & 0x80) ? ~(lfoAccu8 << 1) : (lfoAccu8 << 1));
-                        break;
-                    }
-                    case LFOWaveTypeSawtooth:
-                    {
-                        lfoSample = ~lfoAccu8;
-                        break;
-                    }
-                    case LFOWaveTypeSquare:
+                    for (int i = 0; i < numBlockFrames; i++)
                     {
-                        lfoSample = (lfoAccu8 & 0x80) ? 0x00 : 0xFF;
-                        break;
-                    }
-                    case LFOWaveTypeRandom:
-                    {
-                        if ((lfoAccu8 & 0x80) != (lfoAccu8Last & 0x80))
-                        {
-                            uint16_t r = voiceIn->lfoRandom;
-                            uint16_t bit = ((r >> 0) ^ (r >> 2) ^ (r >> 3) ^ (r >> 5) ) & 1;
-                            voiceIn->lfoRandom = (r >> 1) | (bit << 15);
-                        }
-                        lfoSample = voiceIn->lfoRandom & 0xFF;
-                        break;
+                        rightOutput[i] += voiceOutput[i];
                     }
                 }
-                
-                int freqAmount = lfoAmounts[voice->lfoOscAmount];
-                int volAmount = voice->lfoVolAmount;
-                int pwAmount = voice->lfoPWAmount;
-                
-                int freqMod = freq * lfoSample * freqAmount >> 16;
-                if (voice->lfoAttr.invert) freq -= freqMod; else freq += freqMod;
-                if (freq < 1) freq = 1;
-                if (freq > 65535) freq = 65535;
-                
-                if (voice->lfoAttr.invert)
+            }
+            
+            audio_filterBlock(internals->filterBuffer[0], leftOutput, numBlockFrames);
+            audio_filterBlock(internals->filterBuffer[1], rightOutput, numBlockFrames);
+            
+            for (int i = 0; i < numBlockFrames; i++)
+            {
+                int32_t left = leftOutput[i] >> volume;
+                int32_t right = rightOutput[i] >> volume;
+                blockOutput[i * NUM_CHANNELS] = (left < INT16_MIN) ? INT16_MIN : (left > INT16_MAX) ? INT16_MAX : left;
+                blockOutput[i * NUM_CHANNELS + 1] = (right < INT16_MIN) ? INT16_MIN : (right > INT16_MAX) ? INT16_MAX : right;
+            }
+        }
+        else
+        {
+            memset(blockOutput, 0, sizeof(int16_t) * numBlockFrames * NUM_CHANNELS);
+        }
+        
+        offset += numBlockFrames;
+    }
+}
+
+void audio_renderVoiceBlock(struct Voice *lifeVoice, struct Voice *voice, struct VoiceInternals *voiceIn, int32_t *output, int numFrames, int outputFrequency)
+{
+    double overflow = 0xFFFFFF;
+    
+    for (int i = 0; i < numFrames; i++)
+    {
+        int freq = (voice->frequencyHigh << 8) | voice->frequencyLow;
+        int volume = voice->status.volume << 4;
+        int pulseWidth = voice->attr.pulseWidth << 4;
+        
+        // --- LFO ---
+        
+        uint8_t lfoAccu8Last = voiceIn->lfoAccumulator;
+        if (!voiceIn->lfoHold)
+        {
+            double lfoRate = lfoRates[voice->lfoFrequency];
+            double lfoAccumulator = voiceIn->lfoAccumulator + lfoRate / (double)outputFrequency;
+            if (voice->lfoAttr.envMode && lfoAccumulator >= 255.0)
+            {
+                lfoAccumulator = 255.0;
+                voiceIn->lfoHold = true;
+            }
+            else if (lfoAccumulator >= 256.0)
+            {
+                // avoid overflow and loss of precision
+                lfoAccumulator -= 256.0;
+            }
+            voiceIn->lfoAccumulator = lfoAccumulator;
+        }
+        uint8_t lfoAccu8 = voiceIn->lfoAccumulator;
+        uint8_t lfoSample = 0;
+        
+        enum LFOWaveType lfoWaveType = voice->lfoAttr.wave;
+        switch (lfoWaveType)
+        {
+            case LFOWaveTypeTriangle:
+            {
+                lfoSample = ((lfoAccu8 & 0x80) ? ~(lfoAccu8 << 1) : (lfoAccu8 << 1));
+                break;
+            }
+            case LFOWaveTypeSawtooth:
+            {
+                lfoSample = ~lfoAccu8;
+                break;
+            }
+            case LFOWaveTypeSquare:
+            {
+                lfoSample = (lfoAccu8 & 0x80) ? 0x00 : 0xFF;
+                break;
+            }
+            case LFOWaveTypeRandom:
+            {
+                if ((lfoAccu8 & 0x80) != (lfoAccu8Last & 0x80))
                 {
-                    volume -= volume * lfoSample * volAmount >> 12;
+                    uint16_t r = voiceIn->lfoRandom;
+                    uint16_t bit = ((r >> 0) ^ (r >> 2) ^ (r >> 3) ^ (r >> 5) ) & 1;
+                    voiceIn->lfoRandom = (r >> 1) | (bit << 15);
                 }
-                else
+                lfoSample = voiceIn->lfoRandom & 0xFF;
+                break;
+            }
+        }
+        
+        int freqAmount = lfoAmounts[voice->lfoOscAmount];
+        int volAmount = voice->lfoVolAmount;
+        int pwAmount = voice->lfoPWAmount;
+        
+        int freqMod = freq * lfoSample * freqAmount >> 16;
+        if (voice->lfoAttr.invert) freq -= freqMod; else freq += freqMod;
+        if (freq < 1) freq = 1;
+        if (freq > 65535) freq = 65535;
+        
+        if (voice->lfoAttr.invert)
+        {
+            volume -= volume * lfoSample * volAmount >> 12;
+        }
+        else
+        {
+            volume -= volume * (~lfoSample & 0xFF) * volAmount >> 12;
+        }
+        if (volume < 0) volume = 0;
+        if (volume > 255) volume = 255;
+        
+        int pwMod = lfoSample * pwAmount >> 4;
+        if (voice->lfoAttr.invert) pulseWidth -= pwMod; else pulseWidth += pwMod;
+        if (pulseWidth < 0) pulseWidth = 0;
+        if (pulseWidth > 254) pulseWidth = 254;
+        
+        // --- WAVEFORM GENERATOR ---
+        
+        uint16_t accu16Last = ((uint32_t)voiceIn->accumulator >> 4) & 0xFFFF;
+        double accumulator = voiceIn->accumulator + (double)freq * 65536.0 / (double)outputFrequency;
+        if (accumulator >= overflow)
+        {
+            // avoid overflow and loss of precision
+            accumulator -= overflow;
+        }
+        voiceIn->accumulator = accumulator;
+        uint16_t accu16 = ((uint32_t)voiceIn->accumulator >> 4) & 0xFFFF;
+        
+        uint16_t sample = 0x7FFF; // silence
+        
+        enum WaveType waveType = voice->attr.wave;
+        switch (waveType)
+        {
+            case WaveTypeSawtooth:
+            {
+                sample = accu16;
+                break;
+            }
+            case WaveTypePulse:
+            {
+                sample = ((accu16 >> 8) > pulseWidth) ? 0xFFFF : 0x0000;
+                break;
+            }
+            case WaveTypeTriangle:
+            {
+                sample = ((accu16 & 0x8000) ? ~(accu16 << 1) : (accu16 << 1));
+                break;
+            }
+            case WaveTypeNoise:
+            {
+                if ((accu16 & 0x1000) != (accu16Last & 0x1000))
                 {
-                    volume -= volume * (~lfoSample & 0xFF) * volAmount >> 12;
+                    uint16_t r = voiceIn->noiseRandom;
+                    uint16_t bit = ((r >> 0) ^ (r >> 2) ^ (r >> 3) ^ (r >> 5) ) & 1;
+                    voiceIn->noiseRandom = (r >> 1) | (bit << 15);
                 }
-                if (volume < 0) volume = 0;
-                if (volume > 255) volume = 255;
-                
-                int pwMod = lfoSample * pwAmount >> 4;
-                if (voice->lfoAttr.invert) pulseWidth -= pwMod; else pulseWidth += pwMod;
-                if (pulseWidth < 0) pulseWidth = 0;
-                if (pulseWidth > 254) pulseWidth = 254;
-                
-//                if (i == 0 && v == 0) printf("pulseWidth %d\n", pulseWidth);
-                
-                // --- WAVEFORM GENERATOR ---
-                
-                uint16_t accu16Last = ((uint32_t)voiceIn->accumulator >> 4) & 0xFFFF;
-                double accumulator = voiceIn->accumulator + (double)freq * 65536.0 / (double)outputFrequency;
-                if (accumulator >= overflow)
+                sample = voiceIn->noiseRandom & 0xFFFF;
+                break;
+            }
+        }
+        
+        // --- TIMEOUT ---
+        
+        if (voice->attr.timeout)
+        {
+            voiceIn->timeoutCounter -= 60.0 / outputFrequency;
+            if (voiceIn->timeoutCounter <= 0.0)
+            {
+                voiceIn->timeoutCounter = 0.0;
+                voice->status.gate = 0;
+            }
+        }
+        
+        // --- ENVELOPE GENERATOR ---
+        
+        if (!voice->status.gate)
+        {
+            voiceIn->envState = EnvStateRelease;
+        }
+        
+        switch (voiceIn->envState) {
+            case EnvStateAttack:
+                voiceIn->envCounter += envRates[voice->envA] / outputFrequency;
+                if (voiceIn->envCounter >= 255.0)
                 {
-                    // avoid overflow and loss of precision
-                    accumulator -= overflow;
+                    voiceIn->envCounter = 255.0;
+                    voiceIn->envState = EnvStateDecay;
                 }
-                voiceIn->accumulator = accumulator;
-                uint16_t accu16 = ((uint32_t)voiceIn->accumulator >> 4) & 0xFFFF;
+                break;
                 
-                uint16_t sample = 0x7FFF; // silence
-                
-                enum WaveType waveType = voice->attr.wave;
-                switch (waveType)
+            case EnvStateDecay:
+                if (voiceIn->envCounter > voice->envS * 16.0)
                 {
-                    case WaveTypeSawtooth:
-                    {
-                        sample = accu16;
-                        break;
-                    }
-                    case WaveTypePulse:
-                    {
-                        sample = ((accu16 >> 8) > pulseWidth) ? 0xFFFF : 0x0000;
-                        break;
-                    }
-                    case WaveTypeTriangle:
-                    {
-                        sample = ((accu16 & 0x8000) ? ~(accu16 << 1) : (accu16 << 1));
-                        break;
-                    }
-                    case WaveTypeNoise:
-                    {
-                        if ((accu16 & 0x1000) != (accu16Last & 0x1000))
-                        {
-                            uint16_t r = voiceIn->noiseRandom;
-                            uint16_t bit = ((r >> 0) ^ (r >> 2) ^ (r >> 3) ^ (r >> 5) ) & 1;
-                            voiceIn->noiseRandom = (r >> 1) | (bit << 15);
-                        }
-                        sample = voiceIn->noiseRandom & 0xFFFF;
-                        break;
-                    }
+                    voiceIn->envCounter -= envRates[voice->envD] / outputFrequency;
                 }
+                break;
                 
-                // --- TIMEOUT ---
-                
-                if (voice->attr.timeout)
+            case EnvStateRelease:
+                if (voiceIn->envCounter > 0.0)
                 {
-                    voiceIn->timeoutCounter -= 60.0 / outputFrequency;
-                    if (voiceIn->timeoutCounter <= 0.0)
+                    voiceIn->envCounter -= envRates[voice->envR] / outputFrequency;
+                    if (voiceIn->envCounter < 0.0)
                     {
-                        voiceIn->timeoutCounter = 0.0;
-                        voice->status.gate = 0;
+                        voiceIn->envCounter = 0.0;
                     }
                 }
-                
-                // --- ENVELOPE GENERATOR ---
-                
-                if (!voice->status.gate)
-                {
-                    voiceIn->envState = EnvStateRelease;
-                }
-                
-                switch (voiceIn->envState) {
-                    case EnvStateAttack:
-                        voiceIn->envCounter += envRates[voice->envA] / outputFrequency;
-                        if (voiceIn->envCounter >= 255.0)
-                        {
-                            voiceIn->envCounter = 255.0;
-                            voiceIn->envState = EnvStateDecay;
-                        }
-                        break;
-                        
-                    case EnvStateDecay:
-                        if (voiceIn->envCounter > voice->envS * 16.0)
-                        {
-                            voiceIn->envCounter -= envRates[voice->envD] / outputFrequency;
-                        }
-                        break;
-                        
-                    case EnvStateRelease:
-                        if (voiceIn->envCounter > 0.0)
-                        {
-                            voiceIn->envCounter -= envRates[voice->envR] / outputFrequency;
-                            if (voiceIn->envCounter < 0.0)
-                            {
-                                voiceIn->envCounter = 0.0;
-                            }
-                        }
-                        break;
-                }
-                
-                // --- OUTPUT ---
-                
-                volume = volume * (int)voiceIn->envCounter >> 8;
-                
-                // output peak to system registers
-                lifeRegisters->voices[v].peak = volume;
-                
-                int16_t voiceSample = (((int32_t)(sample - 0x7FFF)) * volume) >> 10; // 8 bit for volume, 2 bit for global
-                if (voice->status.mix & 0x01)
-                {
-                    leftOutput += voiceSample;
-                }
-                if (voice->status.mix & 0x02)
-                {
-                    rightOutput += voiceSample;
-                }
-            }
-            
-            // filter
-            
-            int32_t *filterBufferL = internals->filterBuffer[0];
-            int32_t *filterBufferR = internals->filterBuffer[1];
-            
-            for (int f = AUDIO_FILTER_BUFFER_SIZE - 1; f > 0; f--)
-            {
-                filterBufferL[f] = filterBufferL[f - 1];
-                filterBufferR[f] = filterBufferR[f - 1];
-            }
-            filterBufferL[0] = leftOutput;
-            filterBufferR[0] = rightOutput;
-            
-            leftOutput  = ((filterBufferL[0] >> 4) + (filterBufferL[1] >> 1) + (filterBufferL[2] >> 4));
-            rightOutput = ((filterBufferR[0] >> 4) + (filterBufferR[1] >> 1) + (filterBufferR[2] >> 4));
+                break;
         }
         
-        stereoOutput[i++] = leftOutput >> volume;
-        stereoOutput[i++] = rightOutput >> volume;
+        // --- OUTPUT ---
+        
+        volume = volume * (int)voiceIn->envCounter >> 8;
+        
+        // output peak to system registers
+        lifeVoice->peak = volume;
+        
+        output[i] = (((int32_t)(sample - 0x7FFF)) * volume) >> 10; // 8 bit for volume, 2 bit for global
     }
 }
+
+void audio_filterBlock(int32_t *filterBuffer, int32_t *samples, int numFrames)
+{
+    // 3-tap low-pass over the whole block, filterBuffer keeps the last two input samples (newest first)
+    int32_t history1 = filterBuffer[0];
+    int32_t history2 = filterBuffer[1];
+    
+    for (int i = 0; i < numFrames; i++)
+    {
+        int32_t input = samples[i];
+        samples[i] = (input >> 4) + (history1 >> 1) + (history2 >> 4);
+        history2 = history1;
+        history1 = input;
+    }
+    
+    filterBuffer[0] = history1;
+    filterBuffer[1] = history2;
+}
@@ -29,6 +29,13 @@
 #define NUM_AUDIO_BUFFERS 6
 #define AUDIO_FILTER_BUFFER_SIZE 3
 
+// number of frames mixed and filtered at once
+#define AUDIO_BLOCK_SIZE 256
+
+// maximum deviation from the nominal rate of 60 register buffers per second,
+// used to keep the buffer ring at its target fill level
+#define AUDIO_RATE_CONTROL_MAX_DELTA 0.005
+
 // audio output channels for stereo
 #define NUM_CHANNELS 2
 
@@ -131,11 +138,14 @@ struct AudioInternals {
     int readBufferIndex;
     int writeBufferIndex;
     bool audioEnabled;
+    int bufferSamplesLeft;
+    double bufferSamplesFraction;
     int32_t filterBuffer[NUM_CHANNELS][AUDIO_FILTER_BUFFER_SIZE];
 };
 
 void audio_reset(struct Core *core);
 void audio_bufferRegisters(struct Core *core);
 void audio_renderAudio(struct Core *core, int16_t *output, int numSamples, int outputFrequency, int volume);
+int audio_getBufferFill(struct AudioInternals *internals);
 
 #endif /* audio_chip_h */
@@ -24,15 +24,21 @@
 #include <stdbool.h>
 #include "core.h"
 
+bool machine_isWritableRegion(enum MachineRegion region);
+void machine_willReadRegion(struct Core *core, enum MachineRegion region);
+void machine_willWriteRegion(struct Core *core, enum MachineRegion region);
+void machine_didWriteRegion(struct Core *core, enum MachineRegion region);
+const uint8_t *machine_getReadPointer(struct Core *core, int address);
+
 void machine_init(struct Core *core)
 {
-    assert(sizeof(struct Machine) == 0x10000);
+    assert(sizeof(struct Machine) == 0x10000 - MACHINE_ROM_SIZE);
 }
 
 void machine_reset(struct Core *core, bool resetPersistent)
 {
-    // rom, video ram, working ram
-    memset(core->machine, 0, 0xE000);
+    // video ram, working ram
+    memset(core->machine, 0, 0xE000 - MACHINE_ROM_SIZE);
     
     if (resetPersistent)
     {
@@ -45,6 +51,8 @@ void machine_reset(struct Core *core, bool resetPersistent)
     
     memset(core->machineInternals, 0, sizeof(struct MachineInternals));
     audio_reset(core);
+    
+    machine_markDirty(core, 0, 0x10000);
 }
 
 int machine_peek(struct Core *core, int address)
@@ -59,11 +67,12 @@ int machine_peek(struct Core *core, int address)
         {
             delegate_persistentRamWillAccess(core, core->machine->persistentRam, PERSISTENT_RAM_SIZE);
             core->machineInternals->hasAccessedPersistent = true;
+            machine_markDirty(core, 0xE000, PERSISTENT_RAM_SIZE);
         }
     }
     
     // read byte
-    return *(uint8_t *)((uint8_t *)core->machine + address);
+    return *machine_getReadPointer(core, address);
 }
 
 bool machine_poke(struct Core *core, int address, int value)
@@ -104,12 +113,20 @@ bool machine_poke(struct Core *core, int address, int value)
         {
             delegate_persistentRamWillAccess(core, core->machine->persistentRam, PERSISTENT_RAM_SIZE);
             core->machineInternals->hasAccessedPersistent = true;
+            machine_markDirty(core, 0xE000, PERSISTENT_RAM_SIZE);
+        }
+        if (core->machine->persistentRam[address - 0xE000] != (value & 0xFF))
+        {
+            core->machineInternals->changedPersistentPages |= 1u << ((address - 0xE000) / PERSISTENT_PAGE_SIZE);
         }
-        core->machineInternals->hasChangedPersistent = true;
     }
     
     // write byte
-    *(uint8_t *)((uint8_t *)core->machine + address) = value & 0xFF;
+    *((uint8_t *)core->machine + address - MACHINE_ROM_SIZE) = value & 0xFF;
+    
+    int block = address / MACHINE_DIRTY_BLOCK_SIZE;
+    core->machineInternals->dirtyBlocks[block >> 5] |= (1u << (block & 0x1F));
+    core->metrics->frame.numBytesPoked++;
     
     if (address == 0xFF76) // IO attributes
     {
@@ -122,6 +139,329 @@ bool machine_poke(struct Core *core, int address, int value)
     return true;
 }
 
+// Bulk operations behave like a loop of machine_peek/machine_poke calls and stop at the same byte,
+// but handle whole regions at once. Only the IO registers are written byte by byte.
+
+bool machine_fill(struct Core *core, int address, int length, int value)
+{
+    int offset = 0;
+    while (offset < length)
+    {
+        int current = address + offset;
+        int start, end;
+        enum MachineRegion region = machine_getRegion(current, &start, &end);
+        if (!machine_isWritableRegion(region))
+        {
+            return false;
+        }
+        
+        int count = end - current;
+        if (count > length - offset)
+        {
+            count = length - offset;
+        }
+        
+        if (region == MachineRegionIORegisters)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (!machine_poke(core, current + i, value)) return false;
+            }
+        }
+        else
+        {
+            machine_willWriteRegion(core, region);
+            memset((uint8_t *)core->machine + current - MACHINE_ROM_SIZE, value & 0xFF, count);
+            machine_markDirty(core, current, count);
+            machine_markPersistentChanged(core, current, count);
+            core->metrics->frame.numBytesPoked += count;
+            machine_didWriteRegion(core, region);
+        }
+        offset += count;
+    }
+    return true;
+}
+
+bool machine_write(struct Core *core, int address, const uint8_t *data, int length)
+{
+    int offset = 0;
+    while (offset < length)
+    {
+        int current = address + offset;
+        int start, end;
+        enum MachineRegion region = machine_getRegion(current, &start, &end);
+        if (!machine_isWritableRegion(region))
+        {
+            return false;
+        }
+        
+        int count = end - current;
+        if (count > length - offset)
+        {
+            count = length - offset;
+        }
+        
+        if (region == MachineRegionIORegisters)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (!machine_poke(core, current + i, data[offset + i])) return false;
+            }
+        }
+        else
+        {
+            machine_willWriteRegion(core, region);
+            memcpy((uint8_t *)core->machine + current - MACHINE_ROM_SIZE, &data[offset], count);
+            machine_markDirty(core, current, count);
+            machine_markPersistentChanged(core, current, count);
+            core->metrics->frame.numBytesPoked += count;
+            machine_didWriteRegion(core, region);
+        }
+        offset += count;
+    }
+    return true;
+}
+
+bool machine_copy(struct Core *core, int source, int length, int destination)
+{
+    // overlapping ranges are handled like a byte loop running backwards if source < destination
+    // and forwards otherwise, equal ranges are not touched at all.
+    if (source == destination)
+    {
+        return true;
+    }
+    bool backwards = (source < destination);
+    
+    int remaining = length;
+    while (remaining > 0)
+    {
+        // first byte of this step in iteration order
+        int offset = backwards ? remaining - 1 : length - remaining;
+        
+        int sourceStart, sourceEnd, destinationStart, destinationEnd;
+        enum MachineRegion sourceRegion = machine_getRegion(source + offset, &sourceStart, &sourceEnd);
+        enum MachineRegion destinationRegion = machine_getRegion(destination + offset, &destinationStart, &destinationEnd);
+        if (sourceRegion == MachineRegionInvalid)
+        {
+            return false;
+        }
+        if (!machine_isWritableRegion(destinationRegion))
+        {
+            // the original byte is still read before the write fails
+            machine_peek(core, source + offset);
+            return false;
+        }
+        
+        int count;
+        if (backwards)
+        {
+            count = source + offset + 1 - sourceStart;
+            if (destination + offset + 1 - destinationStart < count) count = destination + offset + 1 - destinationStart;
+        }
+        else
+        {
+            count = sourceEnd - (source + offset);
+            if (destinationEnd - (destination + offset) < count) count = destinationEnd - (destination + offset);
+        }
+        if (count > remaining)
+        {
+            count = remaining;
+        }
+        
+        // lowest offset of this step
+        int first = backwards ? offset - count + 1 : offset;
+        
+        if (destinationRegion == MachineRegionIORegisters)
+        {
+            for (int n = 0; n < count; n++)
+            {
+                int i = backwards ? offset - n : offset + n;
+                int peek = machine_peek(core, source + i);
+                if (!machine_poke(core, destination + i, peek)) return false;
+            }
+        }
+        else
+        {
+            machine_willReadRegion(core, sourceRegion);
+            machine_willWriteRegion(core, destinationRegion);
+            memmove((uint8_t *)core->machine + destination + first - MACHINE_ROM_SIZE, machine_getReadPointer(core, source + first), count);
+            machine_markDirty(core, destination + first, count);
+            machine_markPersistentChanged(core, destination + first, count);
+            core->metrics->frame.numBytesPoked += count;
+            machine_didWriteRegion(core, destinationRegion);
+        }
+        remaining -= count;
+    }
+    return true;
+}
+
+/** Copies memory without any side effects, like triggering the persistent RAM delegate */
+void machine_read(struct Core *core, int address, uint8_t *data, int length)
+{
+    while (length > 0)
+    {
+        int count = length;
+        if (address < MACHINE_ROM_SIZE && address + count > MACHINE_ROM_SIZE)
+        {
+            count = MACHINE_ROM_SIZE - address;
+        }
+        memcpy(data, machine_getReadPointer(core, address), count);
+        data += count;
+        address += count;
+        length -= count;
+    }
+}
+
+enum MachineRegion machine_getRegion(int address, int *start, int *end)
+{
+    if (address < 0 || address > 0xFFFF)
+    {
+        *start = address;
+        *end = address + 1;
+        return MachineRegionInvalid;
+    }
+    if (address < 0x8000)
+    {
+        *start = 0x0000;
+        *end = 0x8000;
+        return MachineRegionRom;
+    }
+    if (address < 0xE000)
+    {
+        // video ram and working ram
+        *start = 0x8000;
+        *end = 0xE000;
+        return MachineRegionRam;
+    }
+    if (address < 0xF000)
+    {
+        *start = 0xE000;
+        *end = 0xF000;
+        return MachineRegionPersistent;
+    }
+    if (address < 0xFE00)
+    {
+        *start = 0xF000;
+        *end = 0xFE00;
+        return MachineRegionReserved;
+    }
+    if (address < 0xFF40)
+    {
+        // sprite, color and video registers
+        *start = 0xFE00;
+        *end = 0xFF40;
+        return MachineRegionRegisters;
+    }
+    if (address < 0xFF70)
+    {
+        *start = 0xFF40;
+        *end = 0xFF70;
+        return MachineRegionAudioRegisters;
+    }
+    if (address < 0xFF80)
+    {
+        *start = 0xFF70;
+        *end = 0xFF80;
+        return MachineRegionIORegisters;
+    }
+    *start = 0xFF80;
+    *end = 0x10000;
+    return MachineRegionReservedRegisters;
+}
+
+bool machine_isWritableRegion(enum MachineRegion region)
+{
+    switch (region)
+    {
+        case MachineRegionRam:
+        case MachineRegionPersistent:
+        case MachineRegionRegisters:
+        case MachineRegionAudioRegisters:
+        case MachineRegionIORegisters:
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+void machine_willReadRegion(struct Core *core, enum MachineRegion region)
+{
+    if (region == MachineRegionPersistent && !core->machineInternals->hasAccessedPersistent)
+    {
+        delegate_persistentRamWillAccess(core, core->machine->persistentRam, PERSISTENT_RAM_SIZE);
+        core->machineInternals->hasAccessedPersistent = true;
+        machine_markDirty(core, 0xE000, PERSISTENT_RAM_SIZE);
+    }
+}
+
+void machine_willWriteRegion(struct Core *core, enum MachineRegion region)
+{
+    if (region == MachineRegionPersistent)
+    {
+        machine_willReadRegion(core, region);
+    }
+}
+
+void machine_didWriteRegion(struct Core *core, enum MachineRegion region)
+{
+    if (region == MachineRegionAudioRegisters)
+    {
+        machine_enableAudio(core);
+    }
+}
+
+void machine_markDirty(struct Core *core, int address, int length)
+{
+    if (length <= 0) return;
+    
+    uint32_t *dirtyBlocks = core->machineInternals->dirtyBlocks;
+    int firstBlock = address / MACHINE_DIRTY_BLOCK_SIZE;
+    int lastBlock = (address + length - 1) / MACHINE_DIRTY_BLOCK_SIZE;
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        dirtyBlocks[block >> 5] |= (1u << (block & 0x1F));
+    }
+}
+
+/** Marks the pages of a written range as changed, if it's in the persistent RAM */
+void machine_markPersistentChanged(struct Core *core, int address, int length)
+{
+    int first = address - 0xE000;
+    int last = address + length - 1 - 0xE000;
+    if (length <= 0 || last < 0 || first >= PERSISTENT_RAM_SIZE) return;
+    
+    if (first < 0) first = 0;
+    if (last >= PERSISTENT_RAM_SIZE) last = PERSISTENT_RAM_SIZE - 1;
+    for (int page = first / PERSISTENT_PAGE_SIZE; page <= last / PERSISTENT_PAGE_SIZE; page++)
+    {
+        core->machineInternals->changedPersistentPages |= 1u << page;
+    }
+}
+
+bool machine_isDirty(struct Core *core, int address, int length)
+{
+    if (length <= 0) return false;
+    
+    uint32_t *dirtyBlocks = core->machineInternals->dirtyBlocks;
+    int firstBlock = address / MACHINE_DIRTY_BLOCK_SIZE;
+    int lastBlock = (address + length - 1) / MACHINE_DIRTY_BLOCK_SIZE;
+    for (int block = firstBlock; block <= lastBlock; block++)
+    {
+        if (dirtyBlocks[block >> 5] & (1u << (block & 0x1F)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void machine_clearDirty(struct Core *core)
+{
+    memset(core->machineInternals->dirtyBlocks, 0, sizeof(core->machineInternals->dirtyBlocks));
+    machine_markDirty(core, MACHINE_DIRTY_ALWAYS_START, 0x10000 - MACHINE_DIRTY_ALWAYS_START);
+}
+
 void machine_enableAudio(struct Core *core)
 {
     if (!core->machineInternals->audioInternals.audioEnabled)
@@ -138,3 +478,15 @@ void machine_suspendEnergySaving(struct Core *core, int numUpdates)
         core->machineInternals->energySavingTimer = numUpdates;
     }
 }
+
+/** Returns the memory of an address, the ROM of a core without program reads as zeros */
+const uint8_t *machine_getReadPointer(struct Core *core, int address)
+{
+    if (address < MACHINE_ROM_SIZE)
+    {
+        static const uint8_t emptyRom[MACHINE_ROM_SIZE];
+        struct Program *program = core->interpreter->program;
+        return program ? &program->rom[address] : &emptyRom[address];
+    }
+    return (uint8_t *)core->machine + address - MACHINE_ROM_SIZE;
+}
@@ -30,14 +30,38 @@
 
 #define PERSISTENT_RAM_SIZE 4096
 
+// change tracking granularity of the persistent RAM, one bit per page
+#define PERSISTENT_PAGE_SIZE 256
+#define PERSISTENT_NUM_PAGES (PERSISTENT_RAM_SIZE / PERSISTENT_PAGE_SIZE)
+
+// write tracking granularity
+#define MACHINE_DIRTY_BLOCK_SIZE 64
+#define MACHINE_NUM_DIRTY_BLOCKS (0x10000 / MACHINE_DIRTY_BLOCK_SIZE)
+
+// registers are updated directly by the chips and libraries and are always reported as dirty
+#define MACHINE_DIRTY_ALWAYS_START 0xFE00
+
+// the cartridge ROM (0x0000-0x7FFF) belongs to the program and can be shared by many cores,
+// struct Machine holds the rest of the address space
+#define MACHINE_ROM_SIZE 0x8000
+
 struct Core;
 
-// 64 KB
+enum MachineRegion {
+    MachineRegionInvalid,
+    MachineRegionRom,
+    MachineRegionRam,
+    MachineRegionPersistent,
+    MachineRegionReserved,
+    MachineRegionRegisters,
+    MachineRegionAudioRegisters,
+    MachineRegionIORegisters,
+    MachineRegionReservedRegisters
+};
+
+// 32 KB, from 0x8000
 struct Machine {
     
-    // 0x0000
-    uint8_t cartridgeRom[0x8000]; // 32 KB
-    
     // 0x8000
     struct VideoRam videoRam; // 8 KB
     
@@ -74,15 +98,25 @@ struct Machine {
 struct MachineInternals {
     struct AudioInternals audioInternals;
     bool hasAccessedPersistent;
-    bool hasChangedPersistent;
+    uint32_t changedPersistentPages;
     bool isEnergySaving;
     int energySavingTimer;
+    uint32_t dirtyBlocks[MACHINE_NUM_DIRTY_BLOCKS / 32];
 };
 
 void machine_init(struct Core *core);
 void machine_reset(struct Core *core, bool resetPersistent);
 int machine_peek(struct Core *core, int address);
 bool machine_poke(struct Core *core, int address, int value);
+bool machine_fill(struct Core *core, int address, int length, int value);
+bool machine_write(struct Core *core, int address, const uint8_t *data, int length);
+void machine_read(struct Core *core, int address, uint8_t *data, int length);
+bool machine_copy(struct Core *core, int source, int length, int destination);
+enum MachineRegion machine_getRegion(int address, int *start, int *end);
+void machine_markDirty(struct Core *core, int address, int length);
+void machine_markPersistentChanged(struct Core *core, int address, int length);
+bool machine_isDirty(struct Core *core, int address, int length);
+void machine_clearDirty(struct Core *core);
 void machine_enableAudio(struct Core *core);
 void machine_suspendEnergySaving(struct Core *core, int numUpdates);
 
@@ -24,14 +24,14 @@
 
 #define OVERLAY_FLAG (1<<6)
 
-int video_getCharacterPixel(struct Character *character, int x, int y)
+int video_getCharacterPixel(const struct Character *character, int x, int y)
 {
     int b0 = (character->data[y] >> (7 - x)) & 0x01;
     int b1 = (character->data[y | 8] >> (7 - x)) & 0x01;
     return b0 | (b1 << 1);
 }
 
-void video_renderPlane(struct Character *characters, struct Plane *plane, int sizeMode, int y, int scrollX, int scrollY, int pixelFlag, uint8_t *scanlineBuffer)
+void video_renderPlane(const struct Character *characters, struct Plane *plane, int sizeMode, int y, int scrollX, int scrollY, int pixelFlag, uint8_t *scanlineBuffer)
 {
     int divShift = sizeMode ? 4 : 3;
     int planeY = y + scrollY;
@@ -62,7 +62,7 @@ void video_renderPlane(struct Character *characters, struct Plane *plane, int si
                 index += ((cell->attr.flipY ? (planeY >> 3) + 1 : planeY >> 3) & 1) << 4;
             }
             
-            struct Character *character = &characters[index];
+            const struct Character *character = &characters[index];
             pal = cell->attr.palette << 2;
             pri = cell->attr.priority << 7;
             
@@ -194,13 +194,33 @@ void video_renderScreen(struct Core *core, uint32_t *outputRGB)
     struct VideoRegisters *reg = &core->machine->videoRegisters;
     struct SpriteRegisters *sreg = &core->machine->spriteRegisters;
     struct ColorRegisters *creg = &core->machine->colorRegisters;
+    
+    metrics_stageDidChange(core, CoreStageVideo);
+    
     for (int y = 0; y < SCREEN_HEIGHT; y++)
     {
         reg->rasterLine = y;
-        itp_runInterrupt(core, InterruptTypeRaster);
-        memset(scanlineBuffer, 0, sizeof(scanlineBuffer));
-        
+        if (core->interpreter->currentOnRasterToken)
+        {
+            metrics_stageDidChange(core, CoreStageRasterInterrupt);
+            itp_runInterrupt(core, InterruptTypeRaster);
+            metrics_stageDidChange(core, CoreStageVideo);
+        }
+        else
+        {
+            itp_runInterrupt(core, InterruptTypeRaster);
+        }
         bool skip = (core->interpreter->interruptOverCycles > 0);
+        if (skip)
+        {
+            core->metrics->frame.numSkippedLines++;
+        }
+        if (!outputRGB)
+        {
+            continue;
+        }
+        
+        memset(scanlineBuffer, 0, sizeof(scanlineBuffer));
         if (!skip)
         {
             if (reg->attr.planeBEnabled)
@@ -223,7 +243,7 @@ void video_renderScreen(struct Core *core, uint32_t *outputRGB)
         }
         
         // overlay
-        video_renderPlane((struct Character *)overlayCharacters, &core->overlay->plane, 0, y, 0, 0, OVERLAY_FLAG, scanlineBuffer);
+        video_renderPlane((const struct Character *)overlayCharacters, &core->overlay->plane, 0, y, 0, 0, OVERLAY_FLAG, scanlineBuffer);
         
         for (int x = 0; x < SCREEN_WIDTH; x++)
         {
@@ -243,4 +263,6 @@ void video_renderScreen(struct Core *core, uint32_t *outputRGB)
             ++outputPixel;
         }
     }
+    
+    metrics_stageDidChange(core, CoreStageIdle);
 }
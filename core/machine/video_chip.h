@@ -137,6 +137,7 @@ struct VideoRegisters {
 // ================ Functions ================
 // ===========================================
 
+/** outputRGB can be NULL for frames which are not shown, then only the raster interrupts run */
 void video_renderScreen(struct Core *core, uint32_t *outputRGB);
 
 #endif /* video_chip_h */
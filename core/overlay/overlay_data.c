@@ -20,7 +20,7 @@
 
 #include "overlay_data.h"
 
-uint8_t overlayColors[] = {
+const uint8_t overlayColors[] = {
     // gamepads
     0,
     (3 << 4) | (3 << 2) | 3,
@@ -33,7 +33,7 @@ uint8_t overlayColors[] = {
     0
 };
 
-uint8_t overlayCharacters[] = {
+const uint8_t overlayCharacters[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
     0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x3C, 0x24, 0x24, 0x24, 0x24, 0x3C, 0x24, 0x3C,
     0xFE, 0xFE, 0xFE, 0xFE, 0x7E, 0x00, 0x00, 0x00, 0xFE, 0x92, 0x92, 0xDA, 0x7E, 0x00, 0x00, 0x00,
@@ -25,7 +25,7 @@
 #include <stdint.h>
 #include "video_chip.h"
 
-extern uint8_t overlayColors[];
-extern uint8_t overlayCharacters[];
+extern const uint8_t overlayColors[];
+extern const uint8_t overlayCharacters[];
 
 #endif /* overlay_data_h */
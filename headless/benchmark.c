@@ -0,0 +1,468 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "headless_runner.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define DEFAULT_FRAMES 1200
+#define DEFAULT_RUNS 3
+#define DEFAULT_SEED 1
+#define DEFAULT_THRESHOLD 10.0
+#define DATA_REPETITIONS 20
+
+// differences below this are treated as measurement noise
+#define MIN_REGRESSION_MS 0.5
+
+#define MAX_PROGRAMS 64
+#define MAX_NAME_LENGTH 128
+
+enum BenchmarkMetric {
+    BenchmarkMetricLoad,
+    BenchmarkMetricData,
+    BenchmarkMetricInterpreter,
+    BenchmarkMetricRaster,
+    BenchmarkMetricVideo,
+    BenchmarkMetricAudio,
+    BenchmarkMetricTotal,
+    NUM_BENCHMARK_METRICS
+};
+
+const char *BenchmarkMetricNames[NUM_BENCHMARK_METRICS] = {
+    "load_ms",
+    "data_ms",
+    "interpreter_ms",
+    "raster_ms",
+    "video_ms",
+    "audio_ms",
+    "total_ms"
+};
+
+struct BenchmarkResult {
+    char name[MAX_NAME_LENGTH];
+    double metrics[NUM_BENCHMARK_METRICS];
+    int cpuLoadMax;
+    uint64_t videoHash;
+    uint64_t audioHash;
+    bool isDeterministic;
+    bool hasFailed;
+    const char *errorText;
+};
+
+void printUsage(const char *executable);
+char *readTextFile(const char *filename);
+void programName(const char *filename, char *name);
+bool runProgram(const char *filename, int numFrames, uint32_t seed, struct BenchmarkResult *result);
+double measureData(const char *filename);
+void benchmarkProgram(const char *filename, int numFrames, int numRuns, uint32_t seed, struct BenchmarkResult *result);
+void escapeJson(const char *text, char *escaped);
+void writeJson(FILE *file, struct BenchmarkResult *results, int numResults, int numFrames, int numRuns, uint32_t seed);
+int compareWithBaseline(const char *baselineFilename, struct BenchmarkResult *results, int numResults, double threshold);
+bool findBaselineValue(const char *json, const char *name, const char *key, double *value);
+
+
+int main(int argc, const char * argv[])
+{
+    const char *programFilenames[MAX_PROGRAMS];
+    int numPrograms = 0;
+    const char *outputFilename = NULL;
+    const char *baselineFilename = NULL;
+    int numFrames = DEFAULT_FRAMES;
+    int numRuns = DEFAULT_RUNS;
+    uint32_t seed = DEFAULT_SEED;
+    double threshold = DEFAULT_THRESHOLD;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] == '-')
+        {
+            if (i + 1 >= argc)
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+            const char *value = argv[++i];
+            if (strcmp(arg, "-frames") == 0)
+            {
+                numFrames = atoi(value);
+            }
+            else if (strcmp(arg, "-runs") == 0)
+            {
+                numRuns = atoi(value);
+            }
+            else if (strcmp(arg, "-seed") == 0)
+            {
+                seed = (uint32_t)strtoul(value, NULL, 10);
+            }
+            else if (strcmp(arg, "-output") == 0)
+            {
+                outputFilename = value;
+            }
+            else if (strcmp(arg, "-baseline") == 0)
+            {
+                baselineFilename = value;
+            }
+            else if (strcmp(arg, "-threshold") == 0)
+            {
+                threshold = atof(value);
+            }
+            else
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        else if (numPrograms < MAX_PROGRAMS)
+        {
+            programFilenames[numPrograms++] = arg;
+        }
+    }
+    
+    if (numPrograms == 0 || numFrames <= 0 || numRuns <= 0)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+    
+    struct BenchmarkResult *results = calloc(numPrograms, sizeof(struct BenchmarkResult));
+    if (!results) exit(EXIT_FAILURE);
+    
+    int result = 0;
+    
+    for (int i = 0; i < numPrograms; i++)
+    {
+        struct BenchmarkResult *programResult = &results[i];
+        fprintf(stderr, "%s...\n", programFilenames[i]);
+        benchmarkProgram(programFilenames[i], numFrames, numRuns, seed, programResult);
+        if (programResult->hasFailed)
+        {
+            fprintf(stderr, "%s: %s\n", programResult->name, programResult->errorText);
+            result = 1;
+        }
+        else if (!programResult->isDeterministic)
+        {
+            fprintf(stderr, "%s: output differs between runs\n", programResult->name);
+            result = 1;
+        }
+    }
+    
+    if (outputFilename)
+    {
+        FILE *file = fopen(outputFilename, "w");
+        if (file)
+        {
+            writeJson(file, results, numPrograms, numFrames, numRuns, seed);
+            fclose(file);
+        }
+        else
+        {
+            fprintf(stderr, "could not write %s\n", outputFilename);
+            result = 1;
+        }
+    }
+    else
+    {
+        writeJson(stdout, results, numPrograms, numFrames, numRuns, seed);
+    }
+    
+    if (baselineFilename)
+    {
+        int numRegressions = compareWithBaseline(baselineFilename, results, numPrograms, threshold);
+        if (numRegressions != 0)
+        {
+            result = 1;
+        }
+    }
+    
+    free(results);
+    return result;
+}
+
+void printUsage(const char *executable)
+{
+    fprintf(stderr, "usage: %s [-frames n] [-runs n] [-seed n] [-output result.json] [-baseline old.json] [-threshold percent] program.nx ...\n", executable);
+}
+
+char *readTextFile(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char *text = calloc(1, size + 1); // +1 for terminator
+    if (text)
+    {
+        fread(text, size, 1, file);
+    }
+    fclose(file);
+    return text;
+}
+
+void programName(const char *filename, char *name)
+{
+    const char *start = filename;
+    for (const char *c = filename; *c; c++)
+    {
+        if (*c == '/' || *c == '\\') start = c + 1;
+    }
+    strncpy(name, start, MAX_NAME_LENGTH - 1);
+    name[MAX_NAME_LENGTH - 1] = 0;
+    
+    char *extension = strrchr(name, '.');
+    if (extension && strcmp(extension, ".nx") == 0)
+    {
+        *extension = 0;
+    }
+}
+
+void benchmarkProgram(const char *filename, int numFrames, int numRuns, uint32_t seed, struct BenchmarkResult *result)
+{
+    memset(result, 0, sizeof(struct BenchmarkResult));
+    programName(filename, result->name);
+    result->isDeterministic = true;
+    
+    // keep the fastest of all runs, it's the least disturbed by the host
+    for (int run = 0; run < numRuns; run++)
+    {
+        struct BenchmarkResult runResult;
+        memset(&runResult, 0, sizeof(struct BenchmarkResult));
+        if (!runProgram(filename, numFrames, seed, &runResult))
+        {
+            result->hasFailed = true;
+            result->errorText = runResult.errorText;
+            return;
+        }
+        
+        if (run == 0)
+        {
+            memcpy(result->metrics, runResult.metrics, sizeof(result->metrics));
+            result->cpuLoadMax = runResult.cpuLoadMax;
+            result->videoHash = runResult.videoHash;
+            result->audioHash = runResult.audioHash;
+        }
+        else
+        {
+            for (int m = 0; m < NUM_BENCHMARK_METRICS; m++)
+            {
+                result->metrics[m] = fmin(result->metrics[m], runResult.metrics[m]);
+            }
+            if (runResult.videoHash != result->videoHash || runResult.audioHash != result->audioHash)
+            {
+                result->isDeterministic = false;
+            }
+        }
+    }
+    
+    result->metrics[BenchmarkMetricData] = measureData(filename);
+}
+
+bool runProgram(const char *filename, int numFrames, uint32_t seed, struct BenchmarkResult *result)
+{
+    struct InputScript *script = calloc(1, sizeof(struct InputScript));
+    if (!script) exit(EXIT_FAILURE);
+    script_init(script);
+    script_setRandom(script, seed);
+    
+    struct HeadlessRunner runner;
+    headless_init(&runner);
+    if (!headless_isOkay(&runner)) exit(EXIT_FAILURE);
+    runner.script = script;
+    
+    bool success = true;
+    
+    double loadStart = headless_getTime();
+    struct CoreError error = headless_loadProgram(&runner, filename);
+    result->metrics[BenchmarkMetricLoad] = (headless_getTime() - loadStart) * 1000.0;
+    
+    if (error.code != ErrorNone)
+    {
+        result->errorText = err_getString(error.code);
+        success = false;
+    }
+    else
+    {
+        headless_enableStageTiming(&runner);
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            headless_runFrame(&runner);
+        }
+        
+        // time spent in the core only, without hashing and other work of the runner
+        double *stageTimes = runner.stageTimes;
+        double coreTime = 0.0;
+        for (int stage = CoreStageIdle + 1; stage < NUM_CORE_STAGES; stage++)
+        {
+            coreTime += stageTimes[stage];
+        }
+        result->metrics[BenchmarkMetricTotal] = coreTime * 1000.0;
+        result->metrics[BenchmarkMetricInterpreter] = (stageTimes[CoreStageInput] + stageTimes[CoreStageVBLInterrupt] + stageTimes[CoreStageMainProgram] + stageTimes[CoreStageSystem]) * 1000.0;
+        result->metrics[BenchmarkMetricRaster] = stageTimes[CoreStageRasterInterrupt] * 1000.0;
+        result->metrics[BenchmarkMetricVideo] = stageTimes[CoreStageVideo] * 1000.0;
+        result->metrics[BenchmarkMetricAudio] = stageTimes[CoreStageAudio] * 1000.0;
+        result->cpuLoadMax = runner.cpuLoadMax;
+        result->videoHash = runner.videoHash;
+        result->audioHash = runner.audioHash;
+        
+        if (runner.hasFailed)
+        {
+            result->errorText = err_getString(runner.error.code);
+            success = false;
+        }
+    }
+    
+    headless_deinit(&runner);
+    free(script);
+    return success;
+}
+
+/** Average time of importing the program's ROM data and exporting it again, as done for disk files */
+double measureData(const char *filename)
+{
+    char *sourceCode = readTextFile(filename);
+    if (!sourceCode) return 0.0;
+    
+    struct DataManager *manager = calloc(1, sizeof(struct DataManager));
+    uint8_t *data = calloc(1, DATA_SIZE);
+    if (!manager || !data) exit(EXIT_FAILURE);
+    manager->data = data;
+    
+    double start = headless_getTime();
+    for (int i = 0; i < DATA_REPETITIONS; i++)
+    {
+        data_import(manager, sourceCode, true);
+        char *output = data_export(manager);
+        free(output);
+    }
+    double time = (headless_getTime() - start) * 1000.0 / DATA_REPETITIONS;
+    
+    data_deinit(manager);
+    free(data);
+    free(manager);
+    free(sourceCode);
+    return time;
+}
+
+/** Escapes quotes and backslashes, escaped needs space for twice the length of text */
+void escapeJson(const char *text, char *escaped)
+{
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\') *escaped++ = '\\';
+        *escaped++ = *c;
+    }
+    *escaped = 0;
+}
+
+void writeJson(FILE *file, struct BenchmarkResult *results, int numResults, int numFrames, int numRuns, uint32_t seed)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"frames\": %d,\n", numFrames);
+    fprintf(file, "  \"runs\": %d,\n", numRuns);
+    fprintf(file, "  \"seed\": %u,\n", seed);
+    fprintf(file, "  \"programs\": [\n");
+    for (int i = 0; i < numResults; i++)
+    {
+        struct BenchmarkResult *result = &results[i];
+        fprintf(file, "    {\n");
+        char name[MAX_NAME_LENGTH * 2];
+        escapeJson(result->name, name);
+        fprintf(file, "      \"name\": \"%s\",\n", name);
+        for (int m = 0; m < NUM_BENCHMARK_METRICS; m++)
+        {
+            fprintf(file, "      \"%s\": %.3f,\n", BenchmarkMetricNames[m], result->metrics[m]);
+        }
+        fprintf(file, "      \"cpu_load_max\": %d,\n", result->cpuLoadMax);
+        fprintf(file, "      \"video_hash\": \"%016llx\",\n", (unsigned long long)result->videoHash);
+        fprintf(file, "      \"audio_hash\": \"%016llx\",\n", (unsigned long long)result->audioHash);
+        fprintf(file, "      \"deterministic\": %s,\n", result->isDeterministic ? "true" : "false");
+        if (result->hasFailed)
+        {
+            fprintf(file, "      \"error\": \"%s\"\n", result->errorText);
+        }
+        else
+        {
+            fprintf(file, "      \"error\": null\n");
+        }
+        fprintf(file, "    }%s\n", (i < numResults - 1) ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+/** Returns the number of metrics slower than the baseline by more than threshold percent */
+int compareWithBaseline(const char *baselineFilename, struct BenchmarkResult *results, int numResults, double threshold)
+{
+    char *json = readTextFile(baselineFilename);
+    if (!json)
+    {
+        fprintf(stderr, "could not read baseline %s\n", baselineFilename);
+        return -1;
+    }
+    
+    int numRegressions = 0;
+    for (int i = 0; i < numResults; i++)
+    {
+        struct BenchmarkResult *result = &results[i];
+        if (result->hasFailed) continue;
+        
+        for (int m = 0; m < NUM_BENCHMARK_METRICS; m++)
+        {
+            double baselineValue;
+            if (!findBaselineValue(json, result->name, BenchmarkMetricNames[m], &baselineValue)) continue;
+            
+            double value = result->metrics[m];
+            if (value > baselineValue * (1.0 + threshold / 100.0) && value - baselineValue > MIN_REGRESSION_MS)
+            {
+                fprintf(stderr, "REGRESSION %s %s: %.3f -> %.3f (+%.1f %%)\n", result->name, BenchmarkMetricNames[m], baselineValue, value, (value / baselineValue - 1.0) * 100.0);
+                numRegressions++;
+            }
+        }
+    }
+    
+    free(json);
+    return numRegressions;
+}
+
+/** Minimal lookup for files written by writeJson: finds the value of key in the object of the named program */
+bool findBaselineValue(const char *json, const char *name, const char *key, double *value)
+{
+    char escapedName[MAX_NAME_LENGTH * 2];
+    escapeJson(name, escapedName);
+    char pattern[MAX_NAME_LENGTH * 2 + 16];
+    snprintf(pattern, sizeof(pattern), "\"name\": \"%s\"", escapedName);
+    const char *object = strstr(json, pattern);
+    if (!object) return false;
+    
+    const char *objectEnd = strchr(object, '}');
+    
+    char keyPattern[64];
+    snprintf(keyPattern, sizeof(keyPattern), "\"%s\":", key);
+    const char *entry = strstr(object, keyPattern);
+    if (!entry || (objectEnd && entry > objectEnd)) return false;
+    
+    *value = atof(entry + strlen(keyPattern));
+    return true;
+}
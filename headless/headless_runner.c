@@ -0,0 +1,257 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "headless_runner.h"
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define HASH_PRIME 0x100000001B3ULL
+
+void interpreterDidFail(void *context, struct CoreError coreError);
+bool diskDriveWillAccess(void *context, struct DataManager *diskDataManager);
+void stageDidChange(void *context, enum CoreStage stage);
+uint64_t getHostTime(void *context);
+
+
+void headless_init(struct HeadlessRunner *runner)
+{
+    memset(runner, 0, sizeof(struct HeadlessRunner));
+    
+    struct Core *core = calloc(1, sizeof(struct Core));
+    if (core)
+    {
+        core_init(core);
+        
+        // no display, no audio device, no saving: every run starts from the same state
+        runner->coreDelegate.context = runner;
+        runner->coreDelegate.interpreterDidFail = interpreterDidFail;
+        runner->coreDelegate.diskDriveWillAccess = diskDriveWillAccess;
+        runner->coreDelegate.getHostTime = getHostTime;
+        
+        core_setDelegate(core, &runner->coreDelegate);
+        
+        runner->core = core;
+    }
+    
+    runner->pixels = calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(uint32_t));
+    runner->audioBuffer = calloc(HEADLESS_AUDIO_SAMPLES, sizeof(int16_t));
+    runner->videoHash = HEADLESS_HASH_OFFSET_BASIS;
+    runner->audioHash = HEADLESS_HASH_OFFSET_BASIS;
+}
+
+void headless_deinit(struct HeadlessRunner *runner)
+{
+    if (runner->core)
+    {
+        core_deinit(runner->core);
+        
+        free(runner->core);
+        runner->core = NULL;
+    }
+    if (runner->pixels)
+    {
+        free(runner->pixels);
+        runner->pixels = NULL;
+    }
+    if (runner->audioBuffer)
+    {
+        free(runner->audioBuffer);
+        runner->audioBuffer = NULL;
+    }
+}
+
+bool headless_isOkay(struct HeadlessRunner *runner)
+{
+    return (runner->core != NULL && runner->pixels != NULL && runner->audioBuffer != NULL);
+}
+
+struct CoreError headless_loadProgram(struct HeadlessRunner *runner, const char *filename)
+{
+    struct CoreError error = err_noCoreError();
+    
+    FILE *file = fopen(filename, "rb");
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        
+        char *sourceCode = calloc(1, size + 1); // +1 for terminator
+        if (sourceCode)
+        {
+            fread(sourceCode, size, 1, file);
+            
+            error = core_compileProgram(runner->core, sourceCode, true);
+            free(sourceCode);
+        }
+        else
+        {
+            error = err_makeCoreError(ErrorOutOfMemory, -1);
+        }
+        
+        fclose(file);
+    }
+    else
+    {
+        error = err_makeCoreError(ErrorCouldNotOpenProgram, -1);
+    }
+    
+    if (error.code == ErrorNone)
+    {
+        // fixed power-on time, so TIMER starts the same on every run
+        core_willRunProgram(runner->core, 0);
+    }
+    
+    return error;
+}
+
+/** Runs a program compiled by another runner, it is shared and not copied */
+void headless_loadSharedProgram(struct HeadlessRunner *runner, struct Program *program)
+{
+    core_loadProgram(runner->core, program, true);
+    core_willRunProgram(runner->core, 0);
+}
+
+void headless_runFrame(struct HeadlessRunner *runner)
+{
+    struct Core *core = runner->core;
+    
+    if (runner->script)
+    {
+        script_apply(runner->script, runner->frame, &runner->coreInput);
+    }
+    
+    core_update(core, &runner->coreInput);
+    video_renderScreen(core, runner->pixels);
+    audio_renderAudio(core, runner->audioBuffer, HEADLESS_AUDIO_SAMPLES, HEADLESS_SAMPLING_RATE, 0);
+    
+    runner->videoHash = headless_hash(runner->videoHash, runner->pixels, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    runner->audioHash = headless_hash(runner->audioHash, runner->audioBuffer, HEADLESS_AUDIO_SAMPLES * sizeof(int16_t));
+    
+    int cpuLoad = core->interpreter->cpuLoadDisplay;
+    if (cpuLoad > runner->cpuLoadMax)
+    {
+        runner->cpuLoadMax = cpuLoad;
+    }
+    runner->cpuLoadSum += cpuLoad;
+    
+    runner->frame++;
+}
+
+/** Accumulates host time per core stage in stageTimes */
+void headless_enableStageTiming(struct HeadlessRunner *runner)
+{
+    runner->coreDelegate.stageDidChange = stageDidChange;
+    runner->currentStage = CoreStageIdle;
+    runner->stageStartTime = headless_getTime();
+}
+
+/** Returns a monotonic time in seconds */
+double headless_getTime(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+#endif
+}
+
+/** Continues an FNV-1a hash, start with HEADLESS_HASH_OFFSET_BASIS */
+uint64_t headless_hash(uint64_t hash, const void *data, size_t size)
+{
+    // FNV-1a
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= HASH_PRIME;
+    }
+    return hash;
+}
+
+/** Called on error */
+void interpreterDidFail(void *context, struct CoreError coreError)
+{
+    struct HeadlessRunner *runner = context;
+    if (!runner->hasFailed)
+    {
+        runner->hasFailed = true;
+        runner->error = coreError;
+    }
+    core_traceError(runner->core, coreError);
+}
+
+/** Loads the disk file if one was given, changes are never written back */
+bool diskDriveWillAccess(void *context, struct DataManager *diskDataManager)
+{
+    struct HeadlessRunner *runner = context;
+    if (!runner->diskFilename) return true;
+    
+    FILE *file = fopen(runner->diskFilename, "rb");
+    if (file)
+    {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        
+        char *sourceCode = calloc(1, size + 1); // +1 for terminator
+        if (sourceCode)
+        {
+            fread(sourceCode, size, 1, file);
+            
+            struct CoreError error = data_import(diskDataManager, sourceCode, true);
+            free(sourceCode);
+            
+            if (error.code != ErrorNone)
+            {
+                core_traceError(runner->core, error);
+            }
+        }
+        
+        fclose(file);
+    }
+    
+    return true;
+}
+
+/** Called when the core switches to another part of its work */
+void stageDidChange(void *context, enum CoreStage stage)
+{
+    struct HeadlessRunner *runner = context;
+    double time = headless_getTime();
+    runner->stageTimes[runner->currentStage] += time - runner->stageStartTime;
+    runner->currentStage = stage;
+    runner->stageStartTime = time;
+}
+
+/** Returns the monotonic time in nanoseconds */
+uint64_t getHostTime(void *context)
+{
+    return (uint64_t)(headless_getTime() * 1e9);
+}
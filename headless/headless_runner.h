@@ -0,0 +1,64 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef headless_runner_h
+#define headless_runner_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "core.h"
+#include "input_script.h"
+
+#define HEADLESS_SAMPLING_RATE 44100
+#define HEADLESS_AUDIO_SAMPLES (HEADLESS_SAMPLING_RATE / 60 * NUM_CHANNELS)
+#define HEADLESS_HASH_OFFSET_BASIS 0xCBF29CE484222325ULL
+
+struct HeadlessRunner {
+    struct Core *core;
+    struct CoreDelegate coreDelegate;
+    struct CoreInput coreInput;
+    struct InputScript *script;
+    uint32_t *pixels;
+    int16_t *audioBuffer;
+    const char *diskFilename;
+    int frame;
+    bool hasFailed;
+    struct CoreError error;
+    uint64_t videoHash;
+    uint64_t audioHash;
+    int cpuLoadMax;
+    long cpuLoadSum;
+    enum CoreStage currentStage;
+    double stageStartTime;
+    double stageTimes[NUM_CORE_STAGES];
+};
+
+void headless_init(struct HeadlessRunner *runner);
+void headless_deinit(struct HeadlessRunner *runner);
+bool headless_isOkay(struct HeadlessRunner *runner);
+struct CoreError headless_loadProgram(struct HeadlessRunner *runner, const char *filename);
+void headless_loadSharedProgram(struct HeadlessRunner *runner, struct Program *program);
+void headless_runFrame(struct HeadlessRunner *runner);
+void headless_enableStageTiming(struct HeadlessRunner *runner);
+double headless_getTime(void);
+uint64_t headless_hash(uint64_t hash, const void *data, size_t size);
+
+#endif /* headless_runner_h */
@@ -0,0 +1,225 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "input_script.h"
+#include <string.h>
+#include <stdlib.h>
+
+bool script_parseLine(struct InputScript *script, char *line);
+bool script_parseGamepad(const char *buttons, struct CoreInputGamepad *gamepad);
+uint32_t script_nextRandom(struct InputScript *script);
+
+void script_init(struct InputScript *script)
+{
+    memset(script, 0, sizeof(struct InputScript));
+}
+
+/**
+ * Loads an input script. Each line is "<frame> <command> [arguments]", events must be sorted by frame:
+ *   <frame> pad <player> <buttons>   buttons from U D L R A B, or - for none (stays active until changed)
+ *   <frame> key <character>          single key press, or RETURN, BACKSPACE, UP, DOWN, LEFT, RIGHT
+ *   <frame> touch <x> <y>            touch down (stays active until release)
+ *   <frame> release                  touch up
+ *   <frame> pause                    pause button
+ * Empty lines and lines starting with # are ignored.
+ */
+bool script_load(struct InputScript *script, const char *filename, int *errorLine)
+{
+    script_init(script);
+    *errorLine = 0;
+    
+    FILE *file = fopen(filename, "r");
+    if (!file) return false;
+    
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        
+        // remove EOL characters
+        char *eolChar = strpbrk(line, "\r\n");
+        if (eolChar)
+        {
+            *eolChar = 0;
+        }
+        
+        if (line[0] == 0 || line[0] == '#') continue;
+        
+        if (!script_parseLine(script, line))
+        {
+            *errorLine = lineNumber;
+            fclose(file);
+            return false;
+        }
+    }
+    
+    fclose(file);
+    return true;
+}
+
+bool script_parseLine(struct InputScript *script, char *line)
+{
+    if (script->numEvents >= MAX_SCRIPT_EVENTS) return false;
+    
+    struct ScriptEvent *event = &script->events[script->numEvents];
+    memset(event, 0, sizeof(struct ScriptEvent));
+    
+    char command[16];
+    char argument[16];
+    int numFields = sscanf(line, "%d %15s %15s", &event->frame, command, argument);
+    if (numFields < 2) return false;
+    if (script->numEvents > 0 && event->frame < script->events[script->numEvents - 1].frame) return false;
+    
+    if (strcmp(command, "pad") == 0)
+    {
+        char buttons[16];
+        if (sscanf(line, "%*d %*s %d %15s", &event->player, buttons) != 2) return false;
+        if (event->player < 0 || event->player >= NUM_GAMEPADS) return false;
+        if (!script_parseGamepad(buttons, &event->gamepad)) return false;
+        event->type = ScriptEventTypeGamepad;
+    }
+    else if (strcmp(command, "key") == 0)
+    {
+        if (numFields < 3) return false;
+        event->type = ScriptEventTypeKey;
+        if (strcmp(argument, "RETURN") == 0) event->key = CoreInputKeyReturn;
+        else if (strcmp(argument, "BACKSPACE") == 0) event->key = CoreInputKeyBackspace;
+        else if (strcmp(argument, "UP") == 0) event->key = CoreInputKeyUp;
+        else if (strcmp(argument, "DOWN") == 0) event->key = CoreInputKeyDown;
+        else if (strcmp(argument, "LEFT") == 0) event->key = CoreInputKeyLeft;
+        else if (strcmp(argument, "RIGHT") == 0) event->key = CoreInputKeyRight;
+        else if (strlen(argument) == 1) event->key = argument[0];
+        else return false;
+    }
+    else if (strcmp(command, "touch") == 0)
+    {
+        if (sscanf(line, "%*d %*s %d %d", &event->x, &event->y) != 2) return false;
+        event->type = ScriptEventTypeTouch;
+    }
+    else if (strcmp(command, "release") == 0)
+    {
+        event->type = ScriptEventTypeRelease;
+    }
+    else if (strcmp(command, "pause") == 0)
+    {
+        event->type = ScriptEventTypePause;
+    }
+    else
+    {
+        return false;
+    }
+    
+    script->numEvents++;
+    return true;
+}
+
+bool script_parseGamepad(const char *buttons, struct CoreInputGamepad *gamepad)
+{
+    memset(gamepad, 0, sizeof(struct CoreInputGamepad));
+    if (strcmp(buttons, "-") == 0) return true;
+    
+    for (const char *button = buttons; *button; button++)
+    {
+        switch (*button)
+        {
+            case 'U': gamepad->up = true; break;
+            case 'D': gamepad->down = true; break;
+            case 'L': gamepad->left = true; break;
+            case 'R': gamepad->right = true; break;
+            case 'A': gamepad->buttonA = true; break;
+            case 'B': gamepad->buttonB = true; break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+void script_setRandom(struct InputScript *script, uint32_t seed)
+{
+    script->isRandom = true;
+    script->randomSeed = seed;
+}
+
+void script_apply(struct InputScript *script, int frame, struct CoreInput *input)
+{
+    input->pause = false;
+    
+    if (script->isRandom)
+    {
+        // change gamepad state every 8 frames, independent of the host
+        if (frame % 8 == 0)
+        {
+            for (int i = 0; i < NUM_GAMEPADS; i++)
+            {
+                uint32_t r = script_nextRandom(script);
+                struct CoreInputGamepad *gamepad = &input->gamepads[i];
+                gamepad->up = (r & 0x03) == 0x01;
+                gamepad->down = (r & 0x03) == 0x02;
+                gamepad->left = (r & 0x0C) == 0x04;
+                gamepad->right = (r & 0x0C) == 0x08;
+                gamepad->buttonA = (r & 0x30) == 0x10;
+                gamepad->buttonB = (r & 0xC0) == 0x40;
+            }
+        }
+        return;
+    }
+    
+    while (script->nextEvent < script->numEvents && script->events[script->nextEvent].frame <= frame)
+    {
+        struct ScriptEvent *event = &script->events[script->nextEvent];
+        switch (event->type)
+        {
+            case ScriptEventTypeGamepad:
+                input->gamepads[event->player] = event->gamepad;
+                break;
+                
+            case ScriptEventTypeKey:
+                input->key = event->key;
+                break;
+                
+            case ScriptEventTypeTouch:
+                input->touch = true;
+                input->touchX = event->x;
+                input->touchY = event->y;
+                break;
+                
+            case ScriptEventTypeRelease:
+                input->touch = false;
+                break;
+                
+            case ScriptEventTypePause:
+                input->pause = true;
+                break;
+        }
+        script->nextEvent++;
+    }
+}
+
+uint32_t script_nextRandom(struct InputScript *script)
+{
+    // xorshift32, a seed of 0 would stay 0
+    uint32_t x = script->randomSeed ? script->randomSeed : 0x2545F491;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    script->randomSeed = x;
+    return x >> 8;
+}
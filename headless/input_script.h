@@ -0,0 +1,61 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef input_script_h
+#define input_script_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "core.h"
+
+#define MAX_SCRIPT_EVENTS 4096
+
+enum ScriptEventType {
+    ScriptEventTypeGamepad,
+    ScriptEventTypeKey,
+    ScriptEventTypeTouch,
+    ScriptEventTypeRelease,
+    ScriptEventTypePause
+};
+
+struct ScriptEvent {
+    int frame;
+    enum ScriptEventType type;
+    int player;
+    struct CoreInputGamepad gamepad;
+    char key;
+    int x;
+    int y;
+};
+
+struct InputScript {
+    struct ScriptEvent events[MAX_SCRIPT_EVENTS];
+    int numEvents;
+    int nextEvent;
+    bool isRandom;
+    uint32_t randomSeed;
+};
+
+void script_init(struct InputScript *script);
+bool script_load(struct InputScript *script, const char *filename, int *errorLine);
+void script_setRandom(struct InputScript *script, uint32_t seed);
+void script_apply(struct InputScript *script, int frame, struct CoreInput *input);
+
+#endif /* input_script_h */
@@ -0,0 +1,407 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "headless_runner.h"
+#include "string_utils.h"
+#include "core_stats.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define DEFAULT_FRAMES 600
+
+void printUsage(const char *executable);
+bool writeProfile(struct Core *core, const char *prefix);
+bool checkState(struct HeadlessRunner *runner, int numFrames);
+bool checkRewind(struct HeadlessRunner *runner, int numFrames);
+
+
+int main(int argc, const char * argv[])
+{
+    const char *programFilename = NULL;
+    const char *scriptFilename = NULL;
+    const char *diskFilename = NULL;
+    const char *profilePrefix = NULL;
+    const char *traceFilename = NULL;
+    int numFrames = DEFAULT_FRAMES;
+    int stateCheckFrames = 0;
+    int rewindCheckFrames = 0;
+    bool randomInput = false;
+    uint32_t randomSeed = 0;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] == '-')
+        {
+            if (i + 1 >= argc)
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+            const char *value = argv[++i];
+            if (strcmp(arg, "-frames") == 0)
+            {
+                numFrames = atoi(value);
+            }
+            else if (strcmp(arg, "-input") == 0)
+            {
+                scriptFilename = value;
+            }
+            else if (strcmp(arg, "-random") == 0)
+            {
+                randomInput = true;
+                randomSeed = (uint32_t)strtoul(value, NULL, 10);
+            }
+            else if (strcmp(arg, "-disk") == 0)
+            {
+                diskFilename = value;
+            }
+            else if (strcmp(arg, "-profile") == 0)
+            {
+                profilePrefix = value;
+            }
+            else if (strcmp(arg, "-trace") == 0)
+            {
+                traceFilename = value;
+            }
+            else if (strcmp(arg, "-statecheck") == 0)
+            {
+                stateCheckFrames = atoi(value);
+            }
+            else if (strcmp(arg, "-rewindcheck") == 0)
+            {
+                rewindCheckFrames = atoi(value);
+            }
+            else
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        else
+        {
+            programFilename = arg;
+        }
+    }
+    
+    if (!programFilename || numFrames <= 0)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+    
+    struct InputScript *script = calloc(1, sizeof(struct InputScript));
+    if (!script) exit(EXIT_FAILURE);
+    script_init(script);
+    if (scriptFilename)
+    {
+        int errorLine = 0;
+        if (!script_load(script, scriptFilename, &errorLine))
+        {
+            fprintf(stderr, "could not load input script %s (line %d)\n", scriptFilename, errorLine);
+            free(script);
+            return 1;
+        }
+    }
+    else if (randomInput)
+    {
+        script_setRandom(script, randomSeed);
+    }
+    
+    struct HeadlessRunner runner;
+    headless_init(&runner);
+    if (!headless_isOkay(&runner))
+    {
+        fprintf(stderr, "not enough memory\n");
+        free(script);
+        return 1;
+    }
+    runner.script = script;
+    runner.diskFilename = diskFilename;
+    
+    int result = 0;
+    
+    double loadStart = headless_getTime();
+    struct CoreError error = headless_loadProgram(&runner, programFilename);
+    double loadTime = headless_getTime() - loadStart;
+    
+    if (error.code != ErrorNone)
+    {
+        fprintf(stderr, "%s: %s\n", programFilename, err_getString(error.code));
+        result = 1;
+    }
+    else
+    {
+        if (profilePrefix)
+        {
+            core_setProfiling(runner.core, true);
+        }
+        if (traceFilename)
+        {
+            core_setTracing(runner.core, true);
+        }
+        
+        int stateMismatchFrame = -1;
+        int rewindMismatchFrame = -1;
+        double runStart = headless_getTime();
+        for (int i = 0; i < numFrames; i++)
+        {
+            if (stateCheckFrames > 0 && i % stateCheckFrames == 0 && i + stateCheckFrames <= numFrames && stateMismatchFrame == -1)
+            {
+                int frame = runner.frame;
+                if (!checkState(&runner, stateCheckFrames))
+                {
+                    stateMismatchFrame = frame;
+                }
+                i += stateCheckFrames - 1;
+            }
+            else if (rewindCheckFrames > 0 && i % rewindCheckFrames == 0 && i + rewindCheckFrames <= numFrames && rewindMismatchFrame == -1)
+            {
+                int frame = runner.frame;
+                if (!checkRewind(&runner, rewindCheckFrames))
+                {
+                    rewindMismatchFrame = frame;
+                }
+                i += rewindCheckFrames - 1;
+            }
+            else
+            {
+                headless_runFrame(&runner);
+            }
+        }
+        double runTime = headless_getTime() - runStart;
+        
+        printf("program:      %s\n", programFilename);
+        printf("frames:       %d\n", runner.frame);
+        printf("load time:    %.3f ms\n", loadTime * 1000.0);
+        printf("run time:     %.3f ms (%.3f ms per frame, %.1f fps)\n", runTime * 1000.0, runTime * 1000.0 / runner.frame, runner.frame / runTime);
+        printf("cpu load:     %.1f %% average, %d %% max\n", (double)runner.cpuLoadSum / runner.frame, runner.cpuLoadMax);
+        struct CoreMetrics metrics = core_getMetrics(runner.core);
+        printf("skipped:      %d frames\n", metrics.numSkippedFrames);
+        printf("video hash:   %016llx\n", (unsigned long long)runner.videoHash);
+        printf("audio hash:   %016llx\n", (unsigned long long)runner.audioHash);
+        struct CoreMemoryStats memory = stats_getCoreMemory(runner.core);
+        printf("memory:       %d KB core, %d KB variables, %d KB shared program\n", (int)(memory.core / 1024), (int)(memory.variables / 1024), (int)(memory.program / 1024));
+        if (stateCheckFrames > 0)
+        {
+            if (stateMismatchFrame >= 0)
+            {
+                printf("state check:  mismatch after loading frame %d\n", stateMismatchFrame);
+                result = 1;
+            }
+            else
+            {
+                printf("state check:  okay, %d KB\n", (int)(core_getStateSize(runner.core) / 1024));
+            }
+        }
+        if (rewindCheckFrames > 0)
+        {
+            if (rewindMismatchFrame >= 0)
+            {
+                printf("rewind check: mismatch in frames from %d\n", rewindMismatchFrame);
+                result = 1;
+            }
+            else
+            {
+                printf("rewind check: okay\n");
+            }
+        }
+        
+        if (runner.hasFailed)
+        {
+            struct Program *program = runner.core->interpreter->program;
+            int line = (runner.error.sourcePosition >= 0 && program) ? lineNumber(program->sourceCode, runner.error.sourcePosition) : 0;
+            printf("error:        %s (line %d)\n", err_getString(runner.error.code), line);
+            result = 1;
+        }
+        
+        if (profilePrefix && !writeProfile(runner.core, profilePrefix))
+        {
+            fprintf(stderr, "could not write profile %s\n", profilePrefix);
+            result = 1;
+        }
+        
+        if (traceFilename)
+        {
+            FILE *file = fopen(traceFilename, "w");
+            if (file)
+            {
+                trace_write(runner.core, file);
+                fclose(file);
+            }
+            else
+            {
+                fprintf(stderr, "could not write trace %s\n", traceFilename);
+                result = 1;
+            }
+        }
+    }
+    
+    headless_deinit(&runner);
+    free(script);
+    
+    return result;
+}
+
+void printUsage(const char *executable)
+{
+    fprintf(stderr, "usage: %s [-frames n] [-input script.txt | -random seed] [-disk Disk.nx] [-profile prefix] [-trace trace.json] [-statecheck n] [-rewindcheck n] program.nx\n", executable);
+}
+
+/** Writes the line report to prefix.txt and the call stacks to prefix.folded */
+bool writeProfile(struct Core *core, const char *prefix)
+{
+    char filename[FILENAME_MAX];
+    
+    snprintf(filename, FILENAME_MAX, "%s.txt", prefix);
+    FILE *file = fopen(filename, "w");
+    if (!file) return false;
+    prof_writeReport(core, file);
+    fclose(file);
+    
+    snprintf(filename, FILENAME_MAX, "%s.folded", prefix);
+    file = fopen(filename, "w");
+    if (!file) return false;
+    prof_writeFoldedStacks(core, file, false);
+    fclose(file);
+    
+    return true;
+}
+
+/** Runs frames from a save state twice and returns false if output or state differ */
+bool checkState(struct HeadlessRunner *runner, int numFrames)
+{
+    struct Core *core = runner->core;
+    
+    size_t size = core_getStateSize(core);
+    void *state = malloc(size);
+    if (!state) exit(EXIT_FAILURE);
+    if (!core_saveState(core, state, size))
+    {
+        free(state);
+        return false;
+    }
+    struct HeadlessRunner savedRunner = *runner;
+    struct InputScript savedScript = *runner->script;
+    
+    for (int i = 0; i < numFrames; i++)
+    {
+        headless_runFrame(runner);
+    }
+    uint64_t videoHash = runner->videoHash;
+    uint64_t audioHash = runner->audioHash;
+    size_t endSize = core_getStateSize(core);
+    void *endState = malloc(endSize);
+    if (!endState) exit(EXIT_FAILURE);
+    core_saveState(core, endState, endSize);
+    
+    // again from the save state
+    bool isOkay = core_loadState(core, state, size);
+    *runner = savedRunner;
+    *runner->script = savedScript;
+    for (int i = 0; i < numFrames; i++)
+    {
+        headless_runFrame(runner);
+    }
+    
+    if (runner->videoHash != videoHash || runner->audioHash != audioHash)
+    {
+        isOkay = false;
+    }
+    else if (core_getStateSize(core) != endSize)
+    {
+        isOkay = false;
+    }
+    else
+    {
+        void *repeatedState = malloc(endSize);
+        if (!repeatedState) exit(EXIT_FAILURE);
+        core_saveState(core, repeatedState, endSize);
+        if (memcmp(repeatedState, endState, endSize) != 0)
+        {
+            isOkay = false;
+        }
+        free(repeatedState);
+    }
+    
+    free(state);
+    free(endState);
+    return isOkay;
+}
+
+/** Runs frames with rewind and returns false if rewinding doesn't restore the exact state of each frame */
+bool checkRewind(struct HeadlessRunner *runner, int numFrames)
+{
+    struct Core *core = runner->core;
+    
+    void **states = calloc(numFrames + 1, sizeof(void *));
+    size_t *sizes = calloc(numFrames + 1, sizeof(size_t));
+    if (!states || !sizes) exit(EXIT_FAILURE);
+    
+    core_setRewind(core, REWIND_DEFAULT_BUFFER_SIZE);
+    for (int i = 0; i <= numFrames; i++)
+    {
+        if (i > 0)
+        {
+            headless_runFrame(runner);
+        }
+        core_saveRewindFrame(core);
+        sizes[i] = core_getStateSize(core);
+        states[i] = malloc(sizes[i]);
+        if (!states[i]) exit(EXIT_FAILURE);
+        core_saveState(core, states[i], sizes[i]);
+    }
+    
+    // back to the first frame, each one must match its full state
+    bool isOkay = true;
+    for (int i = numFrames - 1; i >= 0 && isOkay; i--)
+    {
+        if (!core_rewindFrame(core) || core_getStateSize(core) != sizes[i])
+        {
+            isOkay = false;
+        }
+        else
+        {
+            void *state = malloc(sizes[i]);
+            if (!state) exit(EXIT_FAILURE);
+            core_saveState(core, state, sizes[i]);
+            if (memcmp(state, states[i], sizes[i]) != 0)
+            {
+                isOkay = false;
+            }
+            free(state);
+        }
+    }
+    core_setRewind(core, 0);
+    
+    // continue after the last frame
+    if (!core_loadState(core, states[numFrames], sizes[numFrames]))
+    {
+        isOkay = false;
+    }
+    
+    for (int i = 0; i <= numFrames; i++)
+    {
+        free(states[i]);
+    }
+    free(states);
+    free(sizes);
+    return isOkay;
+}
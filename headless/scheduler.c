@@ -0,0 +1,344 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "scheduler.h"
+#include "headless_runner.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define SCHED_INITIAL_CAPACITY 64
+
+void *sched_runWorker(void *context);
+void sched_work(struct SchedulerWorker *worker);
+int sched_takeOwn(struct SchedulerWorker *worker);
+int sched_steal(struct SchedulerWorker *worker);
+void sched_stepCore(struct Scheduler *scheduler, struct SchedulerCore *schedulerCore);
+
+
+void sched_init(struct Scheduler *scheduler, int numWorkers, int samplingRate)
+{
+    memset(scheduler, 0, sizeof(struct Scheduler));
+    
+    if (numWorkers < 1) numWorkers = 1;
+    if (numWorkers > SCHED_MAX_WORKERS) numWorkers = SCHED_MAX_WORKERS;
+    
+    scheduler->numWorkers = numWorkers;
+    scheduler->samplingRate = samplingRate;
+    scheduler->samplesPerFrame = samplingRate / 60 * NUM_CHANNELS;
+    
+    pthread_mutex_init(&scheduler->mutex, NULL);
+    pthread_cond_init(&scheduler->didStartTick, NULL);
+    pthread_cond_init(&scheduler->didFinishTick, NULL);
+    
+    for (int i = 0; i < numWorkers; i++)
+    {
+        struct SchedulerWorker *worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        pthread_mutex_init(&worker->mutex, NULL);
+        if (pthread_create(&worker->thread, NULL, sched_runWorker, worker) != 0) exit(EXIT_FAILURE);
+    }
+}
+
+void sched_deinit(struct Scheduler *scheduler)
+{
+    pthread_mutex_lock(&scheduler->mutex);
+    scheduler->quit = true;
+    pthread_cond_broadcast(&scheduler->didStartTick);
+    pthread_mutex_unlock(&scheduler->mutex);
+    
+    for (int i = 0; i < scheduler->numWorkers; i++)
+    {
+        struct SchedulerWorker *worker = &scheduler->workers[i];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->mutex);
+    }
+    
+    for (int i = 0; i < scheduler->numCores; i++)
+    {
+        sched_removeCore(scheduler, i);
+    }
+    free(scheduler->cores);
+    scheduler->cores = NULL;
+    
+    pthread_cond_destroy(&scheduler->didFinishTick);
+    pthread_cond_destroy(&scheduler->didStartTick);
+    pthread_mutex_destroy(&scheduler->mutex);
+}
+
+/** Adds a core with a program already loaded, returns its index or -1. The core stays owned by the caller. */
+int sched_addCore(struct Scheduler *scheduler, struct Core *core)
+{
+    // reuse a removed entry first, so indices stay small
+    int index = -1;
+    for (int i = 0; i < scheduler->numCores; i++)
+    {
+        if (!scheduler->cores[i].core)
+        {
+            index = i;
+            break;
+        }
+    }
+    if (index == -1)
+    {
+        if (scheduler->numCores == scheduler->capacity)
+        {
+            int capacity = scheduler->capacity > 0 ? scheduler->capacity * 2 : SCHED_INITIAL_CAPACITY;
+            struct SchedulerCore *cores = realloc(scheduler->cores, capacity * sizeof(struct SchedulerCore));
+            if (!cores) return -1;
+            scheduler->cores = cores;
+            scheduler->capacity = capacity;
+        }
+        index = scheduler->numCores++;
+    }
+    
+    struct SchedulerCore *schedulerCore = &scheduler->cores[index];
+    memset(schedulerCore, 0, sizeof(struct SchedulerCore));
+    schedulerCore->pixels = calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(uint32_t));
+    schedulerCore->audioBuffer = calloc(scheduler->samplesPerFrame * SCHED_MAX_FRAMES_PER_TICK, sizeof(int16_t));
+    if (!schedulerCore->pixels || !schedulerCore->audioBuffer)
+    {
+        sched_removeCore(scheduler, index);
+        return -1;
+    }
+    schedulerCore->core = core;
+    schedulerCore->framesPerTick = 1;
+    return index;
+}
+
+/** Stops stepping the core, its index can be given to the next added core */
+void sched_removeCore(struct Scheduler *scheduler, int index)
+{
+    struct SchedulerCore *schedulerCore = &scheduler->cores[index];
+    if (schedulerCore->pixels)
+    {
+        free(schedulerCore->pixels);
+        schedulerCore->pixels = NULL;
+    }
+    if (schedulerCore->audioBuffer)
+    {
+        free(schedulerCore->audioBuffer);
+        schedulerCore->audioBuffer = NULL;
+    }
+    schedulerCore->core = NULL;
+}
+
+/** Returns the entry of a core, its output is valid until the next tick */
+struct SchedulerCore *sched_getCore(struct Scheduler *scheduler, int index)
+{
+    return &scheduler->cores[index];
+}
+
+/** Frames to run per tick (0 pauses the core) and the host time they may take. A paused core outputs no frames and no audio. */
+void sched_setBudget(struct Scheduler *scheduler, int index, int framesPerTick, double timeBudget)
+{
+    struct SchedulerCore *schedulerCore = &scheduler->cores[index];
+    if (framesPerTick < 0) framesPerTick = 0;
+    if (framesPerTick > SCHED_MAX_FRAMES_PER_TICK) framesPerTick = SCHED_MAX_FRAMES_PER_TICK;
+    schedulerCore->framesPerTick = framesPerTick;
+    schedulerCore->timeBudget = timeBudget;
+}
+
+/** Input for the next tick, a key press is used once */
+void sched_setInput(struct Scheduler *scheduler, int index, struct CoreInput *input)
+{
+    scheduler->cores[index].input = *input;
+}
+
+/** Steps all cores on the worker pool and returns when all are done. Core delegates are called on the worker threads. */
+void sched_runTick(struct Scheduler *scheduler)
+{
+    double startTime = headless_getTime();
+    
+    // every worker starts with an equal range, the ones finishing early steal from the others
+    int numCores = scheduler->numCores;
+    int numWorkers = scheduler->numWorkers;
+    for (int i = 0; i < numWorkers; i++)
+    {
+        struct SchedulerWorker *worker = &scheduler->workers[i];
+        worker->begin = numCores * i / numWorkers;
+        worker->end = numCores * (i + 1) / numWorkers;
+        worker->numSteals = 0;
+    }
+    
+    pthread_mutex_lock(&scheduler->mutex);
+    scheduler->numBusyWorkers = numWorkers;
+    scheduler->tick++;
+    pthread_cond_broadcast(&scheduler->didStartTick);
+    while (scheduler->numBusyWorkers > 0)
+    {
+        pthread_cond_wait(&scheduler->didFinishTick, &scheduler->mutex);
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    
+    scheduler->numSteals = 0;
+    for (int i = 0; i < numWorkers; i++)
+    {
+        scheduler->numSteals += scheduler->workers[i].numSteals;
+    }
+    scheduler->numOverBudgetCores = 0;
+    for (int i = 0; i < numCores; i++)
+    {
+        struct SchedulerCore *schedulerCore = &scheduler->cores[i];
+        if (schedulerCore->core && schedulerCore->isOverBudget)
+        {
+            scheduler->numOverBudgetCores++;
+        }
+    }
+    scheduler->tickTime = headless_getTime() - startTime;
+}
+
+void *sched_runWorker(void *context)
+{
+    struct SchedulerWorker *worker = context;
+    struct Scheduler *scheduler = worker->scheduler;
+    long lastTick = 0;
+    
+    pthread_mutex_lock(&scheduler->mutex);
+    while (true)
+    {
+        while (scheduler->tick == lastTick && !scheduler->quit)
+        {
+            pthread_cond_wait(&scheduler->didStartTick, &scheduler->mutex);
+        }
+        if (scheduler->quit) break;
+        lastTick = scheduler->tick;
+        pthread_mutex_unlock(&scheduler->mutex);
+        
+        sched_work(worker);
+        
+        pthread_mutex_lock(&scheduler->mutex);
+        scheduler->numBusyWorkers--;
+        if (scheduler->numBusyWorkers == 0)
+        {
+            pthread_cond_signal(&scheduler->didFinishTick);
+        }
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    return NULL;
+}
+
+void sched_work(struct SchedulerWorker *worker)
+{
+    struct Scheduler *scheduler = worker->scheduler;
+    while (true)
+    {
+        int index = sched_takeOwn(worker);
+        if (index == -1)
+        {
+            index = sched_steal(worker);
+        }
+        if (index == -1) break;
+        
+        struct SchedulerCore *schedulerCore = &scheduler->cores[index];
+        if (schedulerCore->core)
+        {
+            sched_stepCore(scheduler, schedulerCore);
+        }
+    }
+}
+
+/** Takes the next core from the front of the own range */
+int sched_takeOwn(struct SchedulerWorker *worker)
+{
+    int index = -1;
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->begin < worker->end)
+    {
+        index = worker->begin++;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return index;
+}
+
+/** Takes the back half of another worker's range, returns its first core or -1 if all ranges are empty */
+int sched_steal(struct SchedulerWorker *worker)
+{
+    struct Scheduler *scheduler = worker->scheduler;
+    int self = (int)(worker - scheduler->workers);
+    
+    for (int i = 1; i < scheduler->numWorkers; i++)
+    {
+        struct SchedulerWorker *victim = &scheduler->workers[(self + i) % scheduler->numWorkers];
+        int begin = 0;
+        int end = 0;
+        
+        pthread_mutex_lock(&victim->mutex);
+        int count = victim->end - victim->begin;
+        if (count > 0)
+        {
+            end = victim->end;
+            begin = end - (count + 1) / 2;
+            victim->end = begin;
+        }
+        pthread_mutex_unlock(&victim->mutex);
+        
+        if (end > begin)
+        {
+            pthread_mutex_lock(&worker->mutex);
+            worker->begin = begin + 1;
+            worker->end = end;
+            worker->numSteals++;
+            pthread_mutex_unlock(&worker->mutex);
+            return begin;
+        }
+    }
+    return -1;
+}
+
+/** Runs the frames of one tick, only the last one is rendered into the pixels */
+void sched_stepCore(struct Scheduler *scheduler, struct SchedulerCore *schedulerCore)
+{
+    struct Core *core = schedulerCore->core;
+    int samplesPerFrame = scheduler->samplesPerFrame;
+    double startTime = headless_getTime();
+    
+    schedulerCore->numFrames = 0;
+    schedulerCore->isOverBudget = false;
+    for (int i = 0; i < schedulerCore->framesPerTick; i++)
+    {
+        core_update(core, &schedulerCore->input);
+        
+        bool isLastFrame = (i == schedulerCore->framesPerTick - 1);
+        if (!isLastFrame && schedulerCore->timeBudget > 0.0 && headless_getTime() - startTime > schedulerCore->timeBudget)
+        {
+            // out of time, the remaining frames are dropped
+            schedulerCore->isOverBudget = true;
+            isLastFrame = true;
+        }
+        
+        // skipped frames are rendered without output, raster interrupts still need to run
+        video_renderScreen(core, isLastFrame ? schedulerCore->pixels : NULL);
+        audio_renderAudio(core, &schedulerCore->audioBuffer[i * samplesPerFrame], samplesPerFrame, scheduler->samplingRate, 0);
+        schedulerCore->numFrames++;
+        if (isLastFrame) break;
+    }
+    schedulerCore->numAudioSamples = schedulerCore->numFrames * samplesPerFrame;
+    
+    double time = headless_getTime() - startTime;
+    if (schedulerCore->timeBudget > 0.0 && time > schedulerCore->timeBudget)
+    {
+        schedulerCore->isOverBudget = true;
+    }
+    if (schedulerCore->isOverBudget)
+    {
+        schedulerCore->numOverBudgetTicks++;
+    }
+    schedulerCore->time = time;
+}
@@ -0,0 +1,93 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef scheduler_h
+#define scheduler_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "core.h"
+
+#define SCHED_MAX_WORKERS 64
+#define SCHED_MAX_FRAMES_PER_TICK 8
+
+struct Scheduler;
+
+/** One core stepped by the scheduler, with its budget and the output of the last tick */
+struct SchedulerCore {
+    struct Core *core;
+    struct CoreInput input;
+    int framesPerTick;
+    double timeBudget; // seconds per tick, 0 for no limit
+    
+    // output of the last tick
+    uint32_t *pixels; // unchanged if no frame ran
+    int16_t *audioBuffer;
+    int numFrames;
+    int numAudioSamples; // can be 0, for example while paused
+    double time;
+    bool isOverBudget;
+    long numOverBudgetTicks;
+};
+
+/** Thread of the pool, owns a range of core indices that other workers can steal from */
+struct SchedulerWorker {
+    struct Scheduler *scheduler;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    int begin;
+    int end;
+    long numSteals;
+};
+
+struct Scheduler {
+    pthread_mutex_t mutex;
+    pthread_cond_t didStartTick;
+    pthread_cond_t didFinishTick;
+    struct SchedulerWorker workers[SCHED_MAX_WORKERS];
+    int numWorkers;
+    int numBusyWorkers;
+    long tick;
+    bool quit;
+    
+    struct SchedulerCore *cores;
+    int numCores;
+    int capacity;
+    int samplingRate;
+    int samplesPerFrame;
+    
+    // stats of the last tick
+    double tickTime;
+    long numSteals;
+    int numOverBudgetCores;
+};
+
+void sched_init(struct Scheduler *scheduler, int numWorkers, int samplingRate);
+void sched_deinit(struct Scheduler *scheduler);
+int sched_addCore(struct Scheduler *scheduler, struct Core *core);
+void sched_removeCore(struct Scheduler *scheduler, int index);
+struct SchedulerCore *sched_getCore(struct Scheduler *scheduler, int index);
+void sched_setBudget(struct Scheduler *scheduler, int index, int framesPerTick, double timeBudget);
+void sched_setInput(struct Scheduler *scheduler, int index, struct CoreInput *input);
+void sched_runTick(struct Scheduler *scheduler);
+
+#endif /* scheduler_h */
@@ -0,0 +1,352 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "headless_runner.h"
+#include "scheduler.h"
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define DEFAULT_CORES 64
+#define DEFAULT_FRAMES 600
+#define DEFAULT_SEED 1
+#define DEFAULT_WORKERS 4
+
+// frames per tick of the catch-up phase, divides the 8 frames between random input changes
+#define CATCH_UP_FRAMES_PER_TICK 4
+
+#define MAX_PROGRAMS 64
+#define MAX_CORES 1024
+
+/** One core running one program, first alone, then in parallel with all others on its own thread and on the scheduler */
+struct StressJob {
+    const char *filename;
+    int numFrames;
+    uint32_t seed;
+    uint64_t videoHash;
+    uint64_t audioHash;
+    uint64_t catchUpVideoHash;
+    uint64_t memoryHash;
+    bool hasFailed;
+    const char *errorText;
+};
+
+void printUsage(const char *executable);
+void *runJob(void *context);
+void runScheduledJobs(struct StressJob *jobs, int numJobs, int numWorkers, int framesPerTick);
+
+
+int main(int argc, const char * argv[])
+{
+    const char *programFilenames[MAX_PROGRAMS];
+    int numPrograms = 0;
+    int numCores = DEFAULT_CORES;
+    int numFrames = DEFAULT_FRAMES;
+    uint32_t seed = DEFAULT_SEED;
+    int numWorkers = DEFAULT_WORKERS;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] == '-')
+        {
+            if (i + 1 >= argc)
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+            const char *value = argv[++i];
+            if (strcmp(arg, "-cores") == 0)
+            {
+                numCores = atoi(value);
+            }
+            else if (strcmp(arg, "-frames") == 0)
+            {
+                numFrames = atoi(value);
+            }
+            else if (strcmp(arg, "-seed") == 0)
+            {
+                seed = (uint32_t)strtoul(value, NULL, 10);
+            }
+            else if (strcmp(arg, "-workers") == 0)
+            {
+                numWorkers = atoi(value);
+            }
+            else
+            {
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        else if (numPrograms < MAX_PROGRAMS)
+        {
+            programFilenames[numPrograms++] = arg;
+        }
+    }
+    
+    if (numPrograms == 0 || numCores <= 0 || numCores > MAX_CORES || numFrames <= 0 || numWorkers <= 0 || numWorkers > SCHED_MAX_WORKERS)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+    
+    struct StressJob *serialJobs = calloc(numCores, sizeof(struct StressJob));
+    struct StressJob *parallelJobs = calloc(numCores, sizeof(struct StressJob));
+    struct StressJob *scheduledJobs = calloc(numCores, sizeof(struct StressJob));
+    struct StressJob *catchUpJobs = calloc(numCores, sizeof(struct StressJob));
+    pthread_t *threads = calloc(numCores, sizeof(pthread_t));
+    if (!serialJobs || !parallelJobs || !scheduledJobs || !catchUpJobs || !threads) exit(EXIT_FAILURE);
+    
+    // the programs take turns, each core gets its own input
+    for (int i = 0; i < numCores; i++)
+    {
+        struct StressJob *job = &serialJobs[i];
+        job->filename = programFilenames[i % numPrograms];
+        job->numFrames = numFrames;
+        job->seed = seed + i;
+        parallelJobs[i] = *job;
+        scheduledJobs[i] = *job;
+        catchUpJobs[i] = *job;
+    }
+    
+    double serialStart = headless_getTime();
+    for (int i = 0; i < numCores; i++)
+    {
+        runJob(&serialJobs[i]);
+    }
+    double serialTime = headless_getTime() - serialStart;
+    
+    double parallelStart = headless_getTime();
+    for (int i = 0; i < numCores; i++)
+    {
+        if (pthread_create(&threads[i], NULL, runJob, &parallelJobs[i]) != 0) exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < numCores; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    double parallelTime = headless_getTime() - parallelStart;
+    
+    double scheduledStart = headless_getTime();
+    runScheduledJobs(scheduledJobs, numCores, numWorkers, 1);
+    double scheduledTime = headless_getTime() - scheduledStart;
+    
+    double catchUpStart = headless_getTime();
+    runScheduledJobs(catchUpJobs, numCores, numWorkers, CATCH_UP_FRAMES_PER_TICK);
+    double catchUpTime = headless_getTime() - catchUpStart;
+    
+    int result = 0;
+    int numMismatches = 0;
+    for (int i = 0; i < numCores; i++)
+    {
+        struct StressJob *serialJob = &serialJobs[i];
+        struct StressJob *parallelJob = &parallelJobs[i];
+        struct StressJob *scheduledJob = &scheduledJobs[i];
+        struct StressJob *catchUpJob = &catchUpJobs[i];
+        if (serialJob->hasFailed || parallelJob->hasFailed || scheduledJob->hasFailed || catchUpJob->hasFailed)
+        {
+            const char *errorText = serialJob->hasFailed ? serialJob->errorText : parallelJob->hasFailed ? parallelJob->errorText : scheduledJob->hasFailed ? scheduledJob->errorText : catchUpJob->errorText;
+            fprintf(stderr, "core %d: %s: %s\n", i, serialJob->filename, errorText);
+            result = 1;
+        }
+        else if (   serialJob->videoHash != parallelJob->videoHash
+                 || serialJob->audioHash != parallelJob->audioHash
+                 || serialJob->videoHash != scheduledJob->videoHash
+                 || serialJob->audioHash != scheduledJob->audioHash
+                 || serialJob->memoryHash != parallelJob->memoryHash
+                 || serialJob->memoryHash != scheduledJob->memoryHash
+                 || serialJob->catchUpVideoHash != catchUpJob->videoHash
+                 || serialJob->audioHash != catchUpJob->audioHash
+                 || serialJob->memoryHash != catchUpJob->memoryHash)
+        {
+            fprintf(stderr, "core %d: %s: output differs from serial run\n", i, serialJob->filename);
+            numMismatches++;
+            result = 1;
+        }
+    }
+    
+    printf("cores: %d\n", numCores);
+    printf("frames: %d\n", numFrames);
+    printf("serial: %.3f s\n", serialTime);
+    printf("parallel: %.3f s\n", parallelTime);
+    printf("scheduled: %.3f s (%d workers)\n", scheduledTime, numWorkers);
+    printf("catch-up: %.3f s (%d frames per tick)\n", catchUpTime, CATCH_UP_FRAMES_PER_TICK);
+    printf("mismatches: %d\n", numMismatches);
+    
+    free(threads);
+    free(catchUpJobs);
+    free(scheduledJobs);
+    free(parallelJobs);
+    free(serialJobs);
+    return result;
+}
+
+void printUsage(const char *executable)
+{
+    fprintf(stderr, "usage: %s [-cores n] [-frames n] [-seed n] [-workers n] program.nx ...\n", executable);
+}
+
+void *runJob(void *context)
+{
+    struct StressJob *job = context;
+    
+    struct InputScript *script = calloc(1, sizeof(struct InputScript));
+    if (!script) exit(EXIT_FAILURE);
+    script_init(script);
+    script_setRandom(script, job->seed);
+    
+    struct HeadlessRunner runner;
+    headless_init(&runner);
+    if (!headless_isOkay(&runner)) exit(EXIT_FAILURE);
+    runner.script = script;
+    
+    struct CoreError error = headless_loadProgram(&runner, job->filename);
+    if (error.code != ErrorNone)
+    {
+        job->hasFailed = true;
+        job->errorText = err_getString(error.code);
+    }
+    else
+    {
+        job->catchUpVideoHash = HEADLESS_HASH_OFFSET_BASIS;
+        for (int i = 0; i < job->numFrames; i++)
+        {
+            headless_runFrame(&runner);
+            
+            // the catch-up phase only shows the last frame of each tick
+            if ((i + 1) % CATCH_UP_FRAMES_PER_TICK == 0 || i == job->numFrames - 1)
+            {
+                job->catchUpVideoHash = headless_hash(job->catchUpVideoHash, runner.pixels, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+            }
+        }
+        job->videoHash = runner.videoHash;
+        job->audioHash = runner.audioHash;
+        job->memoryHash = headless_hash(HEADLESS_HASH_OFFSET_BASIS, runner.core->machine, sizeof(struct Machine));
+        if (runner.hasFailed)
+        {
+            job->hasFailed = true;
+            job->errorText = err_getString(runner.error.code);
+        }
+    }
+    
+    headless_deinit(&runner);
+    free(script);
+    return NULL;
+}
+
+/** Runs all jobs on one scheduler, the worker that steps a core can change every tick. Cores running the same program share it.
+ * With more than one frame per tick, the input only changes between ticks and only the last frame of each tick is hashed. */
+void runScheduledJobs(struct StressJob *jobs, int numJobs, int numWorkers, int framesPerTick)
+{
+    struct Scheduler *scheduler = calloc(1, sizeof(struct Scheduler));
+    struct HeadlessRunner *runners = calloc(numJobs, sizeof(struct HeadlessRunner));
+    struct InputScript *scripts = calloc(numJobs, sizeof(struct InputScript));
+    int *indices = calloc(numJobs, sizeof(int));
+    if (!scheduler || !runners || !scripts || !indices) exit(EXIT_FAILURE);
+    
+    sched_init(scheduler, numWorkers, HEADLESS_SAMPLING_RATE);
+    
+    for (int i = 0; i < numJobs; i++)
+    {
+        struct StressJob *job = &jobs[i];
+        struct HeadlessRunner *runner = &runners[i];
+        headless_init(runner);
+        if (!headless_isOkay(runner)) exit(EXIT_FAILURE);
+        script_init(&scripts[i]);
+        script_setRandom(&scripts[i], job->seed);
+        job->videoHash = HEADLESS_HASH_OFFSET_BASIS;
+        job->audioHash = HEADLESS_HASH_OFFSET_BASIS;
+        
+        indices[i] = -1;
+        struct Program *program = NULL;
+        for (int j = 0; j < i && !program; j++)
+        {
+            if (strcmp(jobs[j].filename, job->filename) == 0)
+            {
+                program = core_getProgram(runners[j].core);
+            }
+        }
+        
+        struct CoreError error = err_noCoreError();
+        if (program)
+        {
+            headless_loadSharedProgram(runner, program);
+        }
+        else
+        {
+            error = headless_loadProgram(runner, job->filename);
+        }
+        if (error.code != ErrorNone)
+        {
+            job->hasFailed = true;
+            job->errorText = err_getString(error.code);
+        }
+        else
+        {
+            indices[i] = sched_addCore(scheduler, runner->core);
+            if (indices[i] == -1) exit(EXIT_FAILURE);
+        }
+    }
+    
+    int numFrames = numJobs > 0 ? jobs[0].numFrames : 0;
+    for (int frame = 0; frame < numFrames; frame += framesPerTick)
+    {
+        int numTickFrames = (numFrames - frame < framesPerTick) ? numFrames - frame : framesPerTick;
+        for (int i = 0; i < numJobs; i++)
+        {
+            if (indices[i] == -1) continue;
+            script_apply(&scripts[i], frame, &sched_getCore(scheduler, indices[i])->input);
+            sched_setBudget(scheduler, indices[i], numTickFrames, 0.0);
+        }
+        
+        sched_runTick(scheduler);
+        
+        for (int i = 0; i < numJobs; i++)
+        {
+            if (indices[i] == -1) continue;
+            struct StressJob *job = &jobs[i];
+            struct SchedulerCore *schedulerCore = sched_getCore(scheduler, indices[i]);
+            job->videoHash = headless_hash(job->videoHash, schedulerCore->pixels, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+            job->audioHash = headless_hash(job->audioHash, schedulerCore->audioBuffer, schedulerCore->numAudioSamples * sizeof(int16_t));
+        }
+    }
+    
+    for (int i = 0; i < numJobs; i++)
+    {
+        struct StressJob *job = &jobs[i];
+        struct HeadlessRunner *runner = &runners[i];
+        job->memoryHash = headless_hash(HEADLESS_HASH_OFFSET_BASIS, runner->core->machine, sizeof(struct Machine));
+        if (runner->hasFailed && !job->hasFailed)
+        {
+            job->hasFailed = true;
+            job->errorText = err_getString(runner->error.code);
+        }
+    }
+    
+    sched_deinit(scheduler);
+    for (int i = 0; i < numJobs; i++)
+    {
+        headless_deinit(&runners[i]);
+    }
+    free(indices);
+    free(scripts);
+    free(runners);
+    free(scheduler);
+}
@@ -29,6 +29,7 @@
 #define SAMPLING_RATE 44100.0f
 #define VIDEO_PIXELS SCREEN_WIDTH * SCREEN_HEIGHT
 #define AUDIO_SAMPLES 1470
+#define STATE_RESERVE_SIZE 0x100000
 
 static struct retro_log_callback logging;
 static retro_log_printf_t log;
@@ -53,6 +54,10 @@ static bool hasPressesPauseLastUpdate = false;
 static bool messageShownUsingDisk = false;
 static enum MainState mainState = MainStateUndefined;
 static char *sourceCode = NULL;
+static size_t serializeSize = 0;
+static void *serializedState = NULL;
+static size_t serializedStateSize = 0;
+static size_t serializedStateCapacity = 0;
 
 void bootNX(void);
 void runMainProgram(void);
@@ -93,6 +98,7 @@ void init_joysticks()
         {0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_RIGHT, "D-Pad Right"},
         {0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A, "A"},
         {0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_B, "B"},
+        {0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2, "Rewind (hold)"},
         
         // Player 2
         {1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT, "D-Pad Left"},
@@ -265,6 +271,7 @@ RETRO_API void retro_init(void)
         coreDelegate.persistentRamDidChange = persistentRamDidChange;
         
         core_setDelegate(core, &coreDelegate);
+        core_setRewind(core, REWIND_DEFAULT_BUFFER_SIZE);
     }
     
     pixels = calloc(VIDEO_PIXELS, sizeof(uint32_t));
@@ -297,6 +304,14 @@ RETRO_API void retro_deinit(void)
         free(audio_buf);
         audio_buf = NULL;
     }
+    
+    if (serializedState)
+    {
+        free(serializedState);
+        serializedState = NULL;
+        serializedStateSize = 0;
+        serializedStateCapacity = 0;
+    }
 }
 
 /* Must return RETRO_API_VERSION. Used to validate ABI compatibility
@@ -368,6 +383,13 @@ RETRO_API void retro_run(void)
 {
     input_poll_callback();
     
+    // run-ahead runs frames which are not shown or heard
+    int audioVideoEnable = 0;
+    if (!environment_callback(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &audioVideoEnable))
+    {
+        audioVideoEnable = 3;
+    }
+    
     if (core && pixels && audio_buf)
     {
         for (int i = 0; i < NUM_GAMEPADS; ++i)
@@ -403,7 +425,14 @@ RETRO_API void retro_run(void)
                 break;
                 
             case MainStateRunningProgram:
+                if (input_state_callback(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2))
+                {
+                    // steps back one frame per run while held
+                    core_rewindFrame(core);
+                    break;
+                }
                 core_update(core, &coreInput);
+                core_saveRewindFrame(core);
                 if (hasInput)
                 {
                     if (core->interpreter->state == StateEnd)
@@ -433,11 +462,27 @@ RETRO_API void retro_run(void)
         
         hasUsedInputLastUpdate = coreInput.out_hasUsedInput;
         
-        video_renderScreen(core, pixels);
-        video_refresh_callback(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, sizeof(uint32_t) * SCREEN_WIDTH);
+        if (audioVideoEnable & 1)
+        {
+            video_renderScreen(core, pixels);
+            video_refresh_callback(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, sizeof(uint32_t) * SCREEN_WIDTH);
+        }
+        else
+        {
+            // raster interrupts still need to run
+            video_renderScreen(core, NULL);
+            video_refresh_callback(NULL, SCREEN_WIDTH, SCREEN_HEIGHT, sizeof(uint32_t) * SCREEN_WIDTH);
+        }
         
-        audio_renderAudio(core, audio_buf, AUDIO_SAMPLES, SAMPLING_RATE, 0);
-        audio_sample_batch_callback(audio_buf, AUDIO_SAMPLES / 2);
+        // audio state is needed for the next frames, unless audio is disabled for good
+        if (!(audioVideoEnable & 8))
+        {
+            audio_renderAudio(core, audio_buf, AUDIO_SAMPLES, SAMPLING_RATE, 0);
+            if (audioVideoEnable & 2)
+            {
+                audio_sample_batch_callback(audio_buf, AUDIO_SAMPLES / 2);
+            }
+        }
     }
     
     hasInput = false;
@@ -456,7 +501,18 @@ RETRO_API void retro_run(void)
  */
 RETRO_API size_t retro_serialize_size(void)
 {
-    return 0;
+    if (!core) return 0;
+    
+    if (serializeSize == 0)
+    {
+        size_t stateSize = core_getStateSize(core);
+        if (stateSize > 0)
+        {
+            // variables and strings can grow, but the size must not
+            serializeSize = stateSize + STATE_RESERVE_SIZE;
+        }
+    }
+    return serializeSize;
 }
 
 /* Serializes internal state. If failed, or size is lower than
@@ -464,12 +520,37 @@ RETRO_API size_t retro_serialize_size(void)
 
 RETRO_API bool retro_serialize(void *data, size_t size)
 {
-    return false;
+    if (!core) return false;
+    
+    // writes directly into the frontend's buffer, run-ahead calls it every frame
+    size_t stateSize = core_getStateSize(core);
+    if (!core_saveState(core, data, size)) return false;
+    
+    // run-ahead loads this state again after running frames it discards, they must not stay in the rewind history
+    if (stateSize > serializedStateCapacity)
+    {
+        void *newState = realloc(serializedState, size);
+        if (!newState) return true;
+        serializedState = newState;
+        serializedStateCapacity = size;
+    }
+    memcpy(serializedState, data, stateSize);
+    serializedStateSize = stateSize;
+    core_setRewindCheckpoint(core);
+    return true;
 }
 
 RETRO_API bool retro_unserialize(const void *data, size_t size)
 {
-    return false;
+    if (!core) return false;
+    
+    if (!core_loadState(core, data, size)) return false;
+    
+    if (serializedStateSize > 0 && serializedStateSize <= size && memcmp(data, serializedState, serializedStateSize) == 0)
+    {
+        core_restoreRewindCheckpoint(core);
+    }
+    return true;
 }
 
 RETRO_API void retro_cheat_reset(void)
@@ -485,6 +566,12 @@ RETRO_API bool retro_load_game(const struct retro_game_info *game)
 {
     log(RETRO_LOG_INFO, "[LowRes NX] Load game\n");
     
+    serializeSize = 0;
+    
+    // states contain structures as they are in memory
+    uint64_t quirks = RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT | RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT;
+    environment_callback(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &quirks);
+    
     if (core && game && game->data)
     {
         sourceCode = calloc(1, game->size + 1); // +1 for terminator
@@ -525,6 +612,8 @@ RETRO_API void retro_unload_game(void)
         free(sourceCode);
         sourceCode = NULL;
     }
+    serializeSize = 0;
+    serializedStateSize = 0;
 }
 
 /* Gets region of game. */
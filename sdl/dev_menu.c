@@ -59,11 +59,12 @@ void dev_showClearRamMenu(struct DevMenu *devMenu);
 void dev_showMenu(struct DevMenu *devMenu, const char *message, const char *buttons[], int numButtons, int numRemoveButtons);
 void dev_clearPersistentRam(struct DevMenu *devMenu);
 
-void dev_init(struct DevMenu *devMenu, struct Runner *runner, struct Settings *settings)
+void dev_init(struct DevMenu *devMenu, struct Runner *runner, struct Settings *settings, struct Pacer *pacer)
 {
     memset(devMenu, 0, sizeof(struct DevMenu));
     devMenu->runner = runner;
     devMenu->settings = settings;
+    devMenu->pacer = pacer;
 }
 
 void dev_show(struct DevMenu *devMenu, bool reload)
@@ -96,10 +97,11 @@ void dev_show(struct DevMenu *devMenu, bool reload)
     
     memcpy(&core->machine->colorRegisters, dev_colors, sizeof(dev_colors));
     memcpy(&core->machine->videoRam.characters, dev_characters, sizeof(dev_characters));
-    memcpy(&core->machine->cartridgeRom, dev_bg, sizeof(dev_bg));
+    memcpy(&core->machine->workingRam, dev_bg, sizeof(dev_bg));
     
-    textLib->sourceAddress = 4;
-    textLib->sourceWidth = core->machine->cartridgeRom[2];
+    // the ROM belongs to the program, the background is in working RAM instead
+    textLib->sourceAddress = 0xA000 + 4;
+    textLib->sourceWidth = core->machine->workingRam[2];
     
     txtlib_copyBackground(textLib, 0, 0, 20, 16, 0, 0);
     dev_updateButtons(devMenu);
@@ -221,6 +223,7 @@ bool dev_handleDropFile(struct DevMenu *devMenu, const char *filename)
 void dev_showInfo(struct DevMenu *devMenu)
 {
     struct Core *core = devMenu->runner->core;
+    struct Program *program = core->interpreter->program;
     struct TextLib *textLib = &devMenu->textLib;
     
     char info[21];
@@ -230,18 +233,44 @@ void dev_showInfo(struct DevMenu *devMenu)
     txtlib_writeText(textLib, "ROM:", 0, 8);
 
     textLib->charAttr.palette = 0;
-    sprintf(info, "%d/%d", core->interpreter->tokenizer.numTokens, MAX_TOKENS);
+    sprintf(info, "%d/%d", program ? program->tokenizer.numTokens : 0, MAX_TOKENS);
     txtlib_writeText(textLib, info, 20 - (int)strlen(info), 7);
-    sprintf(info, "%d/%d", data_currentSize(&core->interpreter->romDataManager), DATA_SIZE);
+    sprintf(info, "%d/%d", program ? data_currentSize(&program->romDataManager) : 0, DATA_SIZE);
     txtlib_writeText(textLib, info, 20 - (int)strlen(info), 8);
     
+    // frame pacing of the last run
+    struct PacerStats stats = pacer_getStats(devMenu->pacer);
+    
+    textLib->charAttr.palette = 5;
+    txtlib_writeText(textLib, "FRAME MS:", 0, 9);
+    txtlib_writeText(textLib, "MAX/LATE:", 0, 10);
+    txtlib_writeText(textLib, "JITTER MS:", 0, 11);
+    txtlib_writeText(textLib, "DISPLAY HZ:", 0, 12);
+    
+    textLib->charAttr.palette = 0;
+    sprintf(info, "%.2f", stats.frameTime);
+    txtlib_writeText(textLib, info, 20 - (int)strlen(info), 9);
+    snprintf(info, sizeof(info), "%.1f/%d", stats.maxFrameTime, stats.numLateFrames);
+    txtlib_writeText(textLib, info, 20 - (int)strlen(info), 10);
+    sprintf(info, "%.2f", stats.jitter);
+    txtlib_writeText(textLib, info, 20 - (int)strlen(info), 11);
+    if (devMenu->displayRate > 0.0)
+    {
+        sprintf(info, "%.2f", devMenu->displayRate);
+    }
+    else
+    {
+        sprintf(info, "-");
+    }
+    txtlib_writeText(textLib, info, 20 - (int)strlen(info), 12);
+    
     textLib->charAttr.palette = 4;
     txtlib_writeText(textLib, "READY TO RUN", 4, 14);
 }
 
 void dev_showError(struct DevMenu *devMenu, struct CoreError error)
 {
-    struct Core *core = devMenu->runner->core;
+    struct Program *program = devMenu->runner->core->interpreter->program;
     struct TextLib *textLib = &devMenu->textLib;
     
     textLib->charAttr.palette = 0;
@@ -251,15 +280,15 @@ void dev_showError(struct DevMenu *devMenu, struct CoreError error)
     textLib->charAttr.palette = 2;
     txtlib_printText(textLib, err_getString(error.code));
     txtlib_printText(textLib, "\n");
-    if (error.sourcePosition >= 0 && core->interpreter->sourceCode)
+    if (error.sourcePosition >= 0 && program)
     {
         textLib->charAttr.palette = 0;
-        int number = lineNumber(core->interpreter->sourceCode, error.sourcePosition);
+        int number = lineNumber(program->sourceCode, error.sourcePosition);
         char lineNumberText[30];
         sprintf(lineNumberText, "IN LINE %d:\n", number);
         txtlib_printText(textLib, lineNumberText);
         
-        const char *line = lineString(core->interpreter->sourceCode, error.sourcePosition);
+        const char *line = lineString(program->sourceCode, error.sourcePosition);
         if (line)
         {
             textLib->charAttr.palette = 5;
@@ -30,6 +30,7 @@
 #include "core.h"
 #include "settings.h"
 #include "runner.h"
+#include "pacer.h"
 #include "text_lib.h"
 
 enum DevModeMenu {
@@ -41,6 +42,8 @@ enum DevModeMenu {
 struct DevMenu {
     struct Runner *runner;
     struct Settings *settings;
+    struct Pacer *pacer;
+    double displayRate;
     bool lastTouch;
     enum DevModeMenu currentMenu;
     int currentButton;
@@ -49,7 +52,7 @@ struct DevMenu {
     struct TextLib textLib;
 };
 
-void dev_init(struct DevMenu *devMenu, struct Runner *runner, struct Settings *settings);
+void dev_init(struct DevMenu *devMenu, struct Runner *runner, struct Settings *settings, struct Pacer *pacer);
 void dev_show(struct DevMenu *devMenu, bool reload);
 void dev_update(struct DevMenu *devMenu, struct CoreInput *input);
 bool dev_handleDropFile(struct DevMenu *devMenu, const char *filename);
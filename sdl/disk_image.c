@@ -0,0 +1,338 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "disk_image.h"
+#include "mapped_file.h"
+#include "system_paths.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define DISKIMG_SUFFIX "d"
+#define DISKIMG_TEMP_SUFFIX ".tmp"
+#define DISKIMG_JOURNAL_SUFFIX ".journal"
+#define DISKIMG_MAGIC 0x49584E4C // "LNXI"
+#define DISKIMG_JOURNAL_MAGIC 0x4A584E4C // "LNXJ"
+
+// magic, text disk size, seconds and nanoseconds of its modification time, then the binary disk of data_exportBinary
+#define DISKIMG_HEADER_SIZE 24
+
+// magic, number of regions, then each region with offset, length and bytes, then checksum
+#define DISKIMG_JOURNAL_HEADER_SIZE 8
+#define DISKIMG_REGION_HEADER_SIZE 8
+
+bool diskimg_readStamp(const char *filename, struct DiskStamp *stamp);
+void diskimg_writeHeader(uint8_t *output, const struct DiskStamp *stamp);
+void diskimg_recover(const char *filename);
+bool diskimg_writeFile(const char *filename, const uint8_t *data, size_t size);
+void diskimg_getSiblingFilename(char *outputString, const char *filename, const char *suffix);
+void diskimg_writeInt(uint8_t *output, uint32_t value);
+uint32_t diskimg_readInt(const uint8_t *input);
+uint32_t diskimg_getChecksum(const uint8_t *data, size_t size);
+
+
+/** The binary image of "Disk.nx" is "Disk.nxd" */
+void diskimg_getFilename(char *outputString, const char *diskFilename)
+{
+    diskimg_getSiblingFilename(outputString, diskFilename, DISKIMG_SUFFIX);
+}
+
+/** Size and modification time of the text disk, get them before reading it. Returns false if it doesn't exist. */
+bool diskimg_getDiskStamp(const char *diskFilename, struct DiskStamp *stamp)
+{
+    memset(stamp, 0, sizeof(struct DiskStamp));
+#if defined(_WIN32)
+    WCHAR nameW[FILENAME_MAX] = { 0 };
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (MultiByteToWideChar(CP_UTF8, 0, diskFilename, -1, nameW, FILENAME_MAX) <= 0 || !GetFileAttributesExW(nameW, GetFileExInfoStandard, &attributes)) return false;
+    
+    // 100 nanosecond intervals
+    uint64_t time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    stamp->size = ((int64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    stamp->seconds = time / 10000000;
+    stamp->nanoseconds = (time % 10000000) * 100;
+#else
+    struct stat fileStat;
+    if (stat(diskFilename, &fileStat) != 0) return false;
+    
+    stamp->size = fileStat.st_size;
+    stamp->seconds = fileStat.st_mtime;
+#if defined(__APPLE__) && defined(__MACH__)
+    stamp->nanoseconds = (int32_t)fileStat.st_mtimespec.tv_nsec;
+#else
+    stamp->nanoseconds = (int32_t)fileStat.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+
+/** Returns true if the image exists and the text disk is still the one it was made from or exported to */
+bool diskimg_isUpToDate(const char *filename, const char *diskFilename)
+{
+    struct DiskStamp imageStamp;
+    if (!diskimg_readStamp(filename, &imageStamp)) return false;
+    
+    // without a text disk the image is all there is
+    struct DiskStamp diskStamp;
+    if (!diskimg_getDiskStamp(diskFilename, &diskStamp)) return true;
+    
+    return diskStamp.size == imageStamp.size
+        && diskStamp.seconds == imageStamp.seconds
+        && diskStamp.nanoseconds == imageStamp.nanoseconds;
+}
+
+struct CoreError diskimg_load(struct DataManager *manager, const char *filename)
+{
+    diskimg_recover(filename);
+    
+    struct MappedFile file;
+    if (!mapfile_open(&file, filename)) return err_makeCoreError(ErrorInvalidDiskImage, -1);
+    
+    struct CoreError error = err_makeCoreError(ErrorInvalidDiskImage, -1);
+    if (file.size >= DISKIMG_HEADER_SIZE && diskimg_readInt(file.data) == DISKIMG_MAGIC)
+    {
+        error = data_importBinary(manager, (const uint8_t *)file.data + DISKIMG_HEADER_SIZE, file.size - DISKIMG_HEADER_SIZE, true);
+    }
+    mapfile_close(&file);
+    return error;
+}
+
+/** Writes the whole image to a temporary file first and replaces the old one with it. The stamp is the one of the text disk it was made from. */
+bool diskimg_save(struct DataManager *manager, const char *filename, const struct DiskStamp *stamp)
+{
+    size_t size = DISKIMG_HEADER_SIZE + data_getBinarySize(manager);
+    uint8_t *data = malloc(size);
+    if (!data) return false;
+    
+    diskimg_writeHeader(data, stamp);
+    data_exportBinary(manager, data + DISKIMG_HEADER_SIZE);
+    
+    char tempFilename[FILENAME_MAX];
+    diskimg_getSiblingFilename(tempFilename, filename, DISKIMG_TEMP_SUFFIX);
+    bool success = diskimg_writeFile(tempFilename, data, size) && rename_utf8(tempFilename, filename);
+    free(data);
+    
+    if (success)
+    {
+        data_clearChanges(manager);
+    }
+    return success;
+}
+
+/** Writes only the entry records and the changed data. The image must contain the disk as it was before the changes. */
+bool diskimg_saveChanges(struct DataManager *manager, const char *filename, const char *diskFilename)
+{
+    diskimg_recover(filename);
+    
+    FILE *file = fopen_utf8(filename, "r+b");
+    if (!file)
+    {
+        // the new image has changes the text disk doesn't have, so it's kept until the text disk is edited
+        struct DiskStamp stamp;
+        diskimg_getDiskStamp(diskFilename, &stamp);
+        return diskimg_save(manager, filename, &stamp);
+    }
+    
+    int dataOffset = manager->changedStart;
+    int dataLength = manager->changedEnd - manager->changedStart;
+    if (dataLength < 0) dataLength = 0;
+    
+    // journal with both regions
+    size_t size = DISKIMG_JOURNAL_HEADER_SIZE
+        + DISKIMG_REGION_HEADER_SIZE + DATA_BINARY_DATA_OFFSET
+        + DISKIMG_REGION_HEADER_SIZE + dataLength
+        + 4;
+    uint8_t *journal = malloc(size);
+    if (!journal)
+    {
+        fclose(file);
+        return false;
+    }
+    
+    uint8_t *header = journal + DISKIMG_JOURNAL_HEADER_SIZE + DISKIMG_REGION_HEADER_SIZE;
+    uint8_t *data = header + DATA_BINARY_DATA_OFFSET + DISKIMG_REGION_HEADER_SIZE;
+    diskimg_writeInt(journal, DISKIMG_JOURNAL_MAGIC);
+    diskimg_writeInt(journal + 4, 2);
+    diskimg_writeInt(header - 8, DISKIMG_HEADER_SIZE);
+    diskimg_writeInt(header - 4, DATA_BINARY_DATA_OFFSET);
+    data_exportBinaryHeader(manager, header);
+    diskimg_writeInt(data - 8, DISKIMG_HEADER_SIZE + DATA_BINARY_DATA_OFFSET + dataOffset);
+    diskimg_writeInt(data - 4, dataLength);
+    memcpy(data, manager->data + dataOffset, dataLength);
+    diskimg_writeInt(journal + size - 4, diskimg_getChecksum(journal, size - 4));
+    
+    char journalFilename[FILENAME_MAX];
+    diskimg_getSiblingFilename(journalFilename, filename, DISKIMG_JOURNAL_SUFFIX);
+    bool success = diskimg_writeFile(journalFilename, journal, size);
+    
+    // the journal is complete, now the image can be changed in place
+    if (success)
+    {
+        success = fseek(file, DISKIMG_HEADER_SIZE, SEEK_SET) == 0
+            && fwrite(header, 1, DATA_BINARY_DATA_OFFSET, file) == DATA_BINARY_DATA_OFFSET
+            && fseek(file, DISKIMG_HEADER_SIZE + DATA_BINARY_DATA_OFFSET + dataOffset, SEEK_SET) == 0
+            && fwrite(data, 1, dataLength, file) == (size_t)dataLength
+            && fsync_file(file);
+    }
+    fclose(file);
+    free(journal);
+    
+    if (success)
+    {
+        remove_utf8(journalFilename);
+        data_clearChanges(manager);
+    }
+    return success;
+}
+
+/** Call after the text disk was written from the image, so the image stays up to date */
+bool diskimg_setDiskStamp(const char *filename, const struct DiskStamp *stamp)
+{
+    uint8_t header[DISKIMG_HEADER_SIZE];
+    diskimg_writeHeader(header, stamp);
+    
+    FILE *file = fopen_utf8(filename, "r+b");
+    if (!file) return false;
+    
+    // a partly written stamp doesn't match, then the image is made from the text disk again
+    bool success = fwrite(header, 1, DISKIMG_HEADER_SIZE, file) == DISKIMG_HEADER_SIZE && fsync_file(file);
+    fclose(file);
+    return success;
+}
+
+/** Reads the stamp of the text disk from the image header, returns false if there is no valid image */
+bool diskimg_readStamp(const char *filename, struct DiskStamp *stamp)
+{
+    FILE *file = fopen_utf8(filename, "rb");
+    if (!file) return false;
+    
+    uint8_t header[DISKIMG_HEADER_SIZE];
+    bool success = fread(header, 1, DISKIMG_HEADER_SIZE, file) == DISKIMG_HEADER_SIZE && diskimg_readInt(header) == DISKIMG_MAGIC;
+    fclose(file);
+    if (!success) return false;
+    
+    stamp->size = diskimg_readInt(header + 4) | ((int64_t)diskimg_readInt(header + 8) << 32);
+    stamp->seconds = diskimg_readInt(header + 12) | ((int64_t)diskimg_readInt(header + 16) << 32);
+    stamp->nanoseconds = diskimg_readInt(header + 20);
+    return true;
+}
+
+void diskimg_writeHeader(uint8_t *output, const struct DiskStamp *stamp)
+{
+    diskimg_writeInt(output, DISKIMG_MAGIC);
+    diskimg_writeInt(output + 4, (uint32_t)stamp->size);
+    diskimg_writeInt(output + 8, (uint32_t)((uint64_t)stamp->size >> 32));
+    diskimg_writeInt(output + 12, (uint32_t)stamp->seconds);
+    diskimg_writeInt(output + 16, (uint32_t)((uint64_t)stamp->seconds >> 32));
+    diskimg_writeInt(output + 20, stamp->nanoseconds);
+}
+
+/** Completes changes interrupted after their journal was written, incomplete journals are discarded */
+void diskimg_recover(const char *filename)
+{
+    char journalFilename[FILENAME_MAX];
+    diskimg_getSiblingFilename(journalFilename, filename, DISKIMG_JOURNAL_SUFFIX);
+    
+    struct MappedFile journal;
+    if (!mapfile_open(&journal, journalFilename)) return;
+    
+    const uint8_t *bytes = journal.data;
+    size_t size = journal.size;
+    bool isValid = size >= DISKIMG_JOURNAL_HEADER_SIZE + 4
+        && diskimg_readInt(bytes) == DISKIMG_JOURNAL_MAGIC
+        && diskimg_readInt(bytes + size - 4) == diskimg_getChecksum(bytes, size - 4);
+    
+    bool isApplied = false;
+    FILE *file = isValid ? fopen_utf8(filename, "r+b") : NULL;
+    if (file)
+    {
+        isApplied = true;
+        int numRegions = diskimg_readInt(bytes + 4);
+        size_t position = DISKIMG_JOURNAL_HEADER_SIZE;
+        for (int i = 0; i < numRegions && isApplied; i++)
+        {
+            if (position + DISKIMG_REGION_HEADER_SIZE > size - 4) break;
+            
+            uint32_t offset = diskimg_readInt(bytes + position);
+            uint32_t length = diskimg_readInt(bytes + position + 4);
+            position += DISKIMG_REGION_HEADER_SIZE;
+            if (length > size - 4 - position) break;
+            
+            isApplied = fseek(file, offset, SEEK_SET) == 0
+                && fwrite(bytes + position, 1, length, file) == length;
+            position += length;
+        }
+        isApplied = fsync_file(file) && isApplied;
+        fclose(file);
+    }
+    mapfile_close(&journal);
+    
+    // a valid journal which couldn't be applied is kept for the next try
+    if (!isValid || isApplied)
+    {
+        remove_utf8(journalFilename);
+    }
+}
+
+/** Writes a new file and makes sure it's on the storage device */
+bool diskimg_writeFile(const char *filename, const uint8_t *data, size_t size)
+{
+    FILE *file = fopen_utf8(filename, "wb");
+    if (!file) return false;
+    
+    bool success = fwrite(data, 1, size, file) == size && fsync_file(file);
+    fclose(file);
+    return success;
+}
+
+void diskimg_getSiblingFilename(char *outputString, const char *filename, const char *suffix)
+{
+    strncpy(outputString, filename, FILENAME_MAX - 1);
+    outputString[FILENAME_MAX - 1] = 0;
+    strncat(outputString, suffix, FILENAME_MAX - strlen(outputString) - 1);
+}
+
+void diskimg_writeInt(uint8_t *output, uint32_t value)
+{
+    output[0] = value;
+    output[1] = value >> 8;
+    output[2] = value >> 16;
+    output[3] = value >> 24;
+}
+
+uint32_t diskimg_readInt(const uint8_t *input)
+{
+    return input[0] | (input[1] << 8) | (input[2] << 16) | ((uint32_t)input[3] << 24);
+}
+
+uint32_t diskimg_getChecksum(const uint8_t *data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
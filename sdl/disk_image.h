@@ -0,0 +1,47 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef disk_image_h
+#define disk_image_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "core.h"
+
+// Binary disk images next to the text disk files. Saving an entry only writes the changed parts,
+// which are journaled first, so a crash leaves either the old or the new disk.
+
+/** Identifies a version of the text disk file, the image header keeps the one it was made from or exported to */
+struct DiskStamp {
+    int64_t size;
+    int64_t seconds;
+    int32_t nanoseconds;
+};
+
+void diskimg_getFilename(char *outputString, const char *diskFilename);
+bool diskimg_getDiskStamp(const char *diskFilename, struct DiskStamp *stamp);
+bool diskimg_isUpToDate(const char *filename, const char *diskFilename);
+struct CoreError diskimg_load(struct DataManager *manager, const char *filename);
+bool diskimg_save(struct DataManager *manager, const char *filename, const struct DiskStamp *stamp);
+bool diskimg_saveChanges(struct DataManager *manager, const char *filename, const char *diskFilename);
+bool diskimg_setDiskStamp(const char *filename, const struct DiskStamp *stamp);
+
+#endif /* disk_image_h */
@@ -0,0 +1,165 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "disk_loader.h"
+#include "disk_image.h"
+#include "mapped_file.h"
+#include <stdlib.h>
+#include <string.h>
+
+int diskloader_run(void *data);
+void diskloader_wait(struct DiskLoader *loader);
+
+
+void diskloader_init(struct DiskLoader *loader)
+{
+    memset(loader, 0, sizeof(struct DiskLoader));
+    loader->mutex = SDL_CreateMutex();
+    if (!loader->mutex) exit(EXIT_FAILURE);
+    
+    loader->dataManager.data = calloc(1, DATA_SIZE);
+    if (!loader->dataManager.data) exit(EXIT_FAILURE);
+    
+    data_init(&loader->dataManager);
+}
+
+void diskloader_deinit(struct DiskLoader *loader)
+{
+    diskloader_cancel(loader);
+    
+    data_deinit(&loader->dataManager);
+    free(loader->dataManager.data);
+    loader->dataManager.data = NULL;
+    
+    SDL_DestroyMutex(loader->mutex);
+    loader->mutex = NULL;
+}
+
+void diskloader_start(struct DiskLoader *loader, const char *diskFilename, bool usesBinaryDisk)
+{
+    diskloader_cancel(loader);
+    
+    strncpy(loader->diskFilename, diskFilename, FILENAME_MAX - 1);
+    loader->usesBinaryDisk = usesBinaryDisk;
+    loader->error = err_noCoreError();
+    data_reset(&loader->dataManager);
+    
+    loader->isLoading = true;
+    loader->isFinished = false;
+    loader->thread = SDL_CreateThread(diskloader_run, "Disk Loader", loader);
+    if (!loader->thread)
+    {
+        // load without thread
+        diskloader_run(loader);
+    }
+}
+
+bool diskloader_isLoading(struct DiskLoader *loader)
+{
+    return loader->isLoading;
+}
+
+bool diskloader_isFinished(struct DiskLoader *loader)
+{
+    SDL_LockMutex(loader->mutex);
+    bool isFinished = loader->isFinished;
+    SDL_UnlockMutex(loader->mutex);
+    return isFinished;
+}
+
+struct CoreError diskloader_finish(struct DiskLoader *loader, struct DataManager *destination)
+{
+    diskloader_wait(loader);
+    
+    struct DataManager *source = &loader->dataManager;
+    memcpy(destination->entries, source->entries, sizeof(struct DataEntry) * MAX_ENTRIES);
+    memcpy(destination->data, source->data, DATA_SIZE);
+    
+    // the source code is moved
+    const char *diskSourceCode = destination->diskSourceCode;
+    destination->diskSourceCode = source->diskSourceCode;
+    source->diskSourceCode = diskSourceCode;
+    data_clearChanges(destination);
+    
+    return loader->error;
+}
+
+void diskloader_cancel(struct DiskLoader *loader)
+{
+    diskloader_wait(loader);
+}
+
+struct CoreError diskloader_load(struct DataManager *destination, const char *diskFilename, bool usesBinaryDisk)
+{
+    struct CoreError error = err_noCoreError();
+    char imageFilename[FILENAME_MAX];
+    diskimg_getFilename(imageFilename, diskFilename);
+    
+    if (usesBinaryDisk && diskimg_isUpToDate(imageFilename, diskFilename))
+    {
+        error = diskimg_load(destination, imageFilename);
+        if (error.code == ErrorNone) return error;
+    }
+    
+    // taken before reading, so a change while reading is noticed next time
+    struct DiskStamp stamp;
+    diskimg_getDiskStamp(diskFilename, &stamp);
+    
+    struct MappedFile file;
+    if (mapfile_open(&file, diskFilename))
+    {
+        struct CoreError importError = data_import(destination, file.data, true);
+        mapfile_close(&file);
+        
+        if (error.code == ErrorNone)
+        {
+            error = importError;
+        }
+    }
+    
+    if (usesBinaryDisk)
+    {
+        // new or changed text disk
+        diskimg_save(destination, imageFilename, &stamp);
+    }
+    return error;
+}
+
+int diskloader_run(void *data)
+{
+    struct DiskLoader *loader = data;
+    struct CoreError error = diskloader_load(&loader->dataManager, loader->diskFilename, loader->usesBinaryDisk);
+    
+    SDL_LockMutex(loader->mutex);
+    loader->error = error;
+    loader->isFinished = true;
+    SDL_UnlockMutex(loader->mutex);
+    return 0;
+}
+
+void diskloader_wait(struct DiskLoader *loader)
+{
+    if (loader->thread)
+    {
+        SDL_WaitThread(loader->thread, NULL);
+        loader->thread = NULL;
+    }
+    loader->isLoading = false;
+}
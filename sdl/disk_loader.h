@@ -0,0 +1,59 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef disk_loader_h
+#define disk_loader_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "core.h"
+#include "sdl_include.h"
+
+/** Reads and parses a disk file on its own thread, so the program keeps running while it waits */
+struct DiskLoader {
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    bool isLoading;
+    bool isFinished;
+    
+    // used by the thread while loading
+    char diskFilename[FILENAME_MAX];
+    bool usesBinaryDisk;
+    struct DataManager dataManager;
+    struct CoreError error;
+};
+
+void diskloader_init(struct DiskLoader *loader);
+void diskloader_deinit(struct DiskLoader *loader);
+
+void diskloader_start(struct DiskLoader *loader, const char *diskFilename, bool usesBinaryDisk);
+bool diskloader_isLoading(struct DiskLoader *loader);
+bool diskloader_isFinished(struct DiskLoader *loader);
+
+/** Waits for the thread and moves the loaded disk to the destination */
+struct CoreError diskloader_finish(struct DiskLoader *loader, struct DataManager *destination);
+
+/** Waits for the thread and discards the loaded disk */
+void diskloader_cancel(struct DiskLoader *loader);
+
+/** Reads a disk file, or its binary image if it's up to date. The destination stays empty if there is no disk yet. */
+struct CoreError diskloader_load(struct DataManager *destination, const char *diskFilename, bool usesBinaryDisk);
+
+#endif /* disk_loader_h */
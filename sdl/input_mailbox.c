@@ -0,0 +1,136 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "input_mailbox.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool mailbox_isRepeatedEvent(SDL_Event *previous, SDL_Event *event);
+
+
+void mailbox_init(struct InputMailbox *mailbox)
+{
+    memset(mailbox, 0, sizeof(struct InputMailbox));
+    mailbox->mutex = SDL_CreateMutex();
+    mailbox->maxEvents = MAILBOX_INITIAL_EVENTS;
+    mailbox->events = malloc(mailbox->maxEvents * sizeof(SDL_Event));
+    mailbox->maxReceivedEvents = MAILBOX_INITIAL_EVENTS;
+    mailbox->receivedEvents = malloc(mailbox->maxReceivedEvents * sizeof(SDL_Event));
+    if (!mailbox->mutex || !mailbox->events || !mailbox->receivedEvents) exit(EXIT_FAILURE);
+}
+
+void mailbox_deinit(struct InputMailbox *mailbox)
+{
+    for (int i = 0; i < mailbox->numEvents; i++)
+    {
+        if (mailbox->events[i].type == SDL_DROPFILE)
+        {
+            SDL_free(mailbox->events[i].drop.file);
+        }
+    }
+    mailbox->numEvents = 0;
+    free(mailbox->events);
+    mailbox->events = NULL;
+    free(mailbox->receivedEvents);
+    mailbox->receivedEvents = NULL;
+    SDL_DestroyMutex(mailbox->mutex);
+    mailbox->mutex = NULL;
+}
+
+void mailbox_postEvent(struct InputMailbox *mailbox, SDL_Event *event)
+{
+    SDL_LockMutex(mailbox->mutex);
+    if (mailbox->numEvents > 0 && mailbox_isRepeatedEvent(&mailbox->events[mailbox->numEvents - 1], event))
+    {
+        mailbox->events[mailbox->numEvents - 1] = *event;
+    }
+    else
+    {
+        // the emulation thread may be busy for a while, keys and text must not get lost
+        if (mailbox->numEvents == mailbox->maxEvents)
+        {
+            mailbox->maxEvents *= 2;
+            mailbox->events = realloc(mailbox->events, mailbox->maxEvents * sizeof(SDL_Event));
+            if (!mailbox->events) exit(EXIT_FAILURE);
+        }
+        mailbox->events[mailbox->numEvents++] = *event;
+    }
+    SDL_UnlockMutex(mailbox->mutex);
+}
+
+void mailbox_postInput(struct InputMailbox *mailbox, struct HostInput *input)
+{
+    SDL_LockMutex(mailbox->mutex);
+    mailbox->input = *input;
+    SDL_UnlockMutex(mailbox->mutex);
+}
+
+void mailbox_postQuit(struct InputMailbox *mailbox)
+{
+    SDL_LockMutex(mailbox->mutex);
+    mailbox->quit = true;
+    SDL_UnlockMutex(mailbox->mutex);
+}
+
+int mailbox_receive(struct InputMailbox *mailbox, SDL_Event **events, struct HostInput *input)
+{
+    SDL_LockMutex(mailbox->mutex);
+    int numEvents = mailbox->numEvents;
+    
+    // swap queues, the received events stay untouched until the next call
+    SDL_Event *receivedEvents = mailbox->events;
+    int maxReceivedEvents = mailbox->maxEvents;
+    mailbox->events = mailbox->receivedEvents;
+    mailbox->maxEvents = mailbox->maxReceivedEvents;
+    mailbox->receivedEvents = receivedEvents;
+    mailbox->maxReceivedEvents = maxReceivedEvents;
+    mailbox->numEvents = 0;
+    
+    *input = mailbox->input;
+    SDL_UnlockMutex(mailbox->mutex);
+    *events = receivedEvents;
+    return numEvents;
+}
+
+bool mailbox_shouldQuit(struct InputMailbox *mailbox)
+{
+    SDL_LockMutex(mailbox->mutex);
+    bool quit = mailbox->quit;
+    SDL_UnlockMutex(mailbox->mutex);
+    return quit;
+}
+
+bool mailbox_isRepeatedEvent(SDL_Event *previous, SDL_Event *event)
+{
+    if (previous->type != event->type) return false;
+    
+    switch (event->type)
+    {
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            return true;
+            
+        case SDL_JOYBUTTONDOWN:
+            return previous->jbutton.which == event->jbutton.which && previous->jbutton.button == event->jbutton.button;
+            
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,65 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef input_mailbox_h
+#define input_mailbox_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "core.h"
+#include "sdl_include.h"
+
+#define MAILBOX_INITIAL_EVENTS 64
+
+/** Input state polled by the main thread, the latest one replaces older ones */
+struct HostInput {
+    struct CoreInputGamepad gamepads[2];
+    int touchX;
+    int touchY;
+    bool fastForward;
+    bool rewind;
+    double displayRate;
+};
+
+/** Passes input from the main thread to the emulation thread */
+struct InputMailbox {
+    SDL_mutex *mutex;
+    SDL_Event *events;
+    int numEvents;
+    int maxEvents;
+    SDL_Event *receivedEvents;
+    int maxReceivedEvents;
+    struct HostInput input;
+    bool quit;
+};
+
+void mailbox_init(struct InputMailbox *mailbox);
+void mailbox_deinit(struct InputMailbox *mailbox);
+
+/** Queues an event for the emulation thread, a repeated mouse or joystick button event replaces the previous one */
+void mailbox_postEvent(struct InputMailbox *mailbox, SDL_Event *event);
+void mailbox_postInput(struct InputMailbox *mailbox, struct HostInput *input);
+void mailbox_postQuit(struct InputMailbox *mailbox);
+
+/** Takes all queued events and the latest input, returns the number of events. The events stay valid until the next call. */
+int mailbox_receive(struct InputMailbox *mailbox, SDL_Event **events, struct HostInput *input);
+bool mailbox_shouldQuit(struct InputMailbox *mailbox);
+
+#endif /* input_mailbox_h */
@@ -28,6 +28,9 @@
 #include "system_paths.h"
 #include "utils.h"
 #include "boot_intro.h"
+#include "pacer.h"
+#include "triple_buffer.h"
+#include "input_mailbox.h"
 #include "sdl_include.h"
 
 #if SCREENSHOTS
@@ -39,11 +42,16 @@
 #endif
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 const char *defaultDisk = "Disk.nx";
 const int defaultWindowScale = 4;
 const int joyAxisThreshold = 16384;
+const int fastForwardMaxFrames = 1000;
+const int fastForwardMilliseconds = 12;
+const int maxPresentWaitMilliseconds = 17;
+const int maxReadWaitMilliseconds = 100;
 
 const int keyboardControls[2][2][8] = {
     // mapping 0
@@ -65,6 +73,12 @@ const int keyboardControls[2][2][8] = {
 };
 
 void update(void *arg);
+void pollEvents(void);
+void handleHostEvent(SDL_UserEvent *event);
+void pushHostEvent(enum HostEvent code);
+void emulateFrame(void);
+void presentFrame(void);
+int emulationThread(void *data);
 void updateScreenRect(int winW, int winH);
 void configureJoysticks(void);
 void closeJoysticks(void);
@@ -73,6 +87,12 @@ void toggleZoom(void);
 void changeVolume(int delta);
 void audioCallback(void *userdata, Uint8 *stream, int len);
 void saveScreenshot(void *pixels, int scale);
+void toggleProfiler(void);
+void toggleTracer(void);
+bool writeTrace(void);
+void getOutputFilename(char *outputString, const char *suffix);
+void getProgramOutputFilename(char *outputString, const char *programFilename, const char *suffix);
+void runFastForwardFrames(void);
 
 #ifdef __EMSCRIPTEN__
 void onloaded(const char *filename);
@@ -92,6 +112,13 @@ struct DevMenu devMenu;
 #endif
 struct Settings settings;
 struct CoreInput coreInput;
+struct Pacer pacer;
+struct Pacer displayPacer;
+struct TripleBuffer tripleBuffer;
+struct InputMailbox mailbox;
+struct HostInput hostInput;
+SDL_mutex *presentMutex = NULL;
+Uint32 hostEventType = 0;
 
 enum MainState mainState = MainStateUndefined;
 char mainProgramFilename[FILENAME_MAX] = "";
@@ -107,6 +134,8 @@ int messageNumber = 0;
 bool hasUsedInputLastUpdate = false;
 int screenshotRequestedWithScale = 0;
 int volume = 0; // 0 = max, it's a bit shift
+bool fastForward = false;
+bool forcePresent = false;
 
 int main(int argc, const char * argv[])
 {
@@ -114,12 +143,23 @@ int main(int argc, const char * argv[])
     
     settings_init(&settings, mainProgramFilename, argc, argv);
     runner_init(&runner);
+#ifndef __EMSCRIPTEN__
+    ramwriter_setInterval(&runner.ramWriter, settings.session.ramsaveinterval);
+#endif
 #if DEV_MENU
-    dev_init(&devMenu, &runner, &settings);
+    dev_init(&devMenu, &runner, &settings, &pacer);
 #endif
     
     if (runner_isOkay(&runner))
     {
+        if (settings.session.trace)
+        {
+            core_setTracing(runner.core, true);
+        }
+#if HOT_KEYS
+        core_setRewind(runner.core, REWIND_DEFAULT_BUFFER_SIZE);
+#endif
+        
         SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK);
         
         SDL_EventState(SDL_DROPFILE, SDL_ENABLE);
@@ -148,6 +188,15 @@ int main(int argc, const char * argv[])
         renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
         texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
         
+        pacer_init(&pacer);
+        pacer_init(&displayPacer);
+        
+        tribuf_init(&tripleBuffer, SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+        mailbox_init(&mailbox);
+        presentMutex = SDL_CreateMutex();
+        if (!presentMutex) exit(EXIT_FAILURE);
+        hostEventType = SDL_RegisterEvents(1);
+        
         SDL_AudioSpec desiredAudioSpec = {
             .freq = 44100,
             .format = AUDIO_S16,
@@ -178,24 +227,26 @@ int main(int argc, const char * argv[])
 #ifdef __EMSCRIPTEN__
         emscripten_set_main_loop_arg(update, NULL, -1, true);
 #else
+        SDL_Thread *thread = SDL_CreateThread(emulationThread, "Emulation", NULL);
+        if (!thread) exit(EXIT_FAILURE);
+        
         while (!quit)
         {
-            Uint32 ticks = SDL_GetTicks();
-            
-            update(NULL);
+            pollEvents();
+            presentFrame();
             
-            if (!settings.session.disabledelay || runner.core->machineInternals->isEnergySaving)
-            {
-                // limit to 60 FPS
-                Uint32 ticksDelta = SDL_GetTicks() - ticks;
-                if (ticksDelta < 16)
-                {
-                    SDL_Delay(16 - ticksDelta);
-                }
-            }
+            // vsync or the emulation thread limits presenting
+            tribuf_waitForFrame(&tripleBuffer, maxPresentWaitMilliseconds);
         }
         
+        mailbox_postQuit(&mailbox);
+        SDL_WaitThread(thread, NULL);
+        
         core_willSuspendProgram(runner.core);
+        
+        SDL_DestroyMutex(presentMutex);
+        mailbox_deinit(&mailbox);
+        tribuf_deinit(&tripleBuffer);
 #endif
     }
     
@@ -203,6 +254,11 @@ int main(int argc, const char * argv[])
     
     SDL_CloseAudioDevice(audioDevice);
     
+    if (core_isTracing(runner.core))
+    {
+        writeTrace();
+    }
+    
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
@@ -315,6 +371,16 @@ bool usesMainProgramAsDisk()
     return (mainState == MainStateRunningTool);
 }
 
+/** Tools keep editing the program file itself */
+bool usesBinaryDisk()
+{
+#ifdef __EMSCRIPTEN__
+    return false;
+#else
+    return settings.session.binarydisk && !usesMainProgramAsDisk();
+#endif
+}
+
 void getDiskFilename(char *outputString)
 {
     if (usesMainProgramAsDisk())
@@ -382,22 +448,25 @@ void updateMouseMode()
 
 void setMouseEnabled(bool enabled)
 {
-    mouseEnabled = enabled;
-    updateMouseMode();
+    pushHostEvent(enabled ? HostEventEnableMouse : HostEventDisableMouse);
+}
+
+void setTextInputEnabled(bool enabled)
+{
+    pushHostEvent(enabled ? HostEventStartTextInput : HostEventStopTextInput);
 }
 
 void update(void *arg)
+{
+    pollEvents();
+    emulateFrame();
+    presentFrame();
+}
+
+/** Handles window events on the main thread and passes input on to the emulation thread */
+void pollEvents()
 {
     SDL_Event event;
-    bool hasInput = false;
-    bool forceRender = false;
-    
-    if (releasedTouch)
-    {
-        coreInput.touch = false;
-        releasedTouch = false;
-    }
-    
     while (SDL_PollEvent(&event))
     {
         switch (event.type)
@@ -411,12 +480,173 @@ void update(void *arg)
                 {
                     case SDL_WINDOWEVENT_RESIZED: {
                         updateScreenRect(event.window.data1, event.window.data2);
-                        forceRender = true;
+                        forcePresent = true;
                         break;
                     }
                 }
                 break;
             
+            case SDL_DROPFILE: {
+                mailbox_postEvent(&mailbox, &event);
+                break;
+            }
+            
+            case SDL_MOUSEBUTTONDOWN: {
+                setTouchPosition(event.button.x, event.button.y);
+                mailbox_postEvent(&mailbox, &event);
+                break;
+            }
+                
+            case SDL_MOUSEMOTION: {
+                setTouchPosition(event.motion.x, event.motion.y);
+                break;
+            }
+                
+            case SDL_JOYDEVICEADDED:
+            case SDL_JOYDEVICEREMOVED: {
+                configureJoysticks();
+                break;
+            }
+                
+            case SDL_KEYDOWN:
+            case SDL_TEXTINPUT:
+            case SDL_MOUSEBUTTONUP:
+            case SDL_JOYBUTTONDOWN: {
+                mailbox_postEvent(&mailbox, &event);
+                break;
+            }
+            
+            default: {
+                if (event.type == hostEventType)
+                {
+                    handleHostEvent(&event.user);
+                }
+                break;
+            }
+        }
+    }
+    
+    const Uint8 *state = SDL_GetKeyboardState(NULL);
+#if HOT_KEYS
+    hostInput.fastForward = settings.session.fastforward || state[SDL_SCANCODE_GRAVE];
+    hostInput.rewind = (SDL_GetModState() & KMOD_CTRL) && state[SDL_SCANCODE_BACKSPACE];
+#else
+    hostInput.fastForward = settings.session.fastforward;
+#endif
+    for (int i = 0; i < 2; i++)
+    {
+        struct CoreInputGamepad *gamepad = &hostInput.gamepads[i];
+        if (i < numJoysticks)
+        {
+            SDL_Joystick *joy = joysticks[i];
+            Uint8 hat = SDL_JoystickGetHat(joy, 0);
+            Sint16 axisX = SDL_JoystickGetAxis(joy, 0);
+            Sint16 axisY = SDL_JoystickGetAxis(joy, 1);
+            gamepad->up = (hat & SDL_HAT_UP) != 0 || axisY < -joyAxisThreshold;
+            gamepad->down = (hat & SDL_HAT_DOWN) != 0 || axisY > joyAxisThreshold;
+            gamepad->left = (hat & SDL_HAT_LEFT) != 0 || axisX < -joyAxisThreshold;
+            gamepad->right = (hat & SDL_HAT_RIGHT) != 0 || axisX > joyAxisThreshold;
+            gamepad->buttonA = SDL_JoystickGetButton(joy, 0);
+            gamepad->buttonB = SDL_JoystickGetButton(joy, 1);
+        }
+        else
+        {
+            int ci = i - numJoysticks;
+            int m = settings.session.mapping;
+            gamepad->up = state[keyboardControls[m][ci][0]];
+            gamepad->down = state[keyboardControls[m][ci][1]];
+            gamepad->left = state[keyboardControls[m][ci][2]];
+            gamepad->right = state[keyboardControls[m][ci][3]];
+            gamepad->buttonA = state[keyboardControls[m][ci][4]] || state[keyboardControls[m][ci][6]];
+            gamepad->buttonB = state[keyboardControls[m][ci][5]] || state[keyboardControls[m][ci][7]];
+        }
+    }
+    
+    hostInput.displayRate = displayPacer.displayRate;
+    mailbox_postInput(&mailbox, &hostInput);
+}
+
+/** Handles requests of the emulation thread, which mustn't use the window */
+void handleHostEvent(SDL_UserEvent *event)
+{
+    switch (event->code)
+    {
+        case HostEventQuit:
+            quit = true;
+            break;
+            
+        case HostEventToggleFullscreen: {
+            if (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN_DESKTOP)
+            {
+                SDL_SetWindowFullscreen(window, 0);
+            }
+            else
+            {
+                SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
+            }
+            updateMouseMode();
+            forcePresent = true;
+            break;
+        }
+            
+        case HostEventToggleZoom:
+            toggleZoom();
+            forcePresent = true;
+            break;
+            
+        case HostEventEnableMouse:
+        case HostEventDisableMouse:
+            mouseEnabled = (event->code == HostEventEnableMouse);
+            updateMouseMode();
+            break;
+            
+        case HostEventStartTextInput:
+            if (!SDL_IsTextInputActive())
+            {
+                SDL_StartTextInput();
+            }
+            break;
+            
+        case HostEventStopTextInput:
+            if (SDL_IsTextInputActive())
+            {
+                SDL_StopTextInput();
+            }
+            break;
+    }
+}
+
+void pushHostEvent(enum HostEvent code)
+{
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = hostEventType;
+    event.user.code = code;
+    SDL_PushEvent(&event);
+}
+
+/** Runs one frame on the emulation thread with the input passed by the main thread */
+void emulateFrame()
+{
+    SDL_Event *events;
+    struct HostInput input;
+    int numEvents = mailbox_receive(&mailbox, &events, &input);
+    bool hasInput = false;
+    bool forceRender = false;
+    
+    if (releasedTouch)
+    {
+        coreInput.touch = false;
+        releasedTouch = false;
+    }
+    coreInput.touchX = input.touchX;
+    coreInput.touchY = input.touchY;
+    
+    for (int i = 0; i < numEvents; i++)
+    {
+        SDL_Event event = events[i];
+        switch (event.type)
+        {
             case SDL_DROPFILE: {
                 if (hasPostfix(event.drop.file, ".nx") || hasPostfix(event.drop.file, ".NX"))
                 {
@@ -498,16 +728,7 @@ void update(void *arg)
                     }
                     else if (keycode == SDLK_f)
                     {
-                        if (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN_DESKTOP)
-                        {
-                            SDL_SetWindowFullscreen(window, 0);
-                        }
-                        else
-                        {
-                            SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
-                        }
-                        updateMouseMode();
-                        forceRender = true;
+                        pushHostEvent(HostEventToggleFullscreen);
                     }
                     else if (keycode == SDLK_r)
                     {
@@ -528,8 +749,7 @@ void update(void *arg)
                     }
                     else if (keycode == SDLK_z)
                     {
-                        toggleZoom();
-                        forceRender = true;
+                        pushHostEvent(HostEventToggleZoom);
                     }
                     else if (keycode == SDLK_PLUS)
                     {
@@ -539,12 +759,20 @@ void update(void *arg)
                     {
                         changeVolume(+1);
                     }
+                    else if (keycode == SDLK_l)
+                    {
+                        toggleProfiler();
+                    }
+                    else if (keycode == SDLK_t)
+                    {
+                        toggleTracer();
+                    }
                 }
                 else if (keycode == SDLK_ESCAPE)
                 {
                     if (settings.session.disabledev)
                     {
-                        quit = true;
+                        pushHostEvent(HostEventQuit);
                     }
 #if DEV_MENU
                     else if (hasProgram())
@@ -560,8 +788,7 @@ void update(void *arg)
                 {
                     if (keycode == SDLK_SPACE)
                     {
-                        toggleZoom();
-                        forceRender = true;
+                        pushHostEvent(HostEventToggleZoom);
                         hasInput = false;
                     }
                     else if (scancode == SDL_SCANCODE_KP_PLUS)
@@ -593,7 +820,6 @@ void update(void *arg)
             
             case SDL_MOUSEBUTTONDOWN: {
                 hasInput = true;
-                setTouchPosition(event.button.x, event.button.y);
                 coreInput.touch = true;
                 break;
             }
@@ -603,17 +829,6 @@ void update(void *arg)
                 break;
             }
                 
-            case SDL_MOUSEMOTION: {
-                setTouchPosition(event.motion.x, event.motion.y);
-                break;
-            }
-                
-            case SDL_JOYDEVICEADDED:
-            case SDL_JOYDEVICEREMOVED: {
-                configureJoysticks();
-                break;
-            }
-                
             case SDL_JOYBUTTONDOWN: {
                 hasInput = true;
                 if (event.jbutton.button == 2)
@@ -625,35 +840,12 @@ void update(void *arg)
         }
     }
     
-    const Uint8 *state = SDL_GetKeyboardState(NULL);
-    for (int i = 0; i < 2; i++)
-    {
-        struct CoreInputGamepad *gamepad = &coreInput.gamepads[i];
-        if (i < numJoysticks)
-        {
-            SDL_Joystick *joy = joysticks[i];
-            Uint8 hat = SDL_JoystickGetHat(joy, 0);
-            Sint16 axisX = SDL_JoystickGetAxis(joy, 0);
-            Sint16 axisY = SDL_JoystickGetAxis(joy, 1);
-            gamepad->up = (hat & SDL_HAT_UP) != 0 || axisY < -joyAxisThreshold;
-            gamepad->down = (hat & SDL_HAT_DOWN) != 0 || axisY > joyAxisThreshold;
-            gamepad->left = (hat & SDL_HAT_LEFT) != 0 || axisX < -joyAxisThreshold;
-            gamepad->right = (hat & SDL_HAT_RIGHT) != 0 || axisX > joyAxisThreshold;
-            gamepad->buttonA = SDL_JoystickGetButton(joy, 0);
-            gamepad->buttonB = SDL_JoystickGetButton(joy, 1);
-        }
-        else
-        {
-            int ci = i - numJoysticks;
-            int m = settings.session.mapping;
-            gamepad->up = state[keyboardControls[m][ci][0]];
-            gamepad->down = state[keyboardControls[m][ci][1]];
-            gamepad->left = state[keyboardControls[m][ci][2]];
-            gamepad->right = state[keyboardControls[m][ci][3]];
-            gamepad->buttonA = state[keyboardControls[m][ci][4]] || state[keyboardControls[m][ci][6]];
-            gamepad->buttonB = state[keyboardControls[m][ci][5]] || state[keyboardControls[m][ci][7]];
-        }
-    }
+    fastForward = input.fastForward;
+    coreInput.gamepads[0] = input.gamepads[0];
+    coreInput.gamepads[1] = input.gamepads[1];
+#if DEV_MENU
+    devMenu.displayRate = input.displayRate;
+#endif
     
     switch (mainState)
     {
@@ -680,7 +872,26 @@ void update(void *arg)
             
         case MainStateRunningProgram:
         case MainStateRunningTool:
+#if HOT_KEYS
+            if (input.rewind)
+            {
+                // steps back one frame per update while held
+                coreInput.key = 0;
+                SDL_LockAudioDevice(audioDevice);
+                bool rewound = core_rewindFrame(runner.core);
+                SDL_UnlockAudioDevice(audioDevice);
+                overlay_message(runner.core, rewound ? "REWIND" : "REWIND END");
+                break;
+            }
+#endif
+            runner_update(&runner);
+            if (fastForward)
+            {
+                runFastForwardFrames();
+            }
             core_update(runner.core, &coreInput);
+            core_saveRewindFrame(runner.core);
+            core_savePersistentRam(runner.core);
             if (hasInput)
             {
                 if (runner.core->interpreter->state == StateEnd)
@@ -739,12 +950,8 @@ void update(void *arg)
     
     if (core_shouldRender(runner.core) || forceRender)
     {
-        SDL_RenderClear(renderer);
-        
-        void *pixels = NULL;
-        int pitch = 0;
-        SDL_LockTexture(texture, NULL, &pixels, &pitch);
-        
+        trace_begin(runner.core, TraceThreadMain, "Render");
+        void *pixels = tribuf_getWriteBuffer(&tripleBuffer);
         video_renderScreen(runner.core, pixels);
         
         if (screenshotRequestedWithScale > 0)
@@ -753,11 +960,51 @@ void update(void *arg)
             screenshotRequestedWithScale = 0;
         }
         
-        SDL_UnlockTexture(texture);
+        tribuf_publish(&tripleBuffer);
+        trace_end(runner.core, TraceThreadMain, "Render");
+    }
+}
+
+/** Shows the latest frame of the emulation thread */
+void presentFrame()
+{
+    void *pixels = tribuf_getNewFrame(&tripleBuffer);
+    if (pixels || forcePresent)
+    {
+        // tracing isn't stopped while presenting
+        SDL_LockMutex(presentMutex);
+        trace_begin(runner.core, TraceThreadPresent, "Present");
+        if (pixels)
+        {
+            SDL_UpdateTexture(texture, NULL, pixels, SCREEN_WIDTH * 4);
+        }
+        SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, texture, NULL, &screenRect);
-        
         SDL_RenderPresent(renderer);
+        pacer_didPresent(&displayPacer);
+        trace_end(runner.core, TraceThreadPresent, "Present");
+        SDL_UnlockMutex(presentMutex);
+        forcePresent = false;
+    }
+}
+
+/** Runs the program independent of presenting, which can block until vsync */
+int emulationThread(void *data)
+{
+    while (!mailbox_shouldQuit(&mailbox))
+    {
+        emulateFrame();
+        
+        // limit to 60 FPS
+        bool limitRate = !fastForward && (!settings.session.disabledelay || runner.core->machineInternals->isEnergySaving);
+        if (!limitRate && !fastForward)
+        {
+            // presenting limits the frame rate instead
+            tribuf_waitForRead(&tripleBuffer, maxReadWaitMilliseconds);
+        }
+        pacer_endFrame(&pacer, limitRate);
     }
+    return 0;
 }
 
 void updateScreenRect(int winW, int winH)
@@ -835,8 +1082,8 @@ void closeJoysticks() {
 
 void setTouchPosition(int windowX, int windowY)
 {
-    coreInput.touchX = (windowX - screenRect.x) * SCREEN_WIDTH / screenRect.w;
-    coreInput.touchY = (windowY - screenRect.y) * SCREEN_HEIGHT / screenRect.h;
+    hostInput.touchX = (windowX - screenRect.x) * SCREEN_WIDTH / screenRect.w;
+    hostInput.touchY = (windowY - screenRect.y) * SCREEN_HEIGHT / screenRect.h;
 }
 
 void toggleZoom()
@@ -861,7 +1108,27 @@ void audioCallback(void *userdata, Uint8 *stream, int len)
 {
     int16_t *samples = (int16_t *)stream;
     int numSamples = len / NUM_CHANNELS;
+    trace_begin(userdata, TraceThreadAudio, "Audio Callback");
     audio_renderAudio(userdata, samples, numSamples, audioSpec.freq, volume);
+    if (fastForward)
+    {
+        // the sound of skipped frames would be chopped anyway
+        memset(stream, 0, len);
+    }
+    trace_end(userdata, TraceThreadAudio, "Audio Callback");
+}
+
+/** Runs frames without showing them, until the time of one displayed frame is used */
+void runFastForwardFrames()
+{
+    Uint64 startTime = SDL_GetPerformanceCounter();
+    Uint64 maxDuration = SDL_GetPerformanceFrequency() * fastForwardMilliseconds / 1000;
+    for (int i = 0; i < fastForwardMaxFrames && SDL_GetPerformanceCounter() - startTime < maxDuration; i++)
+    {
+        core_update(runner.core, &coreInput);
+        video_renderScreen(runner.core, NULL);
+        core_saveRewindFrame(runner.core);
+    }
 }
 
 void saveScreenshot(void *pixels, int scale)
@@ -879,6 +1146,135 @@ void saveScreenshot(void *pixels, int scale)
 #endif
 }
 
+void toggleProfiler()
+{
+    if (!core_isProfiling(runner.core))
+    {
+        core_setProfiling(runner.core, true);
+        overlay_message(runner.core, "PROFILER ON");
+        return;
+    }
+    
+    bool succeeded = false;
+    char filename[FILENAME_MAX];
+    getOutputFilename(filename, " profile");
+    if (filename[0])
+    {
+        size_t length = strlen(filename);
+        
+        strncat(filename, ".txt", FILENAME_MAX - length - 1);
+        FILE *file = fopen(filename, "w");
+        if (file)
+        {
+            prof_writeReport(runner.core, file);
+            fclose(file);
+            
+            filename[length] = 0;
+            strncat(filename, ".folded", FILENAME_MAX - length - 1);
+            file = fopen(filename, "w");
+            if (file)
+            {
+                prof_writeFoldedStacks(runner.core, file, false);
+                fclose(file);
+                succeeded = true;
+            }
+        }
+    }
+    
+    core_setProfiling(runner.core, false);
+    if (succeeded)
+    {
+        overlay_message(runner.core, "PROFILE SAVED");
+    }
+    else
+    {
+        overlay_message(runner.core, "PROFILE ERROR");
+    }
+}
+
+void toggleTracer()
+{
+    if (!core_isTracing(runner.core))
+    {
+        core_setTracing(runner.core, true);
+        overlay_message(runner.core, "TRACE ON");
+        return;
+    }
+    
+    // the audio callback and presenting add events, too
+    SDL_LockMutex(presentMutex);
+    SDL_LockAudioDevice(audioDevice);
+    bool succeeded = writeTrace();
+    core_setTracing(runner.core, false);
+    SDL_UnlockAudioDevice(audioDevice);
+    SDL_UnlockMutex(presentMutex);
+    
+    if (succeeded)
+    {
+        overlay_message(runner.core, "TRACE SAVED");
+    }
+    else
+    {
+        overlay_message(runner.core, "TRACE ERROR");
+    }
+}
+
+bool writeTrace()
+{
+    char filename[FILENAME_MAX];
+    getOutputFilename(filename, " trace.json");
+    if (filename[0])
+    {
+        FILE *file = fopen(filename, "w");
+        if (file)
+        {
+            trace_write(runner.core, file);
+            fclose(file);
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Creates a file name in the settings folder, based on the name of the current program */
+void getOutputFilename(char *outputString, const char *suffix)
+{
+    getProgramOutputFilename(outputString, mainProgramFilename, suffix);
+}
+
+/** Compiled programs are cached in the settings folder, one file per program name */
+void getCacheFilename(char *outputString, const char *programFilename)
+{
+    getProgramOutputFilename(outputString, programFilename, ".nxc");
+}
+
+void getProgramOutputFilename(char *outputString, const char *programFilename, const char *suffix)
+{
+    outputString[0] = 0;
+    char *prefPath = SDL_GetPrefPath("Inutilis Software", "LowRes NX");
+    if (prefPath)
+    {
+        strncpy(outputString, prefPath, FILENAME_MAX - 1);
+        SDL_free(prefPath);
+        size_t prefPathLength = strlen(outputString);
+        
+        const char *name = strrchr(programFilename, PATH_SEPARATOR_CHAR);
+        name = name ? name + 1 : programFilename;
+        if (!name[0])
+        {
+            name = "program";
+        }
+        strncat(outputString, name, FILENAME_MAX - strlen(outputString) - 1);
+        
+        char *postfix = strrchr(outputString, '.');
+        if (postfix && postfix > outputString + prefPathLength)
+        {
+            *postfix = 0;
+        }
+        strncat(outputString, suffix, FILENAME_MAX - strlen(outputString) - 1);
+    }
+}
+
 #ifdef __EMSCRIPTEN__
 
 void onloaded(const char *filename)
@@ -31,6 +31,17 @@ enum MainState {
     MainStateDevMenu,
 };
 
+/** Requests from the emulation thread to the main thread */
+enum HostEvent {
+    HostEventQuit,
+    HostEventToggleFullscreen,
+    HostEventToggleZoom,
+    HostEventEnableMouse,
+    HostEventDisableMouse,
+    HostEventStartTextInput,
+    HostEventStopTextInput,
+};
+
 enum Zoom {
     ZoomPixelPerfect,
     ZoomLarge,
@@ -47,8 +58,11 @@ void runMainProgram(void);
 void runToolProgram(const char *filename);
 void showDevMenu(void);
 bool usesMainProgramAsDisk(void);
+bool usesBinaryDisk(void);
 void getDiskFilename(char *outputString);
 void getRamFilename(char *outputString);
+void getCacheFilename(char *outputString, const char *programFilename);
 void setMouseEnabled(bool enabled);
+void setTextInputEnabled(bool enabled);
 
 #endif /* main_h */
@@ -0,0 +1,104 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "mapped_file.h"
+#include "system_paths.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+bool mapfile_read(struct MappedFile *file, const char *filename);
+
+
+bool mapfile_open(struct MappedFile *file, const char *filename)
+{
+    memset(file, 0, sizeof(struct MappedFile));
+    
+#if !defined(_WIN32)
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    
+    // a mapping is only terminated if the file doesn't fill its last page, the rest of which reads as zeros
+    struct stat fileStat;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0 && pageSize > 0 && fileStat.st_size % pageSize != 0)
+    {
+        void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            file->data = data;
+            file->size = fileStat.st_size;
+            file->isMapped = true;
+        }
+    }
+    close(fd);
+    if (file->isMapped) return true;
+#endif
+    
+    return mapfile_read(file, filename);
+}
+
+void mapfile_close(struct MappedFile *file)
+{
+    if (file->data)
+    {
+#if !defined(_WIN32)
+        if (file->isMapped)
+        {
+            munmap((void *)file->data, file->size);
+        }
+        else
+#endif
+        {
+            free((void *)file->data);
+        }
+    }
+    memset(file, 0, sizeof(struct MappedFile));
+}
+
+bool mapfile_read(struct MappedFile *file, const char *filename)
+{
+    FILE *stream = fopen_utf8(filename, "rb");
+    if (!stream) return false;
+    
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    
+    char *data = (size >= 0) ? malloc(size + 1) : NULL; // +1 for terminator
+    if (data && (size == 0 || fread(data, size, 1, stream) == 1))
+    {
+        data[size] = 0;
+        file->data = data;
+        file->size = size;
+    }
+    else
+    {
+        free(data);
+    }
+    fclose(stream);
+    return file->data != NULL;
+}
@@ -0,0 +1,38 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef mapped_file_h
+#define mapped_file_h
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Read-only file contents, memory-mapped where the system supports it, otherwise read into memory.
+// The data is always followed by a 0 byte, so text files can be read in place as strings.
+struct MappedFile {
+    const void *data;
+    size_t size;
+    bool isMapped;
+};
+
+bool mapfile_open(struct MappedFile *file, const char *filename);
+void mapfile_close(struct MappedFile *file);
+
+#endif /* mapped_file_h */
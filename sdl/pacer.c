@@ -0,0 +1,151 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "pacer.h"
+#include <math.h>
+#include <string.h>
+
+void pacer_measurePresent(struct Pacer *pacer, Uint64 interval);
+void pacer_addFrameTime(struct Pacer *pacer, Uint64 frameTime);
+
+void pacer_init(struct Pacer *pacer)
+{
+    memset(pacer, 0, sizeof(struct Pacer));
+    pacer->frequency = SDL_GetPerformanceFrequency();
+    pacer->nextFrameTime = SDL_GetPerformanceCounter();
+    pacer->lastFrameTime = pacer->nextFrameTime;
+}
+
+void pacer_didPresent(struct Pacer *pacer)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (pacer->lastPresentTime > 0)
+    {
+        pacer_measurePresent(pacer, now - pacer->lastPresentTime);
+    }
+    pacer->lastPresentTime = now;
+}
+
+void pacer_endFrame(struct Pacer *pacer, bool limitRate)
+{
+    Uint64 frequency = pacer->frequency;
+    Uint64 period = frequency / PACER_FRAME_RATE;
+    
+    // next due time, the remainder is accumulated so the rate doesn't drift
+    pacer->nextFrameTime += period;
+    pacer->fraction += frequency % PACER_FRAME_RATE;
+    if (pacer->fraction >= PACER_FRAME_RATE)
+    {
+        pacer->nextFrameTime++;
+        pacer->fraction -= PACER_FRAME_RATE;
+    }
+    
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (!limitRate || now > pacer->nextFrameTime + period)
+    {
+        // no waiting, or too late to catch up
+        pacer->nextFrameTime = now;
+        pacer->fraction = 0;
+    }
+    else if (now < pacer->nextFrameTime)
+    {
+        // SDL_Delay can oversleep, the last millisecond is waited actively
+        Uint32 milliseconds = (Uint32)((pacer->nextFrameTime - now) * 1000 / frequency);
+        if (milliseconds > 1)
+        {
+            SDL_Delay(milliseconds - 1);
+        }
+        while (SDL_GetPerformanceCounter() < pacer->nextFrameTime)
+        {
+        }
+    }
+    
+    now = SDL_GetPerformanceCounter();
+    pacer_addFrameTime(pacer, now - pacer->lastFrameTime);
+    pacer->lastFrameTime = now;
+}
+
+struct PacerStats pacer_getStats(struct Pacer *pacer)
+{
+    struct PacerStats stats;
+    memset(&stats, 0, sizeof(struct PacerStats));
+    
+    double toMilliseconds = 1000.0 / pacer->frequency;
+    int count = pacer->numFrameTimes;
+    if (count > 0)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            double frameTime = pacer->frameTimes[i] * toMilliseconds;
+            sum += frameTime;
+            if (frameTime > stats.maxFrameTime)
+            {
+                stats.maxFrameTime = frameTime;
+            }
+        }
+        stats.frameTime = sum / count;
+        
+        double squaredSum = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            double deviation = pacer->frameTimes[i] * toMilliseconds - stats.frameTime;
+            squaredSum += deviation * deviation;
+        }
+        stats.jitter = sqrt(squaredSum / count);
+    }
+    stats.displayRate = pacer->displayRate;
+    stats.numLateFrames = pacer->numLateFrames;
+    return stats;
+}
+
+void pacer_measurePresent(struct Pacer *pacer, Uint64 interval)
+{
+    if (interval > pacer->frequency / 10)
+    {
+        // no new frames for a while, for example in energy saving mode
+        return;
+    }
+    
+    pacer->presentIntervalSum += interval;
+    pacer->numPresentIntervals++;
+    if (pacer->numPresentIntervals == PACER_NUM_MEASURED_PRESENTS)
+    {
+        pacer->displayRate = (double)pacer->frequency * pacer->numPresentIntervals / pacer->presentIntervalSum;
+        pacer->presentIntervalSum = 0;
+        pacer->numPresentIntervals = 0;
+    }
+}
+
+void pacer_addFrameTime(struct Pacer *pacer, Uint64 frameTime)
+{
+    pacer->frameTimes[pacer->nextFrameTimeIndex] = frameTime;
+    pacer->nextFrameTimeIndex = (pacer->nextFrameTimeIndex + 1) % PACER_NUM_SAMPLES;
+    if (pacer->numFrameTimes < PACER_NUM_SAMPLES)
+    {
+        pacer->numFrameTimes++;
+    }
+    
+    // more than half a frame late
+    if (frameTime > pacer->frequency * 3 / (2 * PACER_FRAME_RATE))
+    {
+        pacer->numLateFrames++;
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef pacer_h
+#define pacer_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "sdl_include.h"
+
+#define PACER_FRAME_RATE 60
+#define PACER_NUM_SAMPLES 120
+#define PACER_NUM_MEASURED_PRESENTS 30
+
+struct PacerStats {
+    double frameTime; // average in ms
+    double jitter; // standard deviation in ms
+    double maxFrameTime;
+    double displayRate; // measured rate of presents, 0 if unknown
+    int numLateFrames;
+};
+
+/** Paces frames to exactly PACER_FRAME_RATE with the performance counter */
+struct Pacer {
+    Uint64 frequency;
+    Uint64 nextFrameTime;
+    Uint64 fraction; // accumulated remainder of frequency / PACER_FRAME_RATE
+    Uint64 lastFrameTime;
+    Uint64 lastPresentTime;
+    Uint64 presentIntervalSum;
+    int numPresentIntervals;
+    double displayRate;
+    Uint64 frameTimes[PACER_NUM_SAMPLES];
+    int numFrameTimes;
+    int nextFrameTimeIndex;
+    int numLateFrames;
+};
+
+void pacer_init(struct Pacer *pacer);
+
+/** Call after each SDL_RenderPresent to measure the display rate */
+void pacer_didPresent(struct Pacer *pacer);
+
+/** Call once per frame, waits until the next one is due if limitRate is set */
+void pacer_endFrame(struct Pacer *pacer, bool limitRate);
+
+struct PacerStats pacer_getStats(struct Pacer *pacer);
+
+#endif /* pacer_h */
@@ -0,0 +1,197 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "ram_writer.h"
+#include "system_paths.h"
+#include <stdlib.h>
+#include <string.h>
+
+int ramwriter_run(void *data);
+bool ramwriter_hasChangedPages(struct RamWriter *writer, const char *filename, const uint8_t *data, int size);
+bool ramwriter_write(const char *filename, const uint8_t *data, int size);
+
+void ramwriter_init(struct RamWriter *writer)
+{
+    memset(writer, 0, sizeof(struct RamWriter));
+    writer->interval = RAMWRITER_DEFAULT_INTERVAL;
+    writer->mutex = SDL_CreateMutex();
+    writer->condition = SDL_CreateCond();
+    if (!writer->mutex || !writer->condition) exit(EXIT_FAILURE);
+    
+    writer->thread = SDL_CreateThread(ramwriter_run, "RAM Writer", writer);
+    if (!writer->thread) exit(EXIT_FAILURE);
+}
+
+/** Writes pending changes before the thread ends */
+void ramwriter_deinit(struct RamWriter *writer)
+{
+    SDL_LockMutex(writer->mutex);
+    writer->quit = true;
+    SDL_CondBroadcast(writer->condition);
+    SDL_UnlockMutex(writer->mutex);
+    
+    SDL_WaitThread(writer->thread, NULL);
+    writer->thread = NULL;
+    SDL_DestroyCond(writer->condition);
+    writer->condition = NULL;
+    SDL_DestroyMutex(writer->mutex);
+    writer->mutex = NULL;
+}
+
+void ramwriter_setInterval(struct RamWriter *writer, int interval)
+{
+    SDL_LockMutex(writer->mutex);
+    writer->interval = interval;
+    SDL_CondBroadcast(writer->condition);
+    SDL_UnlockMutex(writer->mutex);
+}
+
+void ramwriter_submit(struct RamWriter *writer, const char *filename, const uint8_t *data, int size)
+{
+    if (size > PERSISTENT_RAM_SIZE) size = PERSISTENT_RAM_SIZE;
+    
+    SDL_LockMutex(writer->mutex);
+    if (writer->hasChanges && strcmp(writer->filename, filename) != 0)
+    {
+        // changes of another program aren't replaced
+        writer->isFlushing = true;
+        SDL_CondBroadcast(writer->condition);
+        while (writer->hasChanges)
+        {
+            SDL_CondWait(writer->condition, writer->mutex);
+        }
+        writer->isFlushing = false;
+    }
+    if (!writer->hasChanges)
+    {
+        writer->changeTime = SDL_GetTicks();
+        writer->hasChanges = true;
+    }
+    strncpy(writer->filename, filename, FILENAME_MAX - 1);
+    memcpy(writer->data, data, size);
+    writer->size = size;
+    SDL_CondBroadcast(writer->condition);
+    SDL_UnlockMutex(writer->mutex);
+}
+
+void ramwriter_flush(struct RamWriter *writer)
+{
+    SDL_LockMutex(writer->mutex);
+    writer->isFlushing = true;
+    SDL_CondBroadcast(writer->condition);
+    while (writer->hasChanges || writer->isWriting)
+    {
+        SDL_CondWait(writer->condition, writer->mutex);
+    }
+    writer->isFlushing = false;
+    SDL_UnlockMutex(writer->mutex);
+}
+
+bool ramwriter_takeFailure(struct RamWriter *writer)
+{
+    SDL_LockMutex(writer->mutex);
+    bool hasFailed = writer->hasFailed;
+    writer->hasFailed = false;
+    SDL_UnlockMutex(writer->mutex);
+    return hasFailed;
+}
+
+int ramwriter_run(void *data)
+{
+    struct RamWriter *writer = data;
+    char filename[FILENAME_MAX];
+    uint8_t ram[PERSISTENT_RAM_SIZE];
+    
+    SDL_LockMutex(writer->mutex);
+    while (!writer->quit || writer->hasChanges)
+    {
+        if (!writer->hasChanges)
+        {
+            SDL_CondWait(writer->condition, writer->mutex);
+            continue;
+        }
+        
+        // collect more changes until the interval is over
+        Uint32 elapsed = SDL_GetTicks() - writer->changeTime;
+        if (elapsed < (Uint32)writer->interval && !writer->quit && !writer->isFlushing)
+        {
+            SDL_CondWaitTimeout(writer->condition, writer->mutex, writer->interval - elapsed);
+            continue;
+        }
+        
+        strcpy(filename, writer->filename);
+        int size = writer->size;
+        memcpy(ram, writer->data, size);
+        writer->hasChanges = false;
+        writer->isWriting = true;
+        SDL_UnlockMutex(writer->mutex);
+        
+        bool success = true;
+        if (ramwriter_hasChangedPages(writer, filename, ram, size))
+        {
+            success = ramwriter_write(filename, ram, size);
+            if (success)
+            {
+                strcpy(writer->writtenFilename, filename);
+                memcpy(writer->writtenData, ram, size);
+                writer->writtenSize = size;
+            }
+        }
+        
+        SDL_LockMutex(writer->mutex);
+        writer->isWriting = false;
+        if (!success)
+        {
+            writer->hasFailed = true;
+        }
+        SDL_CondBroadcast(writer->condition);
+    }
+    SDL_UnlockMutex(writer->mutex);
+    return 0;
+}
+
+/** Compares page by page with the last written data, a program may change values and restore them */
+bool ramwriter_hasChangedPages(struct RamWriter *writer, const char *filename, const uint8_t *data, int size)
+{
+    if (size != writer->writtenSize || strcmp(filename, writer->writtenFilename) != 0) return true;
+    
+    for (int offset = 0; offset < size; offset += PERSISTENT_PAGE_SIZE)
+    {
+        int length = (size - offset < PERSISTENT_PAGE_SIZE) ? size - offset : PERSISTENT_PAGE_SIZE;
+        if (memcmp(data + offset, writer->writtenData + offset, length) != 0) return true;
+    }
+    return false;
+}
+
+/** Writes a temporary file and replaces the old one, so a crash never leaves an incomplete file */
+bool ramwriter_write(const char *filename, const uint8_t *data, int size)
+{
+    char tempFilename[FILENAME_MAX];
+    strncpy(tempFilename, filename, FILENAME_MAX - 1);
+    tempFilename[FILENAME_MAX - 1] = 0;
+    strncat(tempFilename, ".tmp", FILENAME_MAX - strlen(tempFilename) - 1);
+    
+    FILE *file = fopen_utf8(tempFilename, "wb");
+    if (!file) return false;
+    
+    bool success = fwrite(data, 1, size, file) == size && fsync_file(file);
+    fclose(file);
+    return success && rename_utf8(tempFilename, filename);
+}
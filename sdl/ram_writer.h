@@ -0,0 +1,68 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef ram_writer_h
+#define ram_writer_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "core.h"
+#include "sdl_include.h"
+
+#define RAMWRITER_DEFAULT_INTERVAL 1000
+
+/** Saves persistent RAM on its own thread. Changes are collected for the interval (milliseconds), so at most this much is lost. */
+struct RamWriter {
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *condition;
+    int interval;
+    
+    // latest changes, protected by the mutex
+    char filename[FILENAME_MAX];
+    uint8_t data[PERSISTENT_RAM_SIZE];
+    int size;
+    bool hasChanges;
+    Uint32 changeTime;
+    bool isWriting;
+    bool isFlushing;
+    bool hasFailed;
+    bool quit;
+    
+    // what the file contains, used by the thread only
+    char writtenFilename[FILENAME_MAX];
+    uint8_t writtenData[PERSISTENT_RAM_SIZE];
+    int writtenSize;
+};
+
+void ramwriter_init(struct RamWriter *writer);
+void ramwriter_deinit(struct RamWriter *writer);
+void ramwriter_setInterval(struct RamWriter *writer, int interval);
+
+/** Copies the data to be written later */
+void ramwriter_submit(struct RamWriter *writer, const char *filename, const uint8_t *data, int size);
+
+/** Writes pending changes now and waits until they are saved */
+void ramwriter_flush(struct RamWriter *writer);
+
+/** Returns true once after a write failed */
+bool ramwriter_takeFailure(struct RamWriter *writer);
+
+#endif /* ram_writer_h */
@@ -22,6 +22,9 @@
 #include "main.h"
 #include "sdl_include.h"
 #include "system_paths.h"
+#include "mapped_file.h"
+#include "disk_image.h"
+#include "disk_loader.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -32,6 +35,11 @@ void diskDriveIsFull(void *context, struct DataManager *diskDataManager);
 void controlsDidChange(void *context, struct ControlsInfo controlsInfo);
 void persistentRamWillAccess(void *context, uint8_t *destination, int size);
 void persistentRamDidChange(void *context, uint8_t *data, int size);
+uint64_t getHostTime(void *context);
+struct CoreError compileCachedProgram(struct Runner *runner, const char *filename, struct Program *program);
+void saveProgramCache(struct Runner *runner, const char *filename);
+void releaseProgramFile(void *context);
+bool exportDisk(struct DataManager *diskDataManager, const char *diskFilename);
 
 
 void runner_init(struct Runner *runner)
@@ -51,15 +59,28 @@ void runner_init(struct Runner *runner)
         runner->coreDelegate.controlsDidChange = controlsDidChange;
         runner->coreDelegate.persistentRamWillAccess = persistentRamWillAccess;
         runner->coreDelegate.persistentRamDidChange = persistentRamDidChange;
+        runner->coreDelegate.getHostTime = getHostTime;
         
         core_setDelegate(core, &runner->coreDelegate);
 
         runner->core = core;
     }
+    
+#ifndef __EMSCRIPTEN__
+    ramwriter_init(&runner->ramWriter);
+    diskloader_init(&runner->diskLoader);
+#endif
 }
 
 void runner_deinit(struct Runner *runner)
 {
+    runner_exportDisk(runner);
+    
+#ifndef __EMSCRIPTEN__
+    ramwriter_deinit(&runner->ramWriter);
+    diskloader_deinit(&runner->diskLoader);
+#endif
+    
     if (runner->core)
     {
         core_deinit(runner->core);
@@ -76,38 +97,172 @@ bool runner_isOkay(struct Runner *runner)
 
 struct CoreError runner_loadProgram(struct Runner *runner, const char *filename)
 {
-    struct CoreError error = err_noCoreError();
+#ifndef __EMSCRIPTEN__
+    diskloader_cancel(&runner->diskLoader);
+#endif
+    runner->isDiskLoaded = false;
+    runner_exportDisk(runner);
     
-    FILE *file = fopen_utf8(filename, "rb");
-    if (file)
+    struct MappedFile *file = calloc(1, sizeof(struct MappedFile));
+    if (!file) return err_makeCoreError(ErrorOutOfMemory, -1);
+    
+    if (!mapfile_open(file, filename))
     {
-        fseek(file, 0, SEEK_END);
-        long size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        char *sourceCode = calloc(1, size + 1); // +1 for terminator
-        if (sourceCode)
+        free(file);
+        return err_makeCoreError(ErrorCouldNotOpenProgram, -1);
+    }
+    
+    struct Program *program = prg_new();
+    if (!program)
+    {
+        releaseProgramFile(file);
+        return err_makeCoreError(ErrorOutOfMemory, -1);
+    }
+    
+    // the program is compiled directly from the file
+    prg_useSourceCode(program, file->data, releaseProgramFile, file);
+    
+    struct CoreError error = compileCachedProgram(runner, filename, program);
+    
+    // an editor could truncate the file, then reading the mapping would crash. Error messages and the profiler use a copy.
+    if (!prg_copySourceCode(program) && error.code == ErrorNone)
+    {
+        error = err_makeCoreError(ErrorOutOfMemory, -1);
+    }
+    prg_release(program);
+    return error;
+}
+
+/** Converts a binary disk image, which was saved to since the program started, to the text disk file */
+void runner_exportDisk(struct Runner *runner)
+{
+    if (!runner->exportDiskFilename[0]) return;
+    
+    struct DataManager *manager = calloc(1, sizeof(struct DataManager));
+    uint8_t *data = calloc(1, DATA_SIZE);
+    if (!manager || !data) exit(EXIT_FAILURE);
+    manager->data = data;
+    
+    char imageFilename[FILENAME_MAX];
+    diskimg_getFilename(imageFilename, runner->exportDiskFilename);
+    if (diskimg_load(manager, imageFilename).code == ErrorNone && exportDisk(manager, runner->exportDiskFilename))
+    {
+        // the image still has the same contents as the new text disk
+        struct DiskStamp stamp;
+        if (diskimg_getDiskStamp(runner->exportDiskFilename, &stamp))
         {
-            fread(sourceCode, size, 1, file);
-            
-            error = core_compileProgram(runner->core, sourceCode, true);
-            free(sourceCode);
+            diskimg_setDiskStamp(imageFilename, &stamp);
         }
-        else
+    }
+    runner->exportDiskFilename[0] = 0;
+    
+    data_deinit(manager);
+    free(data);
+    free(manager);
+}
+
+/** Call every frame before core_update, resumes the program when its disk is loaded */
+void runner_update(struct Runner *runner)
+{
+#ifndef __EMSCRIPTEN__
+    struct DiskLoader *loader = &runner->diskLoader;
+    if (diskloader_isLoading(loader))
+    {
+        if (diskloader_isFinished(loader))
         {
-            error = err_makeCoreError(ErrorOutOfMemory, -1);
+            struct CoreError error = diskloader_finish(loader, &runner->core->diskDrive->dataManager);
+            if (error.code != ErrorNone)
+            {
+                core_traceError(runner->core, error);
+            }
+            runner->isDiskLoaded = true;
+            core_diskLoaded(runner->core);
         }
-        
-        fclose(file);
     }
-    else
+    else if (runner->core->interpreter->state == StateWaitForDisk)
     {
-        error = err_makeCoreError(ErrorCouldNotOpenProgram, -1);
+        // for example after rewinding, the disk command starts loading again
+        core_diskLoaded(runner->core);
+    }
+#endif
+}
+
+/** Loads the compiled program from the cache if the source code is unchanged, otherwise compiles and caches it */
+struct CoreError compileCachedProgram(struct Runner *runner, const char *filename, struct Program *program)
+{
+#ifndef __EMSCRIPTEN__
+    char cacheFilename[FILENAME_MAX];
+    getCacheFilename(cacheFilename, filename);
+    
+    struct MappedFile cacheFile;
+    if (cacheFilename[0] && mapfile_open(&cacheFile, cacheFilename))
+    {
+        bool isLoaded = cache_load(program, cacheFile.data, cacheFile.size);
+        mapfile_close(&cacheFile);
+        if (isLoaded)
+        {
+            core_loadProgram(runner->core, program, true);
+            return err_noCoreError();
+        }
     }
+#endif
+    
+    struct CoreError error = core_compileNewProgram(runner->core, program, true);
     
+#ifndef __EMSCRIPTEN__
+    if (error.code == ErrorNone)
+    {
+        saveProgramCache(runner, filename);
+    }
+#endif
     return error;
 }
 
+void saveProgramCache(struct Runner *runner, const char *filename)
+{
+    struct Program *program = core_getProgram(runner->core);
+    char cacheFilename[FILENAME_MAX];
+    getCacheFilename(cacheFilename, filename);
+    if (!program || !cacheFilename[0]) return;
+    
+    size_t size = cache_getSize(program);
+    void *data = malloc(size);
+    if (data && cache_save(program, data, size))
+    {
+        // an incomplete file fails the checksum and is replaced next time
+        FILE *file = fopen_utf8(cacheFilename, "wb");
+        if (file)
+        {
+            fwrite(data, 1, size, file);
+            fclose(file);
+        }
+    }
+    free(data);
+}
+
+void releaseProgramFile(void *context)
+{
+    struct MappedFile *file = context;
+    mapfile_close(file);
+    free(file);
+}
+
+bool exportDisk(struct DataManager *diskDataManager, const char *diskFilename)
+{
+    char *output = data_export(diskDataManager);
+    if (!output) return false;
+    
+    bool success = false;
+    FILE *file = fopen_utf8(diskFilename, "wb");
+    if (file)
+    {
+        success = fwrite(output, 1, strlen(output), file) == strlen(output);
+        fclose(file);
+    }
+    free(output);
+    return success;
+}
+
 /** Called on error */
 void interpreterDidFail(void *context, struct CoreError coreError)
 {
@@ -131,41 +286,23 @@ bool diskDriveWillAccess(void *context, struct DataManager *diskDataManager)
     
 #ifndef __EMSCRIPTEN__
     
-    char diskFilename[FILENAME_MAX];
-    getDiskFilename(diskFilename);
-    
-    FILE *file = fopen_utf8(diskFilename, "rb");
-    if (file)
+    // the command is repeated when the disk is loaded
+    if (runner->isDiskLoaded)
     {
-        fseek(file, 0, SEEK_END);
-        long size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        
-        char *sourceCode = calloc(1, size + 1); // +1 for terminator
-        if (sourceCode)
-        {
-            fread(sourceCode, size, 1, file);
-            
-            struct CoreError error = data_import(diskDataManager, sourceCode, true);
-            free(sourceCode);
-            
-            if (error.code != ErrorNone)
-            {
-                core_traceError(runner->core, error);
-            }
-        }
-        else
-        {
-            struct TextLib *lib = &runner->core->overlay->textLib;
-            txtlib_printText(lib, "NOT ENOUGH MEMORY\n");
-        }
-        
-        fclose(file);
+        runner->isDiskLoaded = false;
+        return true;
     }
     
-#endif
+    char diskFilename[FILENAME_MAX];
+    getDiskFilename(diskFilename);
+    diskloader_start(&runner->diskLoader, diskFilename, usesBinaryDisk());
+    return false;
+    
+#else
     
     return true;
+    
+#endif
 }
 
 /** Called when a disk data entry was saved */
@@ -175,27 +312,31 @@ void diskDriveDidSave(void *context, struct DataManager *diskDataManager)
 #ifdef __EMSCRIPTEN__
     overlay_message(runner->core, "NO DISK");
 #else
-    char *output = data_export(diskDataManager);
-    if (output)
+    char diskFilename[FILENAME_MAX];
+    getDiskFilename(diskFilename);
+    
+    bool saved = false;
+    if (usesBinaryDisk())
     {
-        char diskFilename[FILENAME_MAX];
-        getDiskFilename(diskFilename);
-        
-        FILE *file = fopen_utf8(diskFilename, "wb");
-        if (file)
+        char imageFilename[FILENAME_MAX];
+        diskimg_getFilename(imageFilename, diskFilename);
+        saved = diskimg_saveChanges(diskDataManager, imageFilename, diskFilename);
+        if (saved)
         {
-            fwrite(output, 1, strlen(output), file);
-            fclose(file);
+            strncpy(runner->exportDiskFilename, diskFilename, FILENAME_MAX - 1);
         }
-        else
-        {
-            struct TextLib *lib = &runner->core->overlay->textLib;
-            txtlib_printText(lib, "COULD NOT SAVE:\n");
-            txtlib_printText(lib, diskFilename);
-            txtlib_printText(lib, "\n");
-        }
-        
-        free(output);
+    }
+    else
+    {
+        saved = exportDisk(diskDataManager, diskFilename);
+    }
+    
+    if (!saved)
+    {
+        struct TextLib *lib = &runner->core->overlay->textLib;
+        txtlib_printText(lib, "COULD NOT SAVE:\n");
+        txtlib_printText(lib, diskFilename);
+        txtlib_printText(lib, "\n");
     }
 #endif
 }
@@ -210,18 +351,9 @@ void diskDriveIsFull(void *context, struct DataManager *diskDataManager)
 /** Called when keyboard or gamepad settings changed */
 void controlsDidChange(void *context, struct ControlsInfo controlsInfo)
 {
-    if (   controlsInfo.keyboardMode == KeyboardModeOn
-        || (controlsInfo.keyboardMode == KeyboardModeOptional && !SDL_HasScreenKeyboardSupport()) )
-    {
-        if (!SDL_IsTextInputActive())
-        {
-            SDL_StartTextInput();
-        }
-    }
-    else if (SDL_IsTextInputActive())
-    {
-        SDL_StopTextInput();
-    }
+    bool textInput = (   controlsInfo.keyboardMode == KeyboardModeOn
+                      || (controlsInfo.keyboardMode == KeyboardModeOptional && !SDL_HasScreenKeyboardSupport()) );
+    setTextInputEnabled(textInput);
     setMouseEnabled(controlsInfo.isTouchEnabled);
 }
 
@@ -229,6 +361,11 @@ void controlsDidChange(void *context, struct ControlsInfo controlsInfo)
 void persistentRamWillAccess(void *context, uint8_t *destination, int size)
 {
 #ifndef __EMSCRIPTEN__
+    struct Runner *runner = context;
+    
+    // the file may still be written for the last run of the program
+    ramwriter_flush(&runner->ramWriter);
+    
     char ramFilename[FILENAME_MAX];
     getRamFilename(ramFilename);
     
@@ -241,7 +378,7 @@ void persistentRamWillAccess(void *context, uint8_t *destination, int size)
 #endif
 }
 
-/** Called when persistent RAM should be saved */
+/** Called when persistent RAM should be saved, the file is written in the background */
 void persistentRamDidChange(void *context, uint8_t *data, int size)
 {
 #ifndef __EMSCRIPTEN__
@@ -250,18 +387,21 @@ void persistentRamDidChange(void *context, uint8_t *data, int size)
     char ramFilename[FILENAME_MAX];
     getRamFilename(ramFilename);
     
-    FILE *file = fopen_utf8(ramFilename, "wb");
-    if (file)
-    {
-        fwrite(data, 1, size, file);
-        fclose(file);
-    }
-    else
+    if (ramwriter_takeFailure(&runner->ramWriter))
     {
         struct TextLib *lib = &runner->core->overlay->textLib;
         txtlib_printText(lib, "COULD NOT SAVE:\n");
         txtlib_printText(lib, ramFilename);
         txtlib_printText(lib, "\n");
     }
+    ramwriter_submit(&runner->ramWriter, ramFilename, data, size);
 #endif
 }
+
+/** Returns the performance counter in nanoseconds */
+uint64_t getHostTime(void *context)
+{
+    Uint64 counter = SDL_GetPerformanceCounter();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    return (counter / frequency) * 1000000000 + (counter % frequency) * 1000000000 / frequency;
+}
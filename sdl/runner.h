@@ -24,16 +24,25 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "core.h"
+#include "ram_writer.h"
+#include "disk_loader.h"
 
 struct Runner {
     struct Core *core;
     struct CoreDelegate coreDelegate;
     bool messageShownUsingDisk;
+    // text disk to convert from its binary image when the program ends
+    char exportDiskFilename[FILENAME_MAX];
+    struct RamWriter ramWriter;
+    struct DiskLoader diskLoader;
+    bool isDiskLoaded;
 };
 
 void runner_init(struct Runner *runner);
 void runner_deinit(struct Runner *runner);
 bool runner_isOkay(struct Runner *runner);
 struct CoreError runner_loadProgram(struct Runner *runner, const char *filename);
+void runner_exportDisk(struct Runner *runner);
+void runner_update(struct Runner *runner);
 
 #endif /* runner_h */
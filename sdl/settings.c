@@ -24,6 +24,7 @@
 #include "system_paths.h"
 #include "utils.h"
 #include "sdl_include.h"
+#include "ram_writer.h"
 #include <string.h>
 
 const char *optionYes = "yes";
@@ -36,6 +37,8 @@ void settings_saveAs(struct Settings *settings, const char *filename);
 void settings_init(struct Settings *settings, char *filenameOut, int argc, const char * argv[])
 {
     memset(settings, 0, sizeof(struct Settings));
+    settings->file.ramsaveinterval = RAMWRITER_DEFAULT_INTERVAL;
+    settings->session.ramsaveinterval = RAMWRITER_DEFAULT_INTERVAL;
     
 #if SETTINGS_FILE
     
@@ -174,6 +177,47 @@ void settings_setParameter(struct Parameters *parameters, const char *key, const
             parameters->disabledelay = false;
         }
     }
+    else if (strcmp(key, "trace") == 0)
+    {
+        if (strcmp(value, optionYes) == 0)
+        {
+            parameters->trace = true;
+        }
+        else if (strcmp(value, optionNo) == 0)
+        {
+            parameters->trace = false;
+        }
+    }
+    else if (strcmp(key, "fastforward") == 0)
+    {
+        if (strcmp(value, optionYes) == 0)
+        {
+            parameters->fastforward = true;
+        }
+        else if (strcmp(value, optionNo) == 0)
+        {
+            parameters->fastforward = false;
+        }
+    }
+    else if (strcmp(key, "binarydisk") == 0)
+    {
+        if (strcmp(value, optionYes) == 0)
+        {
+            parameters->binarydisk = true;
+        }
+        else if (strcmp(value, optionNo) == 0)
+        {
+            parameters->binarydisk = false;
+        }
+    }
+    else if (strcmp(key, "ramsaveinterval") == 0)
+    {
+        int i = atoi(value);
+        if (i >= 0 && i <= 60000)
+        {
+            parameters->ramsaveinterval = i;
+        }
+    }
     else if (strcmp(key, "zoom") == 0)
     {
         int i = atoi(value);
@@ -226,6 +270,14 @@ void settings_saveAs(struct Settings *settings, const char *filename)
         fputs(settings->file.disabledelay ? optionYes : optionNo, file);
         fputs("\n\n", file);
         
+        fputs("# Save Disk.nx as a binary image (Disk.nxd), which only writes the changed files.\n# Disk.nx is converted when the program ends.\n# binarydisk yes/no\n", file);
+        fputs("binarydisk ", file);
+        fputs(settings->file.binarydisk ? optionYes : optionNo, file);
+        fputs("\n\n", file);
+        
+        fputs("# Milliseconds to collect changes of persistent memory before saving them.\n# ramsaveinterval 0-60000\n", file);
+        fprintf(file, "ramsaveinterval %d\n\n", settings->file.ramsaveinterval);
+        
         fputs("# Add tools for the Edit ROM menu (max 4).\n# tool My Tool.nx\n", file);
         for (int i = 0; i < settings->numTools; i++)
         {
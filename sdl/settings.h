@@ -33,6 +33,10 @@ struct Parameters {
     bool disabledev;
     int mapping;
     int disabledelay;
+    bool trace;
+    bool fastforward;
+    bool binarydisk;
+    int ramsaveinterval;
 };
 
 struct Settings {
@@ -24,6 +24,9 @@
 
 #if defined(_WIN32)
 #include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
 #endif
 
 void desktop_path(char *buffer, size_t size)
@@ -61,3 +64,47 @@ FILE* fopen_utf8(const char* filename, const char* mode)
 	return fopen(filename, mode);
 #endif
 }
+
+/** Replaces an existing file, so it's never missing or incomplete */
+bool rename_utf8(const char* oldFilename, const char* newFilename)
+{
+#if defined(_WIN32)
+	WCHAR oldNameW[FILENAME_MAX] = { 0 };
+	WCHAR newNameW[FILENAME_MAX] = { 0 };
+	if (MultiByteToWideChar(CP_UTF8, 0, oldFilename, -1, oldNameW, FILENAME_MAX) > 0
+		&& MultiByteToWideChar(CP_UTF8, 0, newFilename, -1, newNameW, FILENAME_MAX) > 0)
+	{
+		return MoveFileExW(oldNameW, newNameW, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+	}
+	return false;
+#else
+	return rename(oldFilename, newFilename) == 0;
+#endif
+}
+
+int remove_utf8(const char* filename)
+{
+#if defined(_WIN32)
+	WCHAR nameW[FILENAME_MAX] = { 0 };
+	if (MultiByteToWideChar(CP_UTF8, 0, filename, -1, nameW, FILENAME_MAX) > 0)
+	{
+		return _wremove(nameW);
+	}
+	return -1;
+#else
+	return remove(filename);
+#endif
+}
+
+/** Writes buffered data through to the storage device */
+bool fsync_file(FILE* file)
+{
+	if (fflush(file) != 0) return false;
+#if defined(_WIN32)
+	return _commit(_fileno(file)) == 0;
+#elif defined(__EMSCRIPTEN__)
+	return true;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
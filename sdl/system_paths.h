@@ -22,6 +22,7 @@
 #define system_paths_h
 
 #include <stdio.h>
+#include <stdbool.h>
 
 #ifdef _WIN32
 #define PATH_SEPARATOR "\\"
@@ -33,5 +34,8 @@
 
 void desktop_path(char *buffer, size_t size);
 FILE* fopen_utf8(const char* filename, const char* mode);
+bool rename_utf8(const char* oldFilename, const char* newFilename);
+int remove_utf8(const char* filename);
+bool fsync_file(FILE* file);
 
 #endif /* system_paths_h */
@@ -0,0 +1,106 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "triple_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+void tribuf_init(struct TripleBuffer *tripleBuffer, int size)
+{
+    memset(tripleBuffer, 0, sizeof(struct TripleBuffer));
+    tripleBuffer->mutex = SDL_CreateMutex();
+    if (!tripleBuffer->mutex) exit(EXIT_FAILURE);
+    tripleBuffer->didChange = SDL_CreateCond();
+    if (!tripleBuffer->didChange) exit(EXIT_FAILURE);
+    for (int i = 0; i < 3; i++)
+    {
+        tripleBuffer->buffers[i] = calloc(1, size);
+        if (!tripleBuffer->buffers[i]) exit(EXIT_FAILURE);
+    }
+    tripleBuffer->writeIndex = 0;
+    tripleBuffer->readyIndex = 1;
+    tripleBuffer->readIndex = 2;
+}
+
+void tribuf_deinit(struct TripleBuffer *tripleBuffer)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        free(tripleBuffer->buffers[i]);
+        tripleBuffer->buffers[i] = NULL;
+    }
+    SDL_DestroyCond(tripleBuffer->didChange);
+    tripleBuffer->didChange = NULL;
+    SDL_DestroyMutex(tripleBuffer->mutex);
+    tripleBuffer->mutex = NULL;
+}
+
+void *tribuf_getWriteBuffer(struct TripleBuffer *tripleBuffer)
+{
+    return tripleBuffer->buffers[tripleBuffer->writeIndex];
+}
+
+void tribuf_publish(struct TripleBuffer *tripleBuffer)
+{
+    SDL_LockMutex(tripleBuffer->mutex);
+    int index = tripleBuffer->readyIndex;
+    tripleBuffer->readyIndex = tripleBuffer->writeIndex;
+    tripleBuffer->writeIndex = index;
+    tripleBuffer->hasNewFrame = true;
+    SDL_CondBroadcast(tripleBuffer->didChange);
+    SDL_UnlockMutex(tripleBuffer->mutex);
+}
+
+void tribuf_waitForRead(struct TripleBuffer *tripleBuffer, Uint32 timeout)
+{
+    SDL_LockMutex(tripleBuffer->mutex);
+    if (tripleBuffer->hasNewFrame)
+    {
+        SDL_CondWaitTimeout(tripleBuffer->didChange, tripleBuffer->mutex, timeout);
+    }
+    SDL_UnlockMutex(tripleBuffer->mutex);
+}
+
+void tribuf_waitForFrame(struct TripleBuffer *tripleBuffer, Uint32 timeout)
+{
+    SDL_LockMutex(tripleBuffer->mutex);
+    if (!tripleBuffer->hasNewFrame)
+    {
+        SDL_CondWaitTimeout(tripleBuffer->didChange, tripleBuffer->mutex, timeout);
+    }
+    SDL_UnlockMutex(tripleBuffer->mutex);
+}
+
+void *tribuf_getNewFrame(struct TripleBuffer *tripleBuffer)
+{
+    void *frame = NULL;
+    SDL_LockMutex(tripleBuffer->mutex);
+    if (tripleBuffer->hasNewFrame)
+    {
+        int index = tripleBuffer->readyIndex;
+        tripleBuffer->readyIndex = tripleBuffer->readIndex;
+        tripleBuffer->readIndex = index;
+        tripleBuffer->hasNewFrame = false;
+        frame = tripleBuffer->buffers[index];
+        SDL_CondBroadcast(tripleBuffer->didChange);
+    }
+    SDL_UnlockMutex(tripleBuffer->mutex);
+    return frame;
+}
@@ -0,0 +1,60 @@
+//
+// Copyright 2021 Timo Kloss
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef triple_buffer_h
+#define triple_buffer_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "sdl_include.h"
+
+/**
+ * Passes frames from the emulation thread to the main thread. The emulation thread always has
+ * a free buffer to render into and the main thread always gets the latest finished frame.
+ */
+struct TripleBuffer {
+    SDL_mutex *mutex;
+    SDL_cond *didChange;
+    void *buffers[3];
+    int writeIndex; // only used by the emulation thread
+    int readyIndex;
+    int readIndex; // only used by the main thread
+    bool hasNewFrame;
+};
+
+void tribuf_init(struct TripleBuffer *tripleBuffer, int size);
+void tribuf_deinit(struct TripleBuffer *tripleBuffer);
+
+/** Returns the buffer for the next frame */
+void *tribuf_getWriteBuffer(struct TripleBuffer *tripleBuffer);
+
+/** Makes the written buffer the latest frame, an older one not read yet gets dropped */
+void tribuf_publish(struct TripleBuffer *tripleBuffer);
+
+/** Waits until the main thread took the latest frame, at most timeout milliseconds */
+void tribuf_waitForRead(struct TripleBuffer *tripleBuffer, Uint32 timeout);
+
+/** Waits until there is a new frame, at most timeout milliseconds */
+void tribuf_waitForFrame(struct TripleBuffer *tripleBuffer, Uint32 timeout);
+
+/** Returns the latest frame if there is a new one, otherwise NULL. It stays valid until the next call. */
+void *tribuf_getNewFrame(struct TripleBuffer *tripleBuffer);
+
+#endif /* triple_buffer_h */